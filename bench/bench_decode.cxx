@@ -0,0 +1,152 @@
+/**
+ * @file bench_decode.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, cost of FG_PlayerState::Decode
+//
+//  Decode() runs once for every packet received, before the packet is
+//  checked. The benchmark decodes a position packet, a truncated one
+//  and a chat packet and prints the time per packet.
+//
+//  Then it puts position packets of several pilots through the whole
+//  path of FG_SERVER::HandlePacket(): decode, checks, update of the
+//  sender, lookup of the receivers and sendto() on loopback. Once with
+//  pilots far apart, which only costs the work for the sender, once
+//  with pilots close together, which adds the sendto() per receiver.
+//
+//  usage: bench_decode [packets]
+//  build with -DFGMS_BENCH=ON -DCMAKE_BUILD_TYPE=Release
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "fg_server.hxx"
+#include "fg_packet.hxx"
+#include "fg_bench.hxx"
+
+// defined by main.cxx, which is not part of the benchmark
+void ReloadConfig () {}
+
+/** @brief FG_SERVER with HandlePacket() made accessible */
+class BenchServer : public FG_SERVER
+{
+public:
+	using FG_SERVER::HandlePacket;
+};
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Nanoseconds of one Decode() of the first Bytes of Msg
+ */
+static double
+DecodeCost ( const std::vector<char>& Msg, int Bytes, long Count )
+{
+	FG_PlayerState State;
+	size_t Positions = 0;
+	uint64_t Start = NanoNow ();
+	for ( long i = 0; i < Count; i++ )
+	{
+		State.Decode ( &Msg[0], Bytes );
+		Positions += State.HasPosition;
+	}
+	double Cost = ( double ) ( NanoNow () - Start ) / Count;
+	// use the result, so that the loop is not optimized away
+	if ( Positions == 1 )
+		printf ( "unexpected\n" );
+	return Cost;
+}
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Nanoseconds of one HandlePacket() of the position packet Msg,
+ *        sent by Players pilots in turn, Spacing meters apart
+ */
+static double
+HandleCost ( const std::vector<char>& Msg, int Players, double Spacing,
+  long Count )
+{
+	BenchServer Server;
+	sglog().setLogLevels ( SG_ALL, SG_ALERT );
+	// all pilots send from this socket and receive on it
+	netSocket Socket;
+	Socket.open ( false );
+	Socket.bind ( "127.0.0.1", 0 );
+	struct sockaddr_in A;
+	socklen_t Len = sizeof ( A );
+	getsockname ( Socket.getHandle (), ( struct sockaddr* ) &A, &Len );
+	netAddress Sender ( "127.0.0.1", ntohs ( A.sin_port ) );
+	st_worker Worker ( &Server, 0, &Socket );
+	std::vector< std::vector<char> > Pilots;
+	for ( int p = 0; p < Players; p++ )
+	{
+		const double Pos[3] = { 4000000.0 + p * Spacing, 3000000.0, 3500000.0 };
+		const float  Vel[3] = { 100.0f, 0.0f, -5.0f };
+		std::vector<char> Pilot ( Msg );
+		SetPosition ( Pilot, Pos, Vel, 1.0 );
+		T_MsgHdr* Hdr = ( T_MsgHdr* ) &Pilot[0];
+		memset ( Hdr->Name, 0, sizeof ( Hdr->Name ) );
+		snprintf ( Hdr->Name, sizeof ( Hdr->Name ), "P%d", p );
+		Pilots.push_back ( Pilot );
+		// the first packet adds the pilot
+		Server.HandlePacket ( &Pilots[p][0], Pilot.size (), Sender, Worker );
+	}
+	uint64_t Start = NanoNow ();
+	for ( long i = 0; i < Count; i++ )
+	{
+		std::vector<char>& Pilot = Pilots[i % Players];
+		Server.HandlePacket ( &Pilot[0], Pilot.size (), Sender, Worker );
+	}
+	return ( double ) ( NanoNow () - Start ) / Count;
+}
+
+int
+main ( int argc, char* argv[] )
+{
+	long Count = BenchArg ( argc, argv, 1, 10000000 );
+	const double Pos[3] = { 4000000.0, 3000000.0, 3500000.0 };
+	const float  Vel[3] = { 100.0f, 0.0f, -5.0f };
+	std::vector<char> Props;
+	for ( uint32_t Id = 100; Id < 200; Id++ )
+		Word ( Props, ( Id << 16 ) | 1 );
+	std::vector<char> Msg = Packet ( Props );
+	SetPosition ( Msg, Pos, Vel, 1.0 );
+	std::vector<char> Chat ( Msg );
+	( ( T_MsgHdr* ) &Chat[0] )->MsgId = XDR_encode<uint32_t> ( CHAT_MSG_ID );
+
+	printf ( "%ld packets of %d bytes\n", Count, ( int ) Msg.size () );
+	printf ( "position:  %6.1f ns per packet\n",
+	  DecodeCost ( Msg, Msg.size (), Count ) );
+	printf ( "truncated: %6.1f ns per packet\n",
+	  DecodeCost ( Msg, Msg.size () - 1, Count ) );
+	printf ( "chat:      %6.1f ns per packet\n",
+	  DecodeCost ( Chat, Chat.size (), Count ) );
+
+	printf ( "HandlePacket() of %ld packets\n", Count / 100 );
+	printf ( "100 pilots far apart:    %8.1f ns per packet\n",
+	  HandleCost ( Msg, 100, 1000000.0, Count / 100 ) );
+	printf ( "10 pilots close together: %7.1f ns per packet, 9 receivers\n",
+	  HandleCost ( Msg, 10, 100.0, Count / 100 ) );
+	return 0;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file bench_geod.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, CartToGeod() against sgCartToGeod()
+//
+//  Both convert the same random positions between the surface and
+//  15000 m altitude. The benchmark prints the nanoseconds of one
+//  conversion and the largest difference of the results in meters.
+//
+//  usage: bench_geod [positions]
+//  build with -DFGMS_BENCH=ON -DCMAKE_BUILD_TYPE=Release
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "fg_geometry.hxx"
+#include "fg_bench.hxx"
+
+typedef void ( *Convert ) ( const Point3D&, Point3D& );
+
+//////////////////////////////////////////////////////////////////////
+static double
+Random ( double Min, double Max )
+{
+	return Min + ( Max - Min ) * ( rand () / ( double ) RAND_MAX );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief The distance in meters between two geodetic positions
+ */
+static double
+Meters ( const Point3D& A, const Point3D& B )
+{
+	double PA[3], PB[3];
+	sgGeodToCart ( A[Lat] * SG_DEGREES_TO_RADIANS, A[Lon] * SG_DEGREES_TO_RADIANS,
+	  A[Alt] * SG_FEET_TO_METER, PA );
+	sgGeodToCart ( B[Lat] * SG_DEGREES_TO_RADIANS, B[Lon] * SG_DEGREES_TO_RADIANS,
+	  B[Alt] * SG_FEET_TO_METER, PB );
+	return sqrt ( ( PA[0] - PB[0] ) * ( PA[0] - PB[0] )
+	  + ( PA[1] - PB[1] ) * ( PA[1] - PB[1] )
+	  + ( PA[2] - PB[2] ) * ( PA[2] - PB[2] ) );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Nanoseconds of one conversion of the positions Cart
+ */
+static double
+Cost ( Convert Func, const std::vector<Point3D>& Cart,
+  std::vector<Point3D>& Geod )
+{
+	uint64_t Start = NanoNow ();
+	for ( size_t i = 0; i < Cart.size (); i++ )
+		Func ( Cart[i], Geod[i] );
+	return ( double ) ( NanoNow () - Start ) / Cart.size ();
+}
+//////////////////////////////////////////////////////////////////////
+
+int
+main ( int argc, char* argv[] )
+{
+	long Count = BenchArg ( argc, argv, 1, 2000000 );
+	std::vector<Point3D> Cart ( Count );
+	srand ( 1 );
+	for ( long i = 0; i < Count; i++ )
+	{
+		double XYZ[3];
+		sgGeodToCart ( Random ( -SG_PI / 2, SG_PI / 2 ),
+		  Random ( -SG_PI, SG_PI ), Random ( 0, 15000 ), XYZ );
+		Cart[i].Set ( XYZ[0], XYZ[1], XYZ[2] );
+	}
+	std::vector<Point3D> Sg ( Count ), Olson ( Count );
+	printf ( "%ld positions\n", Count );
+	printf ( "sgCartToGeod(): %6.1f ns\n", Cost ( sgCartToGeod, Cart, Sg ) );
+	printf ( "CartToGeod():   %6.1f ns\n", Cost ( CartToGeod, Cart, Olson ) );
+	double Max = 0;
+	for ( long i = 0; i < Count; i++ )
+	{
+		double D = Meters ( Sg[i], Olson[i] );
+		if ( D > Max )
+			Max = D;
+	}
+	printf ( "largest difference: %.6f m\n", Max );
+	return 0;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file bench_grid.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, FG_SpatialGrid against the linear scan
+//
+//  Builds players clustered around airports, every player sends once
+//  per round. The receivers are looked up once with the grid and once
+//  with the scan over all players FG_SERVER used before, one Distance()
+//  per receiver (see ReceiverWantsData()). Both must find the same
+//  receivers.
+//
+//  Without arguments it runs 100, 1000 and 5000 players and prints
+//  packets per second of the lookup alone, without sending. Below
+//  about 100 players the grid is slower than the scan: the 27 cell
+//  lookups cost more than checking the few players one by one. The
+//  loss is a few hundred ns per packet, small against one sendto()
+//  per receiver, so the grid is used regardless of the number of
+//  players.
+//
+//  usage: bench_grid [players] [rounds]
+//  build with -DFGMS_BENCH=ON -DCMAKE_BUILD_TYPE=Release
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "fg_geometry.hxx"
+#include "fg_grid.hxx"
+#include "fg_bench.hxx"
+
+typedef struct
+{
+	Point3D	Pos;
+	double	Range;	// nautical miles
+} Player;
+
+/** a random number in [Min, Max) */
+static double
+Random ( double Min, double Max )
+{
+	return Min + ( Max - Min ) * ( rand () / ( RAND_MAX + 1.0 ) );
+}
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Count players within about 100 nm of an airport, one in ten
+ *        with a wide radar range
+ */
+static std::vector<Player>
+MakePlayers ( long Count )
+{
+	std::vector<Player> Players ( Count );
+	long Airports = std::max ( 1L, Count / 50 );
+	std::vector<double> Lat ( Airports ), Lon ( Airports );
+	for ( long a = 0; a < Airports; a++ )
+	{
+		Lat[a] = Random ( -60, 60 );
+		Lon[a] = Random ( -180, 180 );
+	}
+	for ( long i = 0; i < Count; i++ )
+	{
+		long a = rand () % Airports;
+		double XYZ[3];
+		sgGeodToCart ( ( Lat[a] + Random ( -1.5, 1.5 ) ) * SG_DEGREES_TO_RADIANS,
+		  ( Lon[a] + Random ( -1.5, 1.5 ) ) * SG_DEGREES_TO_RADIANS,
+		  Random ( 0, 10000 ), XYZ );
+		Players[i].Pos.Set ( XYZ[0], XYZ[1], XYZ[2] );
+		Players[i].Range = ( i % 10 == 0 ) ? 300 : 100;
+	}
+	return Players;
+}
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Look up the receivers of every player Rounds times, with the
+ *        grid and with the scan
+ * @return false if both found different receivers
+ */
+static bool
+Run ( long Count, long Rounds )
+{
+	const double OutOfReach = 100;
+	srand ( 1 );
+	std::vector<Player> Players = MakePlayers ( Count );
+	FG_SpatialGrid Grid;
+	Grid.SetCellSize ( OutOfReach );
+	for ( long i = 0; i < Count; i++ )
+		Grid.Update ( i, Players[i].Pos, Players[i].Range );
+
+	std::vector<size_t> IDs;
+	size_t GridFound = 0;
+	uint64_t Start = NanoNow ();
+	for ( long r = 0; r < Rounds; r++ )
+	{
+		for ( long s = 0; s < Count; s++ )
+		{
+			IDs.clear ();
+			Grid.Receivers ( Players[s].Pos, IDs );
+			GridFound += IDs.size ();
+		}
+	}
+	double GridCost = ( double ) ( NanoNow () - Start ) / ( Rounds * Count );
+
+	size_t ScanFound = 0;
+	Start = NanoNow ();
+	for ( long r = 0; r < Rounds; r++ )
+	{
+		for ( long s = 0; s < Count; s++ )
+		{
+			for ( long i = 0; i < Count; i++ )
+			{
+				if ( Distance ( Players[s].Pos, Players[i].Pos ) < Players[i].Range )
+					ScanFound++;
+			}
+		}
+	}
+	double ScanCost = ( double ) ( NanoNow () - Start ) / ( Rounds * Count );
+
+	printf ( "%ld players, %ld rounds, %.1f receivers per packet\n", Count,
+	  Rounds, ( double ) GridFound / ( Rounds * Count ) );
+	printf ( "grid: %10.0f ns per packet, %7.2f M packets/s\n", GridCost,
+	  1000.0 / GridCost );
+	printf ( "scan: %10.0f ns per packet, %7.2f M packets/s\n", ScanCost,
+	  1000.0 / ScanCost );
+	printf ( "speedup: %.1f\n", ScanCost / GridCost );
+	if ( GridFound != ScanFound )
+	{
+		printf ( "MISMATCH: grid found %lu, scan found %lu receivers\n",
+		  ( unsigned long ) GridFound, ( unsigned long ) ScanFound );
+		return false;
+	}
+	return true;
+}
+
+int
+main ( int argc, char* argv[] )
+{
+	if ( argc > 1 )
+	{
+		long Count = BenchArg ( argc, argv, 1, 2000 );
+		return Run ( Count, BenchArg ( argc, argv, 2, 10 ) ) ? 0 : 1;
+	}
+	const long Presets[] = { 100, 1000, 5000 };
+	bool Ok = true;
+	for ( size_t p = 0; p < sizeof ( Presets ) / sizeof ( Presets[0] ); p++ )
+	{	// about the same number of packets for every preset
+		Ok &= Run ( Presets[p], std::max ( 10L, 100000 / Presets[p] ) );
+	}
+	return Ok ? 0 : 1;
+}
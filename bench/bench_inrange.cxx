@@ -0,0 +1,141 @@
+/**
+ * @file bench_inrange.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, the versions of InRangeMask() against
+//  Distance()
+//
+//  One sender is checked against batches of 8, 16, 32 and 64 random
+//  receivers, once with the float Distance() and a compare per
+//  receiver, as the forwarding loop did before, and once with each
+//  version of InRangeMask() this CPU has. The result is nanoseconds
+//  per receiver.
+//
+//  usage: bench_inrange [rounds]
+//  build with -DFGMS_BENCH=ON -DCMAKE_BUILD_TYPE=Release
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "fg_geometry.hxx"
+#include "fg_bench.hxx"
+
+/** @brief a batch of receivers, as the grid keeps them */
+struct Batch
+{
+	std::vector<double> X, Y, Z, Range2;
+	std::vector<Point3D> Pos;
+	std::vector<float> Range;
+};
+
+//////////////////////////////////////////////////////////////////////
+static double
+Random ( double Min, double Max )
+{
+	return Min + ( Max - Min ) * ( rand () / ( double ) RAND_MAX );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Nanoseconds per receiver of Rounds checks of Count receivers
+ *        with Version, -1 for Distance()
+ * @return false if Version is not available on this CPU
+ */
+static bool
+Cost ( int Version, const Point3D& Sender, const Batch& B, long Rounds,
+  double& Ns, uint64_t& Hits )
+{
+	size_t Count = B.X.size ();
+	uint64_t Mask;
+	if ( ( Version >= 0 ) && ! InRangeMaskOf ( Version, Sender, &B.X[0],
+	  &B.Y[0], &B.Z[0], &B.Range2[0], Count, Mask ) )
+		return false;
+	Hits = 0;
+	uint64_t Start = NanoNow ();
+	for ( long r = 0; r < Rounds; r++ )
+	{
+		if ( Version < 0 )
+		{
+			for ( size_t i = 0; i < Count; i++ )
+			{
+				if ( Distance ( Sender, B.Pos[i] ) < B.Range[i] )
+					Hits++;
+			}
+			continue;
+		}
+		InRangeMaskOf ( Version, Sender, &B.X[0], &B.Y[0], &B.Z[0],
+		  &B.Range2[0], Count, Mask );
+		Hits += __builtin_popcountll ( Mask );
+	}
+	Ns = ( double ) ( NanoNow () - Start ) / Rounds / Count;
+	return true;
+}
+//////////////////////////////////////////////////////////////////////
+
+int
+main ( int argc, char* argv[] )
+{
+	long Rounds = BenchArg ( argc, argv, 1, 2000000 );
+	const char* Names[] = { "scalar", "sse2", "avx2" };
+	Point3D Sender ( 4000000, 3000000, 3500000 );
+	srand ( 1 );
+	printf ( "%ld rounds, ns per receiver\n", Rounds );
+	printf ( "receivers  Distance()  scalar    sse2    avx2\n" );
+	for ( size_t Count = 8; Count <= RANGE_MASK_BITS; Count *= 2 )
+	{
+		Batch B;
+		for ( size_t i = 0; i < Count; i++ )
+		{
+			Point3D P ( Sender[X] + Random ( -1e6, 1e6 ),
+			  Sender[Y] + Random ( -1e6, 1e6 ),
+			  Sender[Z] + Random ( -1e6, 1e6 ) );
+			float Range = Random ( 0, 1.5e6 );
+			B.Pos.push_back ( P );
+			B.Range.push_back ( Range );
+			B.X.push_back ( P[X] );
+			B.Y.push_back ( P[Y] );
+			B.Z.push_back ( P[Z] );
+			B.Range2.push_back ( ( double ) Range * Range );
+		}
+		double Ns;
+		uint64_t Hits, Expected = 0;
+		Cost ( IN_RANGE_SCALAR, Sender, B, 1, Ns, Expected );
+		Cost ( -1, Sender, B, Rounds, Ns, Hits );
+		printf ( "%9lu  %10.2f", ( unsigned long ) Count, Ns );
+		for ( int Version = IN_RANGE_SCALAR; Version <= IN_RANGE_AVX2; Version++ )
+		{
+			if ( ! Cost ( Version, Sender, B, Rounds, Ns, Hits ) )
+			{
+				printf ( "  %6s", "-" );
+				continue;
+			}
+			printf ( "  %6.2f", Ns );
+			// use the result, so that the loop is not optimized away
+			if ( Hits != Expected * Rounds )
+				printf ( " (%s differs)", Names[Version] );
+		}
+		printf ( "\n" );
+	}
+	return 0;
+}
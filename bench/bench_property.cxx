@@ -0,0 +1,152 @@
+/**
+ * @file bench_property.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, throughput of FG_PropertyFilter
+//
+//  Trim() runs once per band and packet, the saving is one smaller
+//  sendto() per receiver within the band: less CPU in the kernel and
+//  less time on the uplink. The benchmark measures Trim() and sendto()
+//  on loopback, adds the uplink time of the saved bytes and prints how
+//  many receivers a band needs until trimming pays off.
+//
+//  usage: bench_property [packets] [uplink Mbit/s]
+//  build with -DFGMS_BENCH=ON -DCMAKE_BUILD_TYPE=Release
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <plib/netSocket.h>
+#include "fg_property.hxx"
+#include "fg_packet.hxx"
+#include "fg_bench.hxx"
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief A position packet with properties like FlightGear sends them:
+ *        surface positions, long encoded floats, short ints and a chat
+ */
+static std::vector<char>
+TypicalPacket ()
+{
+	std::vector<char> Props;
+	for ( uint32_t Id = 100; Id < 130; Id++ )
+		Word ( Props, ( Id << 16 ) | 0x1234 );
+	for ( uint32_t Id = 300; Id < 340; Id++ )
+	{
+		Word ( Props, Id );
+		Word ( Props, 0x3f800000 );
+	}
+	for ( uint32_t Id = 1000; Id < 1020; Id++ )
+		Word ( Props, ( Id << 16 ) | 1 );
+	ShortString ( Props, 10002, "hello world" );
+	return Packet ( Props );
+}
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Nanoseconds of one sendto() of Bytes to To
+ */
+static double
+SendCost ( netSocket& Socket, const char* Msg, int Bytes, const netAddress& To,
+  long Count )
+{
+	uint64_t Start = NanoNow ();
+	for ( long i = 0; i < Count; i++ )
+		Socket.sendto ( Msg, Bytes, 0, &To );
+	return ( double ) ( NanoNow () - Start ) / Count;
+}
+
+int
+main ( int argc, char* argv[] )
+{
+	const int BANDS = 3;	// the first band forwards everything
+	long Count = BenchArg ( argc, argv, 1, 200000 );
+	long Uplink = BenchArg ( argc, argv, 2, 100 );
+	const char* Bands = "20:* 60:100-199,10002 100:10002";
+	FG_PropertyFilter Filter;
+	Filter.SetBands ( Bands );
+	std::vector<char> Msg = TypicalPacket ();
+	std::vector<char> Out[BANDS];
+	for ( int b = 0; b < BANDS; b++ )
+		Out[b].resize ( Msg.size () );
+
+	// a receiver on loopback, it is never read, the kernel drops
+	// what does not fit, sendto() costs the same
+	netInit ();
+	netSocket Receiver, Sender;
+	Receiver.open ( false );
+	Receiver.bind ( "127.0.0.1", 0 );
+	struct sockaddr_in Bound;
+	socklen_t Len = sizeof ( Bound );
+	getsockname ( Receiver.getHandle (), ( struct sockaddr* ) &Bound, &Len );
+	netAddress To ( "127.0.0.1", ntohs ( Bound.sin_port ) );
+	Sender.open ( false );
+	Sender.setBlocking ( false );
+
+	// Trim() once per band
+	int Bytes[BANDS];
+	double TrimCost[BANDS];
+	for ( int b = 1; b < BANDS; b++ )
+	{
+		uint64_t Start = NanoNow ();
+		for ( long i = 0; i < Count; i++ )
+			Bytes[b] = Filter.Trim ( b, &Msg[0], Msg.size (), &Out[b][0] );
+		TrimCost[b] = ( double ) ( NanoNow () - Start ) / Count;
+	}
+	// the sendto() of the full and the trimmed packets take turns, the
+	// best round counts, so a busy moment of the host does not
+	const int Rounds = 50;
+	double FullSend = 0;
+	double Send[BANDS] = { 0 };
+	for ( int r = 0; r < Rounds; r++ )
+	{
+		double Cost = SendCost ( Sender, &Msg[0], Msg.size (), To, Count / Rounds );
+		if ( ( r == 0 ) || ( Cost < FullSend ) )
+			FullSend = Cost;
+		for ( int b = 1; b < BANDS; b++ )
+		{
+			Cost = SendCost ( Sender, &Out[b][0], Bytes[b], To, Count / Rounds );
+			if ( ( r == 0 ) || ( Cost < Send[b] ) )
+				Send[b] = Cost;
+		}
+	}
+	printf ( "bands \"%s\", %ld packets of %d bytes\n", Bands, Count,
+	  ( int ) Msg.size () );
+	printf ( "full packet: %.0f ns per sendto(), uplink %ld Mbit/s\n",
+	  FullSend, Uplink );
+	printf ( "band  bytes  saved  trim ns  sendto ns  uplink ns saved"
+	  "  break-even receivers\n" );
+	for ( int b = 1; b < BANDS; b++ )
+	{
+		int Saved = ( int ) Msg.size () - Bytes[b];
+		double Wire = Saved * 8 * 1000.0 / Uplink;
+		double PerReceiver = Wire;
+		if ( FullSend > Send[b] )
+			PerReceiver += FullSend - Send[b];
+		printf ( "%4d  %5d  %5d  %7.0f  %9.0f  %15.0f  %.2f\n", b, Bytes[b],
+		  Saved, TrimCost[b], Send[b], Wire, TrimCost[b] / PerReceiver );
+	}
+	return 0;
+}
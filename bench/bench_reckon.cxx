@@ -0,0 +1,167 @@
+/**
+ * @file bench_reckon.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, replay of flights through the dead reckoning
+//
+//  Every flight is a random sequence of straight legs, turns and speed
+//  changes with some turbulence, sent at 10 packets per second. The
+//  velocities in the packets are off by up to 2 percent. The packets
+//  go through FG_LodPolicy::Forward() with bands of different errors. For every packet the position the receiver extrapolates
+//  from the last forwarded packet is compared to the real one.
+//
+//  The replay runs faster than real time, so reckon_silence never
+//  forces a packet here, see test_reckon for it.
+//
+//  usage: bench_reckon [flights]
+//  build with -DFGMS_BENCH=ON -DCMAKE_BUILD_TYPE=Release
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "fg_lod.hxx"
+#include "fg_bench.hxx"
+
+static uint32_t Seed = 1;
+
+/** xorshift, the same flights on every platform */
+static double
+Random ( double Min, double Max )
+{
+	Seed ^= Seed << 13;
+	Seed ^= Seed >> 17;
+	Seed ^= Seed << 5;
+	return Min + ( Max - Min ) * ( Seed / 4294967296.0 );
+}
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief The packets of one flight of about 10 minutes, the body frame
+ *        is rotated by the heading about the Z axis
+ */
+static std::vector<FG_Motion>
+Flight ()
+{
+	const double Step = 0.1;
+	std::vector<FG_Motion> Packets;
+	double X = 0, Y = 0, Heading = Random ( 0, 2 * M_PI );
+	double Speed = Random ( 60, 250 );
+	double T = 0;
+	while ( T < 600 )
+	{
+		double Length = Random ( 5, 60 );
+		double Turn   = ( Random ( 0, 1 ) < 0.5 ) ? 0 : Random ( -0.05, 0.05 );
+		double Accel  = ( Random ( 0, 1 ) < 0.7 ) ? 0 : Random ( -2, 2 );
+		for ( double End = T + Length; T < End; T += Step )
+		{
+			FG_Motion M = FG_Motion ();
+			M.Time = T;
+			M.Position[0] = 4000000 + X + Random ( -1, 1 );
+			M.Position[1] = Y + Random ( -1, 1 );
+			M.Position[2] = 4000000;
+			M.Orientation[2] = Heading;
+			M.LinearVel[0]   = Speed * Random ( 0.98, 1.02 );
+			M.LinearAccel[0] = Accel;
+			M.LinearAccel[1] = Speed * Turn * Random ( 0.98, 1.02 );
+			M.AngularVel[2]  = Turn * Random ( 0.98, 1.02 );
+			Packets.push_back ( M );
+			X += Speed * cos ( Heading ) * Step;
+			Y += Speed * sin ( Heading ) * Step;
+			Heading += Turn * Step;
+			Speed = std::max ( 30.0, Speed + Accel * Step );
+		}
+	}
+	return Packets;
+}
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Distance of the position the receiver extrapolates from Sent
+ *        to the real position of Now
+ */
+static double
+Miss ( const FG_Motion& Sent, const FG_Motion& Now )
+{
+	double Dt = Now.Time - Sent.Time;
+	double C  = cos ( Sent.Orientation[2] );
+	double S  = sin ( Sent.Orientation[2] );
+	double Vel[2]   = { C * Sent.LinearVel[0], S * Sent.LinearVel[0] };
+	double Accel[2] = { C * Sent.LinearAccel[0] - S * Sent.LinearAccel[1],
+	  S * Sent.LinearAccel[0] + C * Sent.LinearAccel[1] };
+	double Dx = Sent.Position[0] + Vel[0] * Dt + Accel[0] * Dt * Dt / 2 - Now.Position[0];
+	double Dy = Sent.Position[1] + Vel[1] * Dt + Accel[1] * Dt * Dt / 2 - Now.Position[1];
+	return sqrt ( Dx * Dx + Dy * Dy );
+}
+
+int
+main ( int argc, char* argv[] )
+{
+	long Flights = BenchArg ( argc, argv, 1, 20 );
+	std::vector< std::vector<FG_Motion> > Replay;
+	size_t Packets = 0;
+	for ( long f = 0; f < Flights; f++ )
+	{
+		Replay.push_back ( Flight () );
+		Packets += Replay.back ().size ();
+	}
+	printf ( "%ld flights, %lu packets\n", Flights, ( unsigned long ) Packets );
+	printf ( "error m  angle  suppressed  mean miss m  max miss m  ns per packet\n" );
+	const int Errors[] = { 10, 50, 200 };
+	const int Angles[] = { 0, 5 };
+	for ( int e = 0; e < 3; e++ )
+	{
+		for ( int a = 0; a < 2; a++ )
+		{
+			char Bands[32];
+			snprintf ( Bands, sizeof ( Bands ), "1000:0:%d", Errors[e] );
+			FG_LodPolicy Lod;
+			Lod.SetBands ( Bands );
+			Lod.SetAngle ( Angles[a] );
+			Lod.SetSilence ( 3600000 );
+			double Sum = 0, Max = 0;
+			uint64_t Cost = 0;
+			for ( long f = 0; f < Flights; f++ )
+			{
+				const std::vector<FG_Motion>& Track = Replay[f];
+				FG_Motion Sent = Track[0];
+				for ( size_t i = 0; i < Track.size (); i++ )
+				{
+					uint64_t Start = NanoNow ();
+					bool Forward = Lod.Forward ( f, 0, 50, Track[i] );
+					Cost += NanoNow () - Start;
+					if ( Forward )
+						Sent = Track[i];
+					double M = Miss ( Sent, Track[i] );
+					Sum += M;
+					if ( M > Max )
+						Max = M;
+				}
+			}
+			printf ( "%7d  %5d  %9.1f%%  %11.1f  %10.1f  %13.0f\n",
+			  Errors[e], Angles[a], 100.0 * Lod.Predicted / Packets,
+			  Sum / Packets, Max, ( double ) Cost / Packets );
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file bench_reject.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, throughput of rejecting malformed packets
+//
+//  A flood of bad packets goes through Decode(), PacketIsValid() and
+//  AddBadClient(). Once a sender is known, AddBadClient() neither
+//  searches the player list nor builds the error message. The
+//  benchmark prints packets per second for each kind of bad packet,
+//  and for comparison the cost of the error message.
+//
+//  usage: bench_reject [packets]
+//  build with -DFGMS_BENCH=ON -DCMAKE_BUILD_TYPE=Release
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <vector>
+#include "fg_server.hxx"
+#include "fg_packet.hxx"
+#include "fg_bench.hxx"
+
+// defined by main.cxx, which is not part of the benchmark
+void ReloadConfig () {}
+
+/** @brief FG_SERVER with the packet checks made accessible */
+class BenchServer : public FG_SERVER
+{
+public:
+	using FG_SERVER::PacketIsValid;
+	using FG_SERVER::PacketErrorMsg;
+	using FG_SERVER::AddBadClient;
+};
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Reject the first Bytes of Msg Count times, print the result
+ */
+static void
+Reject ( BenchServer& Server, const char* Name, const std::vector<char>& Msg,
+  int Bytes, long Count )
+{
+	static const netAddress Sender ( "192.0.2.1", 5000 );
+	FG_PlayerState State;
+	size_t Valid = 0;
+	uint64_t Start = NanoNow ();
+	for ( long i = 0; i < Count; i++ )
+	{
+		State.Decode ( &Msg[0], Bytes );
+		int Error = Server.PacketIsValid ( Bytes, State );
+		if ( Error == FG_SERVER::PACKET_VALID )
+		{
+			Valid++;
+			continue;
+		}
+		Server.AddBadClient ( Sender, Error, State, true, Bytes );
+	}
+	double Cost = ( double ) ( NanoNow () - Start ) / Count;
+	if ( Valid != 0 )
+		printf ( "unexpected\n" );
+	printf ( "%-15s %6.1f ns per packet, %6.2f M packets/s\n",
+	  Name, Cost, 1000.0 / Cost );
+}
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Nanoseconds of one PacketErrorMsg(), the price of building
+ *        the message for every bad packet
+ */
+static double
+MessageCost ( BenchServer& Server, const std::vector<char>& Msg, long Count )
+{
+	static const netAddress Sender ( "192.0.2.1", 5000 );
+	FG_PlayerState State;
+	State.Decode ( &Msg[0], Msg.size () );
+	int Error = Server.PacketIsValid ( Msg.size (), State );
+	size_t Length = 0;
+	uint64_t Start = NanoNow ();
+	for ( long i = 0; i < Count; i++ )
+		Length += Server.PacketErrorMsg ( Error, State, Sender ).size ();
+	double Cost = ( double ) ( NanoNow () - Start ) / Count;
+	// use the result, so that the loop is not optimized away
+	if ( Length == 0 )
+		printf ( "unexpected\n" );
+	return Cost;
+}
+
+int
+main ( int argc, char* argv[] )
+{
+	long Count = BenchArg ( argc, argv, 1, 10000000 );
+	const double Pos[3] = { 4000000.0, 3000000.0, 3500000.0 };
+	const float  Vel[3] = { 100.0f, 0.0f, -5.0f };
+	std::vector<char> Props;
+	for ( uint32_t Id = 100; Id < 200; Id++ )
+		Word ( Props, ( Id << 16 ) | 1 );
+	std::vector<char> Msg = Packet ( Props );
+	SetPosition ( Msg, Pos, Vel, 1.0 );
+	std::vector<char> Magic ( Msg );
+	( ( T_MsgHdr* ) &Magic[0] )->Magic = XDR_encode<uint32_t> ( 0x12345678 );
+	std::vector<char> Version ( Msg );
+	( ( T_MsgHdr* ) &Version[0] )->Version = XDR_encode<uint32_t> ( 0x00FF00FF );
+
+	BenchServer Server;
+	sglog().setLogLevels ( SG_ALL, SG_ALERT );
+	printf ( "%ld packets of each kind\n", Count );
+	Reject ( Server, "too small:", Msg, sizeof ( T_MsgHdr ) - 1, Count );
+	Reject ( Server, "bad magic:", Magic, Magic.size (), Count );
+	Reject ( Server, "bad version:", Version, Version.size (), Count );
+	Reject ( Server, "short position:", Msg, Fixed - 1, Count );
+	printf ( "error message:  %6.1f ns per packet, if it was built each time\n",
+	  MessageCost ( Server, Magic, Count / 10 ) );
+	return 0;
+}
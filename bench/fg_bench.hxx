@@ -0,0 +1,53 @@
+/**
+ * @file fg_bench.hxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, helpers of the benchmarks
+//
+//////////////////////////////////////////////////////////////////////
+
+#if !defined FG_BENCH_HXX
+#define FG_BENCH_HXX
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+/** a monotonic clock in nanoseconds */
+inline uint64_t
+NanoNow ()
+{
+	struct timespec Now;
+	clock_gettime ( CLOCK_MONOTONIC, &Now );
+	return ( uint64_t ) Now.tv_sec * 1000000000ULL + Now.tv_nsec;
+}
+
+/** the n-th argument as a positive number, Default if it is missing */
+inline long
+BenchArg ( int argc, char* argv[], int n, long Default )
+{
+	if ( argc <= n )
+		return Default;
+	long Value = atol ( argv[n] );
+	return ( Value > 0 ) ? Value : Default;
+}
+
+#endif
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+
+# A minimal FGTracker for testing. It accepts a connection of fgms,
+# acknowledges its messages and prints how many records and bytes it
+# received, so the text and the binary protocol can be compared.
+#
+# usage: fgtracker_recv.py [--port 8000] [--binary] [--interval 10] [--dump]
+#
+# Point server.tracking_server/tracking_port of fgms to it. With --binary
+# it accepts the binary framing if fgms offers it (server.tracking_binary).
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+FRAME_MARK = 0x01
+REC_TEXT = 0
+REC_POSITION = 1
+DATA = (b"CONNECT ", b"DISCONNECT ", b"POSITION ")
+
+
+class Stats:
+    def __init__(self):
+        self.start = time.time()
+        self.bytes = 0
+        self.messages = 0
+        self.records = 0
+
+    def show(self, mode):
+        secs = max(time.time() - self.start, 1e-6)
+        per_rec = self.bytes / self.records if self.records else 0
+        print("%s: %d messages, %d records, %d bytes in %.1f s: "
+              "%.0f records/s, %.0f bytes/s, %.1f bytes/record"
+              % (mode, self.messages, self.records, self.bytes, secs,
+                 self.records / secs, self.bytes / secs, per_rec))
+        sys.stdout.flush()
+
+
+def decode_frame(payload, dump):
+    """return the number of records of a binary frame"""
+    pos = 0
+    records = 0
+    while pos < len(payload):
+        rtype, rlen = struct.unpack_from("!BH", payload, pos)
+        body = payload[pos + 3:pos + 3 + rlen]
+        pos += 3 + rlen
+        records += 1
+        if not dump:
+            continue
+        if rtype == REC_POSITION:
+            lat, lon, alt, hdg, pitch, roll, t = struct.unpack_from("!6iI", body)
+            n = body[28]
+            name = body[29:29 + n].decode(errors="replace")
+            p = body[29 + n]
+            passwd = body[30 + n:30 + n + p].decode(errors="replace")
+            print("POSITION %s %s %.6f %.6f %.3f %.6f %.6f %.6f %s"
+                  % (name, passwd, lat / 1e6, lon / 1e6, alt / 1e3,
+                     hdg / 1e6, pitch / 1e6, roll / 1e6,
+                     time.strftime("%Y-%m-%d %H:%M:%S", time.gmtime(t))))
+        else:
+            print(body.decode(errors="replace"))
+    return records
+
+
+def serve(conn, args, stats):
+    buf = b""
+    binary = False
+    last = time.time()
+    while True:
+        data = conn.recv(65536)
+        if not data:
+            return
+        stats.bytes += len(data)
+        buf += data
+        while buf:
+            if buf[0] == FRAME_MARK:
+                if len(buf) < 5:
+                    break
+                (length,) = struct.unpack_from("!I", buf, 1)
+                if len(buf) < 5 + length:
+                    break
+                stats.records += decode_frame(buf[5:5 + length], args.dump)
+                stats.messages += 1
+                buf = buf[5 + length:]
+                conn.sendall(b"OK\0")
+                continue
+            end = buf.find(b"\0")
+            if end < 0:
+                break
+            msg, buf = buf[:end], buf[end + 1:]
+            if msg.startswith(b"V"):
+                conn.sendall(b"IDENTIFIED\0")
+            elif msg == b"BINARY 1":
+                if args.binary:
+                    binary = True
+                    conn.sendall(b"BINARY 1\0")
+            elif msg == b"PING":
+                conn.sendall(b"PONG\0")
+            elif msg.startswith(DATA):
+                stats.messages += 1
+                stats.records += msg.count(b"\n") + 1
+                if args.dump:
+                    print(msg.decode(errors="replace"))
+                conn.sendall(b"OK\0")
+        if time.time() - last >= args.interval:
+            stats.show("binary" if binary else "text")
+            last = time.time()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="reference FGTracker receiver")
+    parser.add_argument("--port", type=int, default=8000)
+    parser.add_argument("--binary", action="store_true",
+                        help="accept the binary framing")
+    parser.add_argument("--interval", type=float, default=10,
+                        help="seconds between statistics")
+    parser.add_argument("--dump", action="store_true",
+                        help="print every record")
+    args = parser.parse_args()
+    listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind(("", args.port))
+    listener.listen(1)
+    while True:
+        conn, peer = listener.accept()
+        print("connection from %s:%d" % peer)
+        stats = Stats()
+        try:
+            serve(conn, args, stats)
+        except (ConnectionError, struct.error) as e:
+            print("connection closed: %s" % e)
+        stats.show("total")
+        conn.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -68,6 +68,43 @@
  * 
  * @see FG_SERVER::SetHub and \ref mp_network
  * 
+ * \subsection server_batch_io server.batch_io
+ * \code 
+ * server.batch_io = false
+ * \endcode
+ * - If set to \b true, bursts of datagrams are read with one recvmmsg() call and
+ *   a packet is sent to all its receivers with one sendmmsg() call
+ * - Only available on linux, ignored elsewhere
+ * @see FG_SERVER::SetBatchIO
+ * 
+ * \subsection server_worker_threads server.worker_threads
+ * \code 
+ * server.worker_threads = 1
+ * \endcode
+ * - Number of threads reading the data port. Every thread binds its own
+ *   socket to \b server.port (SO_REUSEPORT), the kernel distributes the clients
+ * - Packet rates of every thread are shown in the statistics
+ * @see FG_SERVER::SetWorkerThreads
+ * 
+ * \subsection server_rate_limit server.rate_limit
+ * \code 
+ * server.rate_limit = 0
+ * server.rate_burst = 0
+ * server.rate_escalate = 10
+ * server.rate_block_time = 60
+ * \endcode
+ * - \b rate_limit is the maximum number of packets per second accepted from a
+ *   single IP, excess packets are dropped before any other processing.
+ *   0 disables rate limiting
+ * - \b rate_burst is the number of packets an IP may send at once,
+ *   0 allows two seconds worth of packets
+ * - An IP exceeding the limit for \b rate_escalate seconds in a row is
+ *   blacklisted for \b rate_block_time seconds. The time doubles with every
+ *   repeated offence. 0 never blacklists
+ * - Relays and whitelisted IPs are not limited
+ * - Dropped packets are shown as RL in the statistics
+ * @see FG_SERVER::SetRateLimit
+ * 
 * 
  * \subsection server_logfile server.logfile
  * \code 
@@ -92,7 +129,83 @@
  * \endcode
  * - Distance in nautical miles 
  * - Only forward data to clients which are really nearby the sender (in virtual space)
- * @see FG_SERVER::SetOutOfReach and FG_SERVER::IsInRange
+ * @see FG_SERVER::SetOutOfReach and FG_RelayScheduler
+ * 
+ * \subsection server_lod_bands server.lod_bands
+ * \code 
+ * server.lod_bands = 10:0 40:10 100:2
+ * \endcode
+ * - A list of distance bands \b range:rate, range in nautical miles, rate
+ *   in position packets per second
+ * - A client gets at most \b rate packets per second from each sender within
+ *   \b range, 0 means every packet. Senders beyond the last band are limited
+ *   by the rate of the last band
+ * - The example forwards every packet within 10 nm, 10 packets/s up to
+ *   40 nm and 2 packets/s beyond
+ * - Not set (the default) forwards every packet
+ * - Packets not forwarded are shown as LOD in the statistics
+ * @see FG_SERVER::SetLodBands and FG_LodPolicy
+ * 
+ * \subsection server_reckon server.reckon_angle / server.reckon_silence
+ * \code 
+ * server.lod_bands = 10:0 40:10:20 100:2:100
+ * server.reckon_angle = 5
+ * server.reckon_silence = 1000
+ * \endcode
+ * - A band of \ref server_lod_bands may have a third field, an error in meters.
+ *   Clients within such a band only get a packet if they can not predict it
+ *   from the last packet they got (dead reckoning): the position extrapolated
+ *   with the velocity and acceleration is further away than the error from
+ *   the real position, or the orientation turned by the angular velocity
+ *   differs more than \b reckon_angle degrees from the real one
+ * - \b reckon_angle 0 only checks the position
+ * - A client gets at least one packet per \b reckon_silence milliseconds
+ *   of every sender, so properties like lights and chat get through
+ * - Packets not forwarded are shown after the slash of LOD in the statistics
+ * @see FG_SERVER::SetReckonAngle, FG_SERVER::SetReckonSilence and FG_LodPolicy
+ * 
+ * \subsection server_property_bands server.property_bands
+ * \code 
+ * server.property_bands = 20:* 60:100-199,10002 100:10002
+ * \endcode
+ * - A list of distance bands \b range:ids, range in nautical miles, ids a comma
+ *   separated list of property IDs or ranges of IDs, \b * for all properties
+ * - A client gets only the listed properties of senders within \b range.
+ *   Senders beyond the last band are treated like the last band
+ * - The example forwards all properties within 20 nm, the surface
+ *   positions and chat up to 60 nm, and only chat beyond
+ * - An empty list of IDs forwards only the position
+ * - Not set (the default) forwards all properties
+ * - Trimmed packets are shown as PF in the statistics, after the slash packets
+ *   which were forwarded as they are, because their properties were not understood
+ * @see FG_SERVER::SetPropertyBands and FG_PropertyFilter
+ * 
+ * \subsection server_tick_rate server.tick_rate
+ * \code 
+ * server.tick_rate = 20
+ * \endcode
+ * - Forward position packets \b tick_rate times per second instead of at once
+ * - Only the newest packet a client sent since the last tick is forwarded,
+ *   older ones are dropped, so no client gets more than \b tick_rate
+ *   packets per second of a sender
+ * - Adds up to 1 / \b tick_rate seconds of latency
+ * - 0 (the default) forwards every packet at once
+ * - Forwarded and superseded packets are shown as TK in the statistics
+ * @see FG_SERVER::SetTickRate
+ * 
+ * \subsection server_egress_queue server.egress_queue
+ * \code 
+ * server.egress_queue = 32
+ * \endcode
+ * - If the send buffer of the data port is full, packets are queued for
+ *   their receiver and sent as soon as the buffer has room again
+ * - At most \b egress_queue packets are queued per receiver. A newer
+ *   position of the same sender replaces a queued one, otherwise the
+ *   oldest packet is dropped
+ * - 0 drops packets which can not be sent at once
+ * - Queued, superseded, dropped packets and other send errors are shown
+ *   as EQ in the statistics, per receiver in the stats of the admin CLI
+ * @see FG_SERVER::SetEgressQueue and FG_Egress
  * 
  * \subsection server_playerexfpires server.playerexpires
  * \code 
@@ -124,6 +237,18 @@
  * 
  * @see ::FG_SERVER::AddRelay
  * 
+ * \subsection relay_budget server.relay_budget
+ * \code
+ * server.relay_budget = 0
+ * \endcode
+ * - A relay gets every packet of a player only if a pilot behind the relay has the
+ *   player within its radar range. Players within 200 nm of a pilot are sent with
+ *   5 packets/s, within 1000 nm with 1 packet/s, all others every 5 seconds
+ * - \b relay_budget limits the bytes per second sent to each relay for players which
+ *   are not in range. Players in range are always sent. 0 means unlimited
+ * - The packets sent per tier are shown by the \b show relay command
+ * @see ::FG_SERVER::SetRelayBudget
+ * 
  * 
  * 
  * 
@@ -149,8 +274,10 @@
  * \code
  * blacklist = 123.123.123.123
  * blacklist = 12.12.12.12
+ * blacklist = 10.20.0.0/16
  * \endcode
  * - Blacklisted IPs will ignore all traffic comming from the given IP.
+ * - A network in CIDR notation blocks all of its IPs.
  * 
  * @see ::FG_SERVER::AddBlacklist
  * 
@@ -180,5 +307,40 @@
  * - Enter the port number of the tracking server
  * @see ::FG_SERVER::AddTracker
  * 
+ * \subsection tracking_window server.tracking_window
+ * \code
+ * server.tracking_window = 25
+ * \endcode
+ * - Number of messages sent to the tracking server before it has to
+ *   acknowledge them. Raise it if the tracker lags behind on busy servers
+ * @see ::FG_SERVER::SetTrackerWindow
+ * 
+ * \subsection tracking_delta server.tracking_delta
+ * \code
+ * server.tracking_delta = 0
+ * \endcode
+ * - Only report the position of a player to the tracking server if it moved
+ *   at least this many meters since it was reported last. 0 reports all players
+ * @see ::FG_SERVER::SetTrackerDelta
+ * 
+ * \subsection tracking_binary server.tracking_binary
+ * \code
+ * server.tracking_binary = false
+ * \endcode
+ * - Offer the tracking server to send messages in compact binary frames.
+ *   If the tracking server does not accept the offer, the text protocol is used.
+ *   contrib/tools/fgtracker_recv.py is a receiver to compare both protocols
+ * @see ::FG_SERVER::SetTrackerBinary
+ * 
+ * \subsection tracking_journal server.tracking_journal
+ * \code
+ * server.tracking_journal = tracker_journal
+ * \endcode
+ * - Directory of the journal, which keeps the messages for the tracking server
+ *   on disk until it acknowledged them. After a restart, fgms resumes with the
+ *   first message which was not acknowledged. A relative path is relative to
+ *   the working directory. Set it to \b off to keep the messages in memory
+ * @see ::FG_SERVER::SetTrackerJournal
+ * 
  * 
  */
\ No newline at end of file
@@ -79,6 +79,9 @@
  * the following options exist to reduce overall server/network load:
  * - Configure a relatively low \ref server_out_of_reach value, so that clients 
  *   outside a certain range are not provided with updates (usually about 100 nm on the main server network)
+ * - Configure \ref server_lod_bands, so that far away clients get less updates per second
+ * - Configure \ref server_property_bands, so that far away clients get smaller updates
+ * - Configure \ref server_tick_rate, so that clients sending very often are forwarded at a fixed rate
  * - For virtual gatherings (i.e. fly-ins), have clients use airports and places that do not 
  *   have lots of other traffic (i.e. in other words, avoid places like standard airports such as KSFO)
  * - Avoid the use of unnecessary relay servers
@@ -62,6 +62,12 @@
 	#define MSG_NOSIGNAL 0
 #endif
 
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+	#define NET_HAVE_MMSG 1
+	/* number of messages passed to the kernel in one call */
+	#define NET_MMSG_BATCH 64
+#endif
+
 #ifdef _MSC_VER
 #include <libmsc/msc_unistd.hxx>
 #endif
@@ -388,6 +394,63 @@ int netSocket::sendto ( const void * buffer, int size,
                          (const sockaddr*)to,sizeof(netAddress));
 }
 
+
+/*
+ * Send the same datagram to 'count' addresses. Uses sendmmsg() where
+ * available. Stops at the first address which fails, errno tells why.
+ * Returns the number of datagrams sent, the caller may go on with
+ * to[sent + 1].
+ */
+int netSocket::sendto_many ( const void * buffer, int size, int flags,
+                             const netAddress* to, int count )
+{
+  assert ( handle != -1 ) ;
+#ifdef NET_HAVE_MMSG
+  struct mmsghdr msgs [ NET_MMSG_BATCH ] ;
+  struct iovec   iov ;
+  int            sent = 0 ;
+  iov.iov_base = (void*) buffer ;
+  iov.iov_len  = size ;
+  while ( sent < count )
+  {
+    int num = count - sent ;
+    if ( num > NET_MMSG_BATCH )
+      num = NET_MMSG_BATCH ;
+    memset ( msgs, 0, num * sizeof(struct mmsghdr) ) ;
+    for ( int i = 0; i < num; i++ )
+    {
+      msgs[i].msg_hdr.msg_iov     = &iov ;
+      msgs[i].msg_hdr.msg_iovlen  = 1 ;
+      msgs[i].msg_hdr.msg_name    = (void*) &to[sent + i] ;
+      msgs[i].msg_hdr.msg_namelen = sizeof(netAddress) ;
+    }
+    // a partial batch drops the error, the next call reports it
+    int n = ::sendmmsg ( handle, msgs, num, flags ) ;
+    if ( n < 0 )
+      return sent ;
+    sent += n ;
+  }
+  return sent ;
+#else
+  for ( int i = 0; i < count; i++ )
+  {
+    if ( sendto ( buffer, size, flags, &to[i] ) < 0 )
+      return i ;
+  }
+  return count ;
+#endif
+}
+
+
+bool netSocket::hasBatchIO ()
+{
+#ifdef NET_HAVE_MMSG
+  return true ;
+#else
+  return false ;
+#endif
+}
+
 int netSocket::read_char ( unsigned char& c )
 {
 	int n {0};
@@ -421,6 +484,46 @@ int netSocket::recvfrom ( void * buffer, int size,
 }
 
 
+/*
+ * Receive up to 'count' datagrams without blocking. Datagram i is
+ * stored at buffers + i*size, its length in lengths[i] and the sender
+ * in from[i]. Uses a single recvmmsg() where available.
+ * Returns the number of datagrams received, or -1 on error.
+ */
+int netSocket::recvfrom_many ( char* buffers, int size, int count,
+                               int* lengths, netAddress* from )
+{
+  assert ( handle != -1 ) ;
+#ifdef NET_HAVE_MMSG
+  struct mmsghdr msgs [ NET_MMSG_BATCH ] ;
+  struct iovec   iovs [ NET_MMSG_BATCH ] ;
+  if ( count > NET_MMSG_BATCH )
+    count = NET_MMSG_BATCH ;
+  memset ( msgs, 0, count * sizeof(struct mmsghdr) ) ;
+  for ( int i = 0; i < count; i++ )
+  {
+    iovs[i].iov_base = buffers + i * size ;
+    iovs[i].iov_len  = size ;
+    msgs[i].msg_hdr.msg_iov     = &iovs[i] ;
+    msgs[i].msg_hdr.msg_iovlen  = 1 ;
+    msgs[i].msg_hdr.msg_name    = &from[i] ;
+    msgs[i].msg_hdr.msg_namelen = sizeof(netAddress) ;
+  }
+  int n = ::recvmmsg ( handle, msgs, count, MSG_DONTWAIT, 0 ) ;
+  for ( int i = 0; i < n; i++ )
+    lengths[i] = msgs[i].msg_len ;
+  return n ;
+#else
+  if ( count < 1 )
+    return 0 ;
+  lengths[0] = recvfrom ( buffers, size, 0, &from[0] ) ;
+  if ( lengths[0] < 0 )
+    return -1 ;
+  return 1 ;
+#endif
+}
+
+
 void netSocket::close (void)
 {
   if ( handle != -1 )
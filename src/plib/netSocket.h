@@ -150,11 +150,16 @@ public:
   int	read_char   ( unsigned char& c);
   int   recv        ( void * buffer, int size, int flags = 0 ) ;
   int   recvfrom    ( void * buffer, int size, int flags, netAddress* from ) ;
+  int   recvfrom_many ( char* buffers, int size, int count, int* lengths,
+                        netAddress* from ) ;
+  int   sendto_many ( const void * buffer, int size, int flags,
+                      const netAddress* to, int count ) ;
 
   void setSockOpt ( int SocketOption, bool Set );
   void setBlocking ( bool blocking ) ;
   void setBroadcast ( bool broadcast ) ;
 
+  static bool hasBatchIO () ;
   static bool isNonBlockingError () ;
   static int select ( netSocket** reads, netSocket** writes, int timeout ) ;
 } ;
@@ -0,0 +1,323 @@
+/**
+ * @file fg_blacklist.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, blacklist with constant time lookup
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+
+#include <algorithm>
+#include <simgear/debug/logstream.hxx>
+#include "fg_blacklist.hxx"
+#ifndef _MSC_VER
+	#include <arpa/inet.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////
+FG_BlackList::FG_BlackList ( const std::string& Name ) : m_List ( Name )
+{
+	this->Name	= Name;
+	PktsRcvd	= 0;
+	BytesRcvd	= 0;
+	pthread_mutex_init ( &m_IndexMutex, 0 );
+	m_Index = IndexPtr ( new Index );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+FG_BlackList::~FG_BlackList ()
+{
+	pthread_mutex_destroy ( &m_IndexMutex );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Add an entry to the list and to the index
+ * @param Element the entry, Element.Address is the blocked IP or the
+ *        address of the blocked network
+ * @param TTL time to live in seconds after the last blocked packet,
+ *        0 means the entry never expires
+ * @param Bits length of the network prefix, 32 blocks a single IP
+ * @return the ID of the new entry
+ */
+size_t
+FG_BlackList::Add ( FG_ListElement& Element, time_t TTL, int Bits )
+{
+	Info	I;
+	time_t	Now = time ( 0 );
+
+	if ( ( Bits < 0 ) || ( Bits > 32 ) )
+		Bits = 32;
+	size_t ID	= m_List.Add ( Element, TTL );
+	I.Net		= ntohl ( Element.Address.getIP () ) & Mask ( Bits );
+	I.Bits		= Bits;
+	I.TTL		= TTL;
+	I.Counters	= HitsPtr ( new Hits ( Now ) );
+	pthread_mutex_lock ( &m_IndexMutex );
+	m_Info[ID] = I;
+	if ( TTL != 0 )
+	{
+		m_Timers.push ( Timer ( Now + TTL, ID ) );
+	}
+	Rebuild ();
+	pthread_mutex_unlock ( &m_IndexMutex );
+	return ID;
+} // FG_BlackList::Add ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+ItList
+FG_BlackList::Delete ( const ItList& Element )
+{
+	Forget ( Element->ID );
+	return m_List.Delete ( Element );
+} // FG_BlackList::Delete ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_BlackList::DeleteByPosition ( int position )
+{
+	Forget ( m_List[position].ID );
+	m_List.DeleteByPosition ( position );
+} // FG_BlackList::DeleteByPosition ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_BlackList::Clear ()
+{
+	m_List.Clear ();
+	pthread_mutex_lock ( &m_IndexMutex );
+	m_Info.clear ();
+	m_Timers = TimerHeap ();
+	Rebuild ();
+	pthread_mutex_unlock ( &m_IndexMutex );
+} // FG_BlackList::Clear ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Return a copy of the entry at Index. The counters of blocked
+ *        packets are only kept in the index, they are copied into
+ *        the returned entry.
+ */
+FG_ListElement
+FG_BlackList::operator [] ( const size_t& Index )
+{
+	FG_ListElement E = m_List[Index];
+	pthread_mutex_lock ( &m_IndexMutex );
+	std::map<size_t,Info>::iterator I = m_Info.find ( E.ID );
+	if ( I != m_Info.end() )
+	{
+		E.LastSeen  = I->second.Counters->LastSeen.load ();
+		E.PktsRcvd  = I->second.Counters->PktsRcvd.load ();
+		E.BytesRcvd = I->second.Counters->BytesRcvd.load ();
+	}
+	pthread_mutex_unlock ( &m_IndexMutex );
+	return E;
+} // FG_BlackList::operator [] ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Lengthen the TTL of entry ID, eg. for a repeated offence. A
+ *        shorter TTL is ignored, the timer of the entry picks up the
+ *        new TTL when it is due.
+ * @param TTL time to live in seconds after the last blocked packet,
+ *        0 means the entry never expires
+ */
+void
+FG_BlackList::Extend ( size_t ID, time_t TTL )
+{
+	pthread_mutex_lock ( &m_IndexMutex );
+	std::map<size_t,Info>::iterator I = m_Info.find ( ID );
+	if ( ( I != m_Info.end() ) && ( I->second.TTL != 0 )
+	&&   ( ( TTL == 0 ) || ( TTL > I->second.TTL ) ) )
+	{
+		I->second.TTL = TTL;
+	}
+	pthread_mutex_unlock ( &m_IndexMutex );
+} // FG_BlackList::Extend ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @return the prefix length of the network blocked by entry ID,
+ *         32 for a single IP
+ */
+int
+FG_BlackList::PrefixLength ( size_t ID )
+{
+	int Bits = 32;
+	pthread_mutex_lock ( &m_IndexMutex );
+	std::map<size_t,Info>::iterator I = m_Info.find ( ID );
+	if ( I != m_Info.end() )
+	{
+		Bits = I->second.Bits;
+	}
+	pthread_mutex_unlock ( &m_IndexMutex );
+	return Bits;
+} // FG_BlackList::PrefixLength ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** thread safe, lock free
+ *
+ * Check if Address is blocked. If it is, the packet is counted for
+ * the matching entry, which also delays its expiry, and for the list.
+ * @param Address the sender of a packet
+ * @param Bytes size of the packet
+ * @retval true if the address is blocked
+ */
+bool
+FG_BlackList::IsBlocked ( const netAddress& Address, size_t Bytes )
+{
+	IndexPtr Current = std::atomic_load ( &m_Index );
+	if ( Current->Networks.empty() )
+		return false;
+	uint32_t IP = ntohl ( Address.getIP () );
+	for ( size_t i = 0; i < Current->Lengths.size(); i++ )
+	{
+		int Bits = Current->Lengths[i];
+		std::unordered_map<uint64_t,HitsPtr>::const_iterator N;
+		N = Current->Networks.find ( Key ( IP & Mask ( Bits ), Bits ) );
+		if ( N == Current->Networks.end() )
+			continue;
+		N->second->LastSeen.store ( time ( 0 ), std::memory_order_relaxed );
+		N->second->PktsRcvd.fetch_add ( 1, std::memory_order_relaxed );
+		N->second->BytesRcvd.fetch_add ( Bytes, std::memory_order_relaxed );
+		PktsRcvd.fetch_add ( 1, std::memory_order_relaxed );
+		BytesRcvd.fetch_add ( Bytes, std::memory_order_relaxed );
+		return true;
+	}
+	return false;
+} // FG_BlackList::IsBlocked ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Delete all entries whose TTL is exceeded. Only the timers
+ *        which are due are visited. A timer of an entry which blocked
+ *        packets since it was set is set again.
+ * @param Now the current time
+ */
+void
+FG_BlackList::Expire ( time_t Now )
+{
+	std::vector<size_t> Expired;
+	pthread_mutex_lock ( &m_IndexMutex );
+	while ( ( ! m_Timers.empty() ) && ( m_Timers.top().first <= Now ) )
+	{
+		Timer T = m_Timers.top ();
+		m_Timers.pop ();
+		std::map<size_t,Info>::iterator I = m_Info.find ( T.second );
+		if ( ( I == m_Info.end() ) || ( I->second.TTL == 0 ) )
+			continue;	// already deleted or made permanent
+		time_t Due = I->second.Counters->LastSeen.load () + I->second.TTL;
+		if ( Due > Now )
+		{
+			m_Timers.push ( Timer ( Due, T.second ) );
+			continue;
+		}
+		Expired.push_back ( T.second );
+	}
+	pthread_mutex_unlock ( &m_IndexMutex );
+	for ( size_t i = 0; i < Expired.size(); i++ )
+	{
+		m_List.Lock ();
+		ItList Entry = m_List.FindByID ( Expired[i] );
+		m_List.Unlock ();
+		if ( Entry == m_List.End() )
+			continue;
+		SG_LOG ( SG_FGMS, SG_INFO,
+		  Name << ": TTL exceeded for "
+		  << Entry->Name << "@"
+		  << Entry->Address.getHost() << " "
+		);
+		Delete ( Entry );
+	}
+} // FG_BlackList::Expire ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+uint32_t
+FG_BlackList::Mask ( int Bits )
+{
+	if ( Bits <= 0 )
+		return 0;
+	return ( uint32_t ) ( 0xFFFFFFFFULL << ( 32 - Bits ) );
+} // FG_BlackList::Mask ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+uint64_t
+FG_BlackList::Key ( uint32_t Net, int Bits )
+{
+	return ( ( uint64_t ) Bits << 32 ) | Net;
+} // FG_BlackList::Key ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Remove entry ID from the index. Its timer is dropped when
+ *        it is due.
+ */
+void
+FG_BlackList::Forget ( size_t ID )
+{
+	pthread_mutex_lock ( &m_IndexMutex );
+	if ( m_Info.erase ( ID ) != 0 )
+	{
+		Rebuild ();
+	}
+	pthread_mutex_unlock ( &m_IndexMutex );
+} // FG_BlackList::Forget ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Build a new index from m_Info and make it the current one.
+ *        Called with m_IndexMutex held.
+ */
+void
+FG_BlackList::Rebuild ()
+{
+	Index* New = new Index;
+	std::map<size_t,Info>::const_iterator I;
+	for ( I = m_Info.begin(); I != m_Info.end(); I++ )
+	{
+		New->Networks[Key ( I->second.Net, I->second.Bits )] = I->second.Counters;
+		if ( std::find ( New->Lengths.begin(), New->Lengths.end(),
+		  I->second.Bits ) == New->Lengths.end() )
+		{
+			New->Lengths.push_back ( I->second.Bits );
+		}
+	}
+	std::sort ( New->Lengths.begin(), New->Lengths.end(), std::greater<int>() );
+	std::atomic_store ( &m_Index, IndexPtr ( New ) );
+} // FG_BlackList::Rebuild ()
+//////////////////////////////////////////////////////////////////////
+
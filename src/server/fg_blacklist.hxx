@@ -0,0 +1,136 @@
+/**
+ * @file fg_blacklist.hxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, blacklist with constant time lookup
+//
+//////////////////////////////////////////////////////////////////////
+
+#if !defined FG_BLACKLIST_HXX
+#define FG_BLACKLIST_HXX
+
+#include <map>
+#include <queue>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include "fg_list.hxx"
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @class FG_BlackList
+ * @brief The list of blocked IPs, with an index for the packet path
+ *
+ * The entries are kept in a FG_List as before (for the CLI), but the
+ * packet path only uses an index of the blocked networks. The list is
+ * private, all changes go through the methods below, so the index
+ * always matches the list. The index
+ * is a hash table of networks, keyed by network address and prefix
+ * length, so a lookup costs one probe per prefix length in use.
+ * Single IPs are networks with a prefix length of 32.
+ *
+ * The index is never modified. Every change of the list builds a new
+ * index, which replaces the current one (read-copy-update), so
+ * IsBlocked() neither takes a lock nor is blocked by writers.
+ *
+ * Entries with a TTL are kept in a timer heap ordered by the time they
+ * expire. An entry expires TTL seconds after the last packet which
+ * was blocked by it, so only the entries which are due are looked at.
+ */
+class FG_BlackList
+{
+public:
+	FG_BlackList ( const std::string& Name );
+	~FG_BlackList ();
+	/** number of entries */
+	size_t	Size () { return m_List.Size (); }
+	/** lock the list, needed around Find() and FindByID() */
+	void	Lock () { m_List.Lock (); }
+	void	Unlock () { m_List.Unlock (); }
+	/** find an entry by its IP address */
+	ItList	Find ( const netAddress& Address, const std::string& Name = "" )
+		{ return m_List.Find ( Address, Name ); }
+	/** find an entry by its ID */
+	ItList	FindByID ( size_t ID ) { return m_List.FindByID ( ID ); }
+	ItList	End () { return m_List.End (); }
+	/** add an entry blocking Element.Address/Bits */
+	size_t	Add ( FG_ListElement& Element, time_t TTL, int Bits = 32 );
+	/** delete an entry */
+	ItList	Delete ( const ItList& Element );
+	/** delete the entry at position */
+	void	DeleteByPosition ( int position );
+	/** delete all entries */
+	void	Clear ();
+	/** copy of the entry at Index, with up to date counters */
+	FG_ListElement operator [] ( const size_t& Index );
+	/** block entry ID for at least TTL seconds, 0 = forever */
+	void	Extend ( size_t ID, time_t TTL );
+	/** prefix length of the network blocked by entry ID */
+	int	PrefixLength ( size_t ID );
+	/** true if Address is blocked, counts the packet (lock free) */
+	bool	IsBlocked ( const netAddress& Address, size_t Bytes );
+	/** delete all entries whose TTL is exceeded */
+	void	Expire ( time_t Now );
+	/** @brief name of the list */
+	std::string		Name;
+	/** @brief packets and bytes blocked, counted by IsBlocked() */
+	std::atomic<uint64_t>	PktsRcvd;
+	std::atomic<uint64_t>	BytesRcvd;
+private:
+	/** @brief counters of an entry, updated by IsBlocked() */
+	typedef struct st_hits
+	{
+		st_hits ( time_t Now ) : LastSeen ( Now ), PktsRcvd ( 0 ), BytesRcvd ( 0 ) {}
+		std::atomic<time_t>	LastSeen;
+		std::atomic<uint64_t>	PktsRcvd;
+		std::atomic<uint64_t>	BytesRcvd;
+	} Hits;
+	typedef std::shared_ptr<Hits>	HitsPtr;
+	typedef struct
+	{
+		uint32_t	Net;	// host byte order
+		int		Bits;
+		time_t		TTL;
+		HitsPtr		Counters;
+	} Info;
+	/** @brief the index read by IsBlocked() */
+	typedef struct
+	{
+		std::unordered_map<uint64_t,HitsPtr>	Networks;
+		std::vector<int>			Lengths; // longest first
+	} Index;
+	typedef std::shared_ptr<const Index>	IndexPtr;
+	typedef std::pair<time_t,size_t>	Timer;	// expires, ID
+	typedef std::priority_queue<Timer, std::vector<Timer>,
+		std::greater<Timer> >		TimerHeap;
+	static uint32_t	Mask ( int Bits );
+	static uint64_t	Key ( uint32_t Net, int Bits );
+	void	Forget ( size_t ID );
+	void	Rebuild ();
+	FG_List				m_List;
+	/** @brief protects m_Info and m_Timers */
+	pthread_mutex_t			m_IndexMutex;
+	std::map<size_t,Info>		m_Info;
+	TimerHeap			m_Timers;
+	IndexPtr			m_Index;
+}; // class FG_BlackList
+
+#endif
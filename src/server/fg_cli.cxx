@@ -321,7 +321,7 @@ FG_CLI::cmd_show_stats
                 << crlf; if ( check_pager () ) return libcli::OK;
         m_connection << "I have " << fgms->m_RelayList.Size () << " relays"
                 << crlf; if ( check_pager () ) return libcli::OK;
-        m_connection << "I have " << fgms->m_PlayerList.Size () << " users ("
+        m_connection << "I have " << fgms->m_PlayerList.GetSnapshot ()->size () << " users ("
                 << fgms->m_LocalClients << " local, "
                 << fgms->m_RemoteClients << " remote, "
                 << fgms->m_NumMaxClients << " max)"
@@ -349,6 +349,36 @@ FG_CLI::cmd_show_stats
                 << " / " << byte_counter ( fgms->m_PlayerList.BytesSent )
                 << " (" << byte_counter ( ( double ) fgms->m_PlayerList.BytesSent / difftime ) << "/s)"
                 << crlf; if ( check_pager () ) return libcli::OK;
+        m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
+                << "thinned by LOD:"
+                << fgms->m_Lod.Thinned << " packets"
+                << " (" << fgms->m_Lod.Thinned / difftime << "/s)"
+                << " of " << fgms->m_Lod.Thinned + fgms->m_Lod.Predicted + fgms->m_Lod.Forwarded
+                << crlf; if ( check_pager () ) return libcli::OK;
+        m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
+                << "predicted by clients:"
+                << fgms->m_Lod.Predicted << " packets"
+                << " (" << fgms->m_Lod.Predicted / difftime << "/s)"
+                << crlf; if ( check_pager () ) return libcli::OK;
+        m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
+                << "trimmed properties:"
+                << fgms->m_PropertyFilter.Trimmed << " packets"
+                << " (" << fgms->m_PropertyFilter.Unparsable << " unparsable)"
+                << " / " << byte_counter ( fgms->m_PropertyFilter.BytesSaved ) << " saved"
+                << crlf; if ( check_pager () ) return libcli::OK;
+        m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
+                << "superseded by tick:"
+                << fgms->mT_TickSuperseded + fgms->m_TickSuperseded << " packets"
+                << " of " << fgms->mT_TickSuperseded + fgms->m_TickSuperseded
+                   + fgms->mT_TickForwarded + fgms->m_TickForwarded
+                << crlf; if ( check_pager () ) return libcli::OK;
+        m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
+                << "queued (congestion):"
+                << fgms->m_Egress.Queued.load () << " packets"
+                << " (" << fgms->m_Egress.Superseded.load () << " superseded, "
+                << fgms->m_Egress.Dropped.load () << " dropped, "
+                << fgms->m_Egress.Errors.load () << " errors)"
+                << crlf; if ( check_pager () ) return libcli::OK;
 
         m_connection << "Receive counters:" << crlf; if ( check_pager () ) return libcli::OK;
         m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
@@ -361,7 +391,7 @@ FG_CLI::cmd_show_stats
         m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
                 << "errors:"
                 << "invalid packets:" << fgms->m_PacketsInvalid
-                << " rejected:" << fgms->m_BlackRejected
+                << " rejected:" << fgms->m_BlackRejected.load ()
                 << " unknown relay:" << fgms->m_UnknownRelay
                 << crlf; if ( check_pager () ) return libcli::OK;
         m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
@@ -390,7 +420,7 @@ FG_CLI::cmd_show_stats
                 << crlf; if ( check_pager () ) return libcli::OK;
         m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
                 << "blacklist:"
-                << fgms->m_BlackList.PktsRcvd << " packets"
+                << fgms->m_BlackList.PktsRcvd.load () << " packets"
                 << " (" << fgms->m_BlackList.PktsRcvd / difftime << "/s)"
                 << " / " << byte_counter ( fgms->m_BlackList.BytesRcvd )
                 << " (" << byte_counter ( ( double ) fgms->m_BlackList.BytesRcvd / difftime ) << "/s)"
@@ -421,6 +451,23 @@ FG_CLI::cmd_show_stats
         accumulated_rcvd_pkts += fgms->m_RelayList.PktsRcvd;
         accumulated_rcvd += fgms->m_PlayerList.BytesRcvd;
         accumulated_rcvd_pkts += fgms->m_PlayerList.PktsRcvd;
+        std::vector<FG_Egress::Counters> Receivers;
+        fgms->m_Egress.GetCounters ( Receivers );
+        if ( ! Receivers.empty () )
+        {
+                m_connection << "Egress queues:" << crlf; if ( check_pager () ) return libcli::OK;
+        }
+        for ( size_t i = 0; i < Receivers.size (); i++ )
+        {
+                const FG_Egress::Counters& C = Receivers[i];
+                m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
+                        << C.Address.getHost () + string ( ":" ) + NumToStr ( C.Address.getPort (), 0 )
+                        << C.Length << " queued"
+                        << " (" << C.Queued << " total, " << C.Sent << " sent, "
+                        << C.Superseded << " superseded, " << C.Dropped << " dropped, "
+                        << C.Errors << " errors)"
+                        << crlf; if ( check_pager () ) return libcli::OK;
+        }
         m_connection << "Totals:" << crlf; if ( check_pager () ) return libcli::OK;
         m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
                 << "sent:"
@@ -482,6 +529,28 @@ FG_CLI::cmd_show_settings
         m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
                 << "radar range:" << fgms->m_MaxRadarRange
                 << crlf; if ( check_pager () ) return libcli::OK;
+        // the bands may be replaced by a reload meanwhile
+        pthread_mutex_lock ( &fgms->m_PacketMutex );
+        std::string LodBands = fgms->m_Lod.Enabled () ? fgms->m_Lod.GetBands () : "off";
+        std::string PropertyBands = fgms->m_PropertyFilter.Enabled () ?
+          fgms->m_PropertyFilter.GetBands () : "off";
+        pthread_mutex_unlock ( &fgms->m_PacketMutex );
+        m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
+                << "LOD bands:" << LodBands
+                << crlf; if ( check_pager () ) return libcli::OK;
+        m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
+                << "property bands:" << PropertyBands
+                << crlf; if ( check_pager () ) return libcli::OK;
+        m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
+                << "egress queue:" << fgms->m_Egress.GetLimit () << " packets"
+                << crlf; if ( check_pager () ) return libcli::OK;
+        m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
+                << "tick rate:";
+        if ( fgms->m_TickRate == 0 )
+                m_connection << "off";
+        else
+                m_connection << fgms->m_TickRate << " Hz";
+        m_connection << crlf; if ( check_pager () ) return libcli::OK;
         m_connection << "  " << std::left << std::setfill ( ' ' ) << std::setw ( 22 )
                 << "logfile:" << fgms->m_LogFileName
                 << crlf; if ( check_pager () ) return libcli::OK;
@@ -767,6 +836,7 @@ FG_CLI::cmd_whitelist_delete
                 if ( Entry != fgms->m_WhiteList.End () )
                 {
                         fgms->m_WhiteList.Delete ( Entry );
+                        fgms->UpdateExempt ( Address );
                 }
                 else
                 {
@@ -778,7 +848,9 @@ FG_CLI::cmd_whitelist_delete
         Entry = fgms->m_WhiteList.FindByID ( ID );
         if ( Entry != fgms->m_WhiteList.End () )
         {
+                netAddress Deleted = Entry->Address;
                 fgms->m_WhiteList.Delete ( Entry );
+                fgms->UpdateExempt ( Deleted );
         }
         else
         {
@@ -873,6 +945,7 @@ FG_CLI::cmd_whitelist_add
         if ( CurrentEntry == fgms->m_WhiteList.End () )
         {
                 NewID = fgms->m_WhiteList.Add ( E, TTL );
+                fgms->UpdateExempt ( E.Address );
         }
         else
         {
@@ -992,8 +1065,14 @@ FG_CLI::cmd_blacklist_show
                                 continue;
                 }
                 EntriesFound++;
+                string Network = Entry.Address.getHost ();
+                int Bits = fgms->m_BlackList.PrefixLength ( Entry.ID );
+                if ( Bits != 32 )
+                {
+                        Network += "/" + NumToStr ( Bits, 0 );
+                }
                 m_connection << "ID " << Entry.ID << ": "
-                        << Entry.Address.getHost () << " : " << Entry.Name
+                        << Network << " : " << Entry.Name
                         << crlf; if ( check_pager () ) return libcli::OK;
                 if ( Brief == true )
                 {
@@ -1027,7 +1106,7 @@ FG_CLI::cmd_blacklist_show
         {
                 difftime = now - fgms->m_Uptime;
                 m_connection << "Total rcvd: "
-                        << fgms->m_BlackList.PktsRcvd << " packets"
+                        << fgms->m_BlackList.PktsRcvd.load () << " packets"
                         << " (" << fgms->m_BlackList.PktsRcvd / difftime << "/s)"
                         << " / " << byte_counter ( fgms->m_BlackList.BytesRcvd )
                         << " (" << byte_counter ( ( double ) ( fgms->m_BlackList.BytesRcvd / difftime ) ) << "/s)"
@@ -1721,6 +1800,17 @@ FG_CLI::cmd_relay_show
                 << " / " << byte_counter ( fgms->m_RelayList.BytesRcvd )
                 << " (" << byte_counter ( ( double ) fgms->m_RelayList.BytesRcvd / difftime ) << "/s)"
                 << crlf; if ( check_pager () ) return libcli::OK;
+        const FG_RelayScheduler& Sched = fgms->m_RelaySched;
+        m_connection << "  scheduled : "
+                << Sched.Sent[FG_RelayScheduler::TIER_FULL] << " full, "
+                << Sched.Sent[FG_RelayScheduler::TIER_NEAR] << " near, "
+                << Sched.Sent[FG_RelayScheduler::TIER_FAR] << " far, "
+                << Sched.Sent[FG_RelayScheduler::TIER_REMOTE] << " remote"
+                << crlf; if ( check_pager () ) return libcli::OK;
+        m_connection << "  held back : "
+                << Sched.Skipped << " by rate, "
+                << Sched.OverBudget << " by budget"
+                << crlf; if ( check_pager () ) return libcli::OK;
         return libcli::OK;
 } // FG_CLI::cmd_relay_show
 
@@ -1803,6 +1893,7 @@ FG_CLI::cmd_tracker_show
         }
         m_connection << "last seen " << A << ", last sent " << B << crlf;
         m_connection << "I had " << fgms->m_Tracker->LostConnections << " lost connections" << crlf;
+        m_connection << "protocol: " << ( fgms->m_Tracker->IsBinary () ? "binary" : "text" ) << crlf;
         m_connection << crlf;
         m_connection << "Counters:" << crlf;
         m_connection << "  sent    : " << fgms->m_Tracker->PktsSent << " packets";
@@ -1815,7 +1906,8 @@ FG_CLI::cmd_tracker_show
         m_connection << " / " << byte_counter ( fgms->m_Tracker->BytesRcvd );
         m_connection << " (" << byte_counter ( ( double ) fgms->m_Tracker->BytesRcvd / difftime ) << "/s)";
         m_connection << crlf;
-        m_connection << "  queue size: " << fgms->m_Tracker->msg_queue.size () << " messages" << crlf;
+        m_connection << "  queue size: " << fgms->m_Tracker->QueueSize () << " messages";
+        m_connection << ", " << fgms->m_Tracker->MsgsDropped.load () << " dropped" << crlf;
         return libcli::OK;
 } // FG_CLI::cmd_tracker_show
 
@@ -1893,6 +1985,7 @@ FG_CLI::cmd_relay_delete
                 if ( Entry != fgms->m_RelayList.End () )
                 {
                         fgms->m_RelayList.Delete ( Entry );
+                        fgms->UpdateExempt ( Address );
                 }
                 else
                 {
@@ -1904,7 +1997,9 @@ FG_CLI::cmd_relay_delete
         Entry = fgms->m_RelayList.FindByID ( ID );
         if ( Entry != fgms->m_RelayList.End () )
         {
+                netAddress Deleted = Entry->Address;
                 fgms->m_RelayList.Delete ( Entry );
+                fgms->UpdateExempt ( Deleted );
         }
         else
         {
@@ -1995,6 +2090,7 @@ FG_CLI::cmd_relay_add
         if ( CurrentEntry == fgms->m_RelayList.End () )
         {
                 NewID = fgms->m_RelayList.Add ( E, 0 );
+                fgms->UpdateExempt ( E.Address );
         }
         else
         {
@@ -2104,8 +2200,8 @@ FG_CLI::cmd_user_show
                 }
                 ++i;
         }
-        int Count = fgms->m_PlayerList.Size ();
-        FG_Player       Player;
+        PlayerList::Snapshot Players = fgms->m_PlayerList.GetSnapshot ();
+        int Count = Players->size ();
         Point3D         PlayerPosGeod;
         string          Origin;
         string          FullName;
@@ -2124,7 +2220,7 @@ FG_CLI::cmd_user_show
         for ( int i = 0; i < Count; i++ )
         {
                 now = time ( 0 );
-                Player = fgms->m_PlayerList[i];
+                const FG_Player& Player = (*Players)[i];
                 if ( ( ID == 0 ) && ( Address.getIP () != 0 ) )
                 {       // only list matching entries
                         if ( Player.Address != Address )
@@ -2150,7 +2246,7 @@ FG_CLI::cmd_user_show
                         if ( Player.IsLocal == true )
                                 continue;
                 }
-                sgCartToGeod ( Player.LastPos, PlayerPosGeod );
+                PlayerPosGeod = Player.GetGeodPos ();
                 if ( Player.IsLocal )
                 {
                         Origin = "LOCAL";
@@ -2236,9 +2332,6 @@ FG_CLI::cmd_user_show
                 m_connection << "         " << std::left << std::setfill ( ' ' ) << std::setw ( 15 )
                         << "expires in" << expires
                         << crlf; if ( check_pager () ) return libcli::OK;
-                m_connection << "         " << std::left << std::setfill ( ' ' ) << std::setw ( 15 )
-                        << "inactive" << now - Player.LastRelayedToInactive
-                        << crlf; if ( check_pager () ) return libcli::OK;
         }
         difftime = now - fgms->m_Uptime;
         m_connection << crlf;
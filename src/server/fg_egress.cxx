@@ -0,0 +1,451 @@
+/**
+ * @file fg_egress.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, queues of packets to congested receivers
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+
+#include <errno.h>
+#include "fg_egress.hxx"
+
+const size_t FG_Egress::NO_SENDER;
+
+//////////////////////////////////////////////////////////////////////
+FG_Egress::FG_Egress ()
+{
+	pthread_mutex_init ( &m_Mutex, 0 );
+	m_Pending	= 0;
+	m_Limit		= 32;
+	Queued		= 0;
+	Superseded	= 0;
+	Dropped		= 0;
+	Errors		= 0;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+FG_Egress::~FG_Egress ()
+{
+	pthread_mutex_destroy ( &m_Mutex );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the length of the queues. Longer queues are shortened
+ *        when the next packet is queued.
+ */
+void
+FG_Egress::SetLimit ( int Packets )
+{
+	pthread_mutex_lock ( &m_Mutex );
+	m_Limit = ( Packets < 0 ) ? 0 : Packets;
+	pthread_mutex_unlock ( &m_Mutex );
+} // FG_Egress::SetLimit ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** thread safe
+ *
+ * Send a packet to a list of receivers. Receivers with a queue get the
+ * packet queued, the others get it at once.
+ * @param Socket the socket to send with
+ * @param Batch send with one syscall for many receivers
+ * @param Msg the packet
+ * @param Bytes the size of the packet
+ * @param To the receivers, cleared afterwards
+ * @param Sender the player the packet is a position of, or NO_SENDER
+ */
+void
+FG_Egress::Send
+(
+	netSocket* Socket,
+	bool Batch,
+	const char* Msg,
+	int Bytes,
+	std::vector<netAddress>& To,
+	size_t Sender
+)
+{
+	if ( Pending () )
+	{	// keep the order of the packets to receivers with a queue
+		pthread_mutex_lock ( &m_Mutex );
+		size_t i = 0;
+		while ( i < To.size () )
+		{
+			ReceiverMap::iterator R = m_Receivers.find ( Key ( To[i] ) );
+			if ( ( R != m_Receivers.end () ) && ( ! R->second.Queue.empty () ) )
+			{
+				Push ( R->second, Msg, Bytes, Sender );
+				To[i] = To.back ();
+				To.pop_back ();
+			}
+			else
+			{
+				i++;
+			}
+		}
+		pthread_mutex_unlock ( &m_Mutex );
+	}
+	size_t Done = 0;
+	while ( Done < To.size () )
+	{
+		size_t Todo = Batch ? To.size () - Done : 1;
+		size_t Sent;
+		if ( Batch )
+		{
+			Sent = Socket->sendto_many ( Msg, Bytes, 0, &To[Done], Todo );
+		}
+		else
+		{
+			Sent = ( Socket->sendto ( Msg, Bytes, 0, &To[Done] ) < 0 ) ? 0 : 1;
+		}
+		Done += Sent;
+		if ( Sent < Todo )
+		{	// To[Done] failed, errno tells why
+			Failed ( Msg, Bytes, To[Done], Sender, errno );
+			Done++;
+		}
+	}
+	To.clear ();
+} // FG_Egress::Send ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** thread safe
+ *
+ * Send a packet to a single receiver.
+ * @retval true if the packet was sent or queued
+ */
+bool
+FG_Egress::Send
+(
+	netSocket* Socket,
+	const char* Msg,
+	int Bytes,
+	const netAddress& To,
+	size_t Sender
+)
+{
+	if ( Pending () )
+	{
+		pthread_mutex_lock ( &m_Mutex );
+		ReceiverMap::iterator R = m_Receivers.find ( Key ( To ) );
+		if ( ( R != m_Receivers.end () ) && ( ! R->second.Queue.empty () ) )
+		{
+			Push ( R->second, Msg, Bytes, Sender );
+			pthread_mutex_unlock ( &m_Mutex );
+			return true;
+		}
+		pthread_mutex_unlock ( &m_Mutex );
+	}
+	if ( Socket->sendto ( Msg, Bytes, 0, &To ) >= 0 )
+	{
+		return true;
+	}
+	return Failed ( Msg, Bytes, To, Sender, errno );
+} // FG_Egress::Send ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** thread safe
+ *
+ * Send the queued packets, the first packet of every receiver in turn,
+ * so that a receiver with a long queue does not starve the others.
+ * Stops as soon as the socket is full again.
+ *
+ * The queues do not remember the socket a packet failed on, all go
+ * out through Socket. The sockets of the workers are bound to the
+ * same address and port as the data socket (SO_REUSEPORT), so a
+ * receiver sees the same source either way.
+ */
+void
+FG_Egress::Flush ( netSocket* Socket )
+{
+	if ( ! Pending () )
+	{
+		return;
+	}
+	pthread_mutex_lock ( &m_Mutex );
+	bool More = true;
+	while ( More )
+	{
+		More = false;
+		ReceiverMap::iterator R;
+		for ( R = m_Receivers.begin (); R != m_Receivers.end (); R++ )
+		{
+			Receiver& Rcv = R->second;
+			if ( Rcv.Queue.empty () )
+			{
+				continue;
+			}
+			const std::vector<char>& Data = Rcv.Queue.front ().Data;
+			if ( Socket->sendto ( &Data[0], Data.size (), 0, &Rcv.Count.Address ) < 0 )
+			{
+				if ( IsCongestion ( errno ) )
+				{	// still full, try again later
+					pthread_mutex_unlock ( &m_Mutex );
+					return;
+				}
+				Rcv.Count.Errors++;
+				Errors++;
+			}
+			else
+			{
+				Rcv.Count.Sent++;
+			}
+			Pop ( Rcv );
+			if ( ! Rcv.Queue.empty () )
+			{
+				More = true;
+			}
+		}
+	}
+	pthread_mutex_unlock ( &m_Mutex );
+} // FG_Egress::Flush ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** thread safe
+ *
+ * Drop the queue and the counters of a receiver, eg. when it leaves.
+ */
+void
+FG_Egress::Forget ( const netAddress& To )
+{
+	pthread_mutex_lock ( &m_Mutex );
+	ReceiverMap::iterator R = m_Receivers.find ( Key ( To ) );
+	if ( R != m_Receivers.end () )
+	{
+		while ( ! R->second.Queue.empty () )
+		{
+			Pop ( R->second );
+		}
+		m_Receivers.erase ( R );
+	}
+	pthread_mutex_unlock ( &m_Mutex );
+} // FG_Egress::Forget ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** thread safe */
+void
+FG_Egress::Expire ()
+{
+	time_t Now = time ( 0 );
+	pthread_mutex_lock ( &m_Mutex );
+	ReceiverMap::iterator R = m_Receivers.begin ();
+	while ( R != m_Receivers.end () )
+	{
+		if ( R->second.Queue.empty () && ( Now - R->second.LastUsed > IDLE_TIME ) )
+		{
+			R = m_Receivers.erase ( R );
+		}
+		else
+		{
+			R++;
+		}
+	}
+	pthread_mutex_unlock ( &m_Mutex );
+} // FG_Egress::Expire ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** thread safe */
+void
+FG_Egress::Clear ()
+{
+	pthread_mutex_lock ( &m_Mutex );
+	m_Receivers.clear ();
+	m_Spare.clear ();
+	m_Pending = 0;
+	pthread_mutex_unlock ( &m_Mutex );
+} // FG_Egress::Clear ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** thread safe */
+void
+FG_Egress::GetCounters ( std::vector<Counters>& List )
+{
+	List.clear ();
+	pthread_mutex_lock ( &m_Mutex );
+	ReceiverMap::iterator R;
+	for ( R = m_Receivers.begin (); R != m_Receivers.end (); R++ )
+	{
+		List.push_back ( R->second.Count );
+		List.back ().Length = R->second.Queue.size ();
+	}
+	pthread_mutex_unlock ( &m_Mutex );
+} // FG_Egress::GetCounters ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+uint64_t
+FG_Egress::Key ( const netAddress& Address )
+{
+	return ( ( uint64_t ) Address.getIP () << 16 ) | ( Address.getPort () & 0xffff );
+} // FG_Egress::Key ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @retval true if a send failed only because the socket is full
+ */
+bool
+FG_Egress::IsCongestion ( int Error )
+{
+	return ( Error == EAGAIN ) || ( Error == EWOULDBLOCK ) || ( Error == ENOBUFS );
+} // FG_Egress::IsCongestion ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief The receiver of Address, created if it is not known yet.
+ *        Called with m_Mutex held.
+ */
+FG_Egress::Receiver&
+FG_Egress::Find ( const netAddress& Address )
+{
+	uint64_t K = Key ( Address );
+	ReceiverMap::iterator R = m_Receivers.find ( K );
+	if ( R == m_Receivers.end () )
+	{
+		R = m_Receivers.insert ( ReceiverMap::value_type ( K, Receiver () ) ).first;
+		Counters& C	= R->second.Count;
+		C.Address	= Address;
+		C.Queued	= 0;
+		C.Sent		= 0;
+		C.Superseded	= 0;
+		C.Dropped	= 0;
+		C.Errors	= 0;
+		C.Length	= 0;
+	}
+	return R->second;
+} // FG_Egress::Find ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** thread safe
+ *
+ * A packet to To could not be sent.
+ * @retval true if the packet was queued
+ */
+bool
+FG_Egress::Failed
+(
+	const char* Msg,
+	int Bytes,
+	const netAddress& To,
+	size_t Sender,
+	int Error
+)
+{
+	bool Queue = IsCongestion ( Error );
+	if ( Queue && ( m_Limit == 0 ) )
+	{	// queues are off, the packet is lost like any other
+		return false;
+	}
+	pthread_mutex_lock ( &m_Mutex );
+	Receiver& R = Find ( To );
+	R.LastUsed = time ( 0 );
+	if ( Queue )
+	{
+		Push ( R, Msg, Bytes, Sender );
+	}
+	else
+	{
+		R.Count.Errors++;
+		Errors++;
+	}
+	pthread_mutex_unlock ( &m_Mutex );
+	return Queue;
+} // FG_Egress::Failed ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Queue a packet, called with m_Mutex held
+ */
+void
+FG_Egress::Push ( Receiver& R, const char* Msg, int Bytes, size_t Sender )
+{
+	R.LastUsed = time ( 0 );
+	if ( m_Limit == 0 )
+	{	// queues are off, not dropped by a full queue
+		return;
+	}
+	if ( Sender != NO_SENDER )
+	{
+		PacketQueue::iterator P;
+		for ( P = R.Queue.begin (); P != R.Queue.end (); P++ )
+		{
+			if ( P->Sender == Sender )
+			{	// only the newest state of a sender matters
+				P->Data.assign ( Msg, Msg + Bytes );
+				R.Count.Superseded++;
+				Superseded++;
+				return;
+			}
+		}
+	}
+	while ( R.Queue.size () >= ( size_t ) m_Limit )
+	{	// drop the oldest
+		Pop ( R );
+		R.Count.Dropped++;
+		Dropped++;
+	}
+	R.Queue.push_back ( Packet () );
+	Packet& P = R.Queue.back ();
+	P.Sender = Sender;
+	if ( ! m_Spare.empty () )
+	{
+		P.Data.swap ( m_Spare.back () );
+		m_Spare.pop_back ();
+	}
+	P.Data.assign ( Msg, Msg + Bytes );
+	R.Count.Queued++;
+	Queued++;
+	m_Pending++;
+} // FG_Egress::Push ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Remove the first packet of a queue, called with m_Mutex held
+ */
+void
+FG_Egress::Pop ( Receiver& R )
+{
+	if ( m_Spare.size () < MAX_SPARE )
+	{
+		m_Spare.push_back ( std::vector<char> () );
+		m_Spare.back ().swap ( R.Queue.front ().Data );
+	}
+	R.Queue.pop_front ();
+	m_Pending--;
+} // FG_Egress::Pop ()
+//////////////////////////////////////////////////////////////////////
+
@@ -0,0 +1,146 @@
+/**
+ * @file fg_egress.hxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, queues of packets to congested receivers
+//
+//////////////////////////////////////////////////////////////////////
+
+#if !defined FG_EGRESS_HXX
+#define FG_EGRESS_HXX
+
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <time.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <plib/netSocket.h>
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @class FG_Egress
+ * @brief Bounded queues of packets the data socket could not send
+ *
+ * The data socket does not block. If its send buffer is full, sendto()
+ * fails with EAGAIN or ENOBUFS and the packet would be lost. Instead it
+ * is put into the queue of its receiver, later packets to the receiver
+ * are queued behind it, so the order is kept. Flush() sends the queues,
+ * one packet per receiver in turn, until the socket is full again.
+ *
+ * A queue holds at most SetLimit() packets:
+ *
+ * - a position packet replaces a queued packet of the same sender, only
+ *   the newest state of a sender matters
+ * - if the queue is full, the oldest packet is dropped
+ *
+ * Packets failing with other errors are dropped. Everything is counted
+ * per receiver, see GetCounters().
+ *
+ * Thread safe. Send() only takes the lock while packets are queued or
+ * a send failed.
+ */
+class FG_Egress
+{
+public:
+	enum
+	{
+		RETRY_INTERVAL	= 10,		// ms between two Flush()
+		IDLE_TIME	= 60,		// seconds until a receiver is forgotten
+		MAX_SPARE	= 1024		// buffers kept for reuse
+	};
+	/** the sender of packets which are never superseded */
+	static const size_t NO_SENDER = ( size_t ) -1;
+	/** the counters of a receiver */
+	typedef struct
+	{
+		netAddress	Address;
+		size_t		Queued;		// packets queued
+		size_t		Sent;		// queued packets sent later
+		size_t		Superseded;	// replaced by a newer state
+		size_t		Dropped;	// the queue was full
+		size_t		Errors;		// failed with other errors
+		size_t		Length;		// packets in the queue now
+	} Counters;
+	FG_Egress ();
+	~FG_Egress ();
+	/** maximum number of packets queued per receiver, 0 = none, a
+	    packet to a full socket is then lost without being counted */
+	void	SetLimit ( int Packets );
+	int	GetLimit () const { return m_Limit; }
+	/** send Msg to all of To, the list is cleared afterwards */
+	void	Send ( netSocket* Socket, bool Batch, const char* Msg, int Bytes,
+		  std::vector<netAddress>& To, size_t Sender );
+	/** send Msg to To, false if it was dropped */
+	bool	Send ( netSocket* Socket, const char* Msg, int Bytes,
+		  const netAddress& To, size_t Sender );
+	/** send queued packets until the socket is full again */
+	void	Flush ( netSocket* Socket );
+	/** true if packets are queued */
+	bool	Pending () const { return m_Pending.load ( std::memory_order_relaxed ) != 0; }
+	/** drop the queue and the counters of To */
+	void	Forget ( const netAddress& To );
+	/** forget receivers with an empty queue, idle for IDLE_TIME */
+	void	Expire ();
+	/** forget all receivers */
+	void	Clear ();
+	/** copy the counters of all known receivers */
+	void	GetCounters ( std::vector<Counters>& List );
+	/** packets queued, the totals are read without the lock */
+	std::atomic<size_t>	Queued;
+	/** packets replaced by a newer state of their sender */
+	std::atomic<size_t>	Superseded;
+	/** packets dropped, because a queue was full */
+	std::atomic<size_t>	Dropped;
+	/** packets dropped, because of other errors */
+	std::atomic<size_t>	Errors;
+private:
+	FG_Egress ( const FG_Egress& );
+	void operator = ( const FG_Egress& );
+	typedef struct
+	{
+		size_t			Sender;
+		std::vector<char>	Data;
+	} Packet;
+	typedef std::deque<Packet>	PacketQueue;
+	typedef struct
+	{
+		Counters	Count;
+		PacketQueue	Queue;
+		time_t		LastUsed;
+	} Receiver;
+	typedef std::unordered_map<uint64_t,Receiver>	ReceiverMap;
+	static uint64_t	Key ( const netAddress& Address );
+	static bool	IsCongestion ( int Error );
+	Receiver&	Find ( const netAddress& Address );
+	bool	Failed ( const char* Msg, int Bytes, const netAddress& To,
+		  size_t Sender, int Error );
+	void	Push ( Receiver& R, const char* Msg, int Bytes, size_t Sender );
+	void	Pop ( Receiver& R );
+	pthread_mutex_t		m_Mutex;
+	ReceiverMap		m_Receivers;
+	std::vector< std::vector<char> > m_Spare;
+	std::atomic<size_t>	m_Pending;	// packets in all queues
+	int			m_Limit;
+}; // class FG_Egress
+
+#endif
@@ -29,6 +29,10 @@
 #endif // _MSC_VER
 #include <assert.h>
 #include "fg_geometry.hxx"
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+	#define FG_HAVE_X86_SIMD 1
+	#include <immintrin.h>
+#endif
 
 /**
  *  High-precision versions of the above produced with an arbitrary
@@ -370,6 +374,211 @@ Distance ( const Point3D & P1, const Point3D & P2 )
 	return (float)(P.length() / SG_NM_TO_METER);
 } // Distance ( const Point3D & P1, const Point3D & P2 )
 
+//////////////////////////////////////////////////////////////////////
+//
+// Check a sender against many receivers at once. The receivers are
+// given as a structure of arrays, so that several of them are
+// checked by a single SIMD instruction. Instead of the distance, the
+// squared distance is compared to the squared range (in meters).
+//
+//////////////////////////////////////////////////////////////////////
+
+typedef uint64_t (*InRangeFunc) ( const double* P, const double* X,
+  const double* Y, const double* Z, const double* Range2, size_t Count );
+
+/**
+ * @brief Portable version of InRangeMask()
+ */
+static uint64_t
+InRangeScalar
+(
+	const double* P,
+	const double* X,
+	const double* Y,
+	const double* Z,
+	const double* Range2,
+	size_t Count
+)
+{
+	uint64_t Mask = 0;
+	for ( size_t i = 0; i < Count; i++ )
+	{
+		double dx = X[i] - P[0];
+		double dy = Y[i] - P[1];
+		double dz = Z[i] - P[2];
+		if ( ( dx*dx + dy*dy + dz*dz ) < Range2[i] )
+			Mask |= ( (uint64_t) 1 << i );
+	}
+	return Mask;
+} // InRangeScalar ()
+
+#ifdef FG_HAVE_X86_SIMD
+/**
+ * @brief InRangeMask() checking two receivers per instruction
+ */
+__attribute__ (( target ( "sse2" ) ))
+static uint64_t
+InRangeSSE2
+(
+	const double* P,
+	const double* X,
+	const double* Y,
+	const double* Z,
+	const double* Range2,
+	size_t Count
+)
+{
+	uint64_t Mask = 0;
+	size_t	 i = 0;
+	__m128d	 px = _mm_set1_pd ( P[0] );
+	__m128d	 py = _mm_set1_pd ( P[1] );
+	__m128d	 pz = _mm_set1_pd ( P[2] );
+	for ( ; i + 2 <= Count; i += 2 )
+	{
+		__m128d dx = _mm_sub_pd ( _mm_loadu_pd ( X + i ), px );
+		__m128d dy = _mm_sub_pd ( _mm_loadu_pd ( Y + i ), py );
+		__m128d dz = _mm_sub_pd ( _mm_loadu_pd ( Z + i ), pz );
+		__m128d d2 = _mm_add_pd ( _mm_add_pd ( _mm_mul_pd ( dx, dx ),
+			_mm_mul_pd ( dy, dy ) ), _mm_mul_pd ( dz, dz ) );
+		__m128d In = _mm_cmplt_pd ( d2, _mm_loadu_pd ( Range2 + i ) );
+		Mask |= (uint64_t) _mm_movemask_pd ( In ) << i;
+	}
+	if ( i < Count )
+	{
+		Mask |= InRangeScalar ( P, X + i, Y + i, Z + i, Range2 + i, Count - i ) << i;
+	}
+	return Mask;
+} // InRangeSSE2 ()
+
+/**
+ * @brief InRangeMask() checking four receivers per instruction
+ */
+__attribute__ (( target ( "avx2" ) ))
+static uint64_t
+InRangeAVX2
+(
+	const double* P,
+	const double* X,
+	const double* Y,
+	const double* Z,
+	const double* Range2,
+	size_t Count
+)
+{
+	uint64_t Mask = 0;
+	size_t	 i = 0;
+	__m256d	 px = _mm256_set1_pd ( P[0] );
+	__m256d	 py = _mm256_set1_pd ( P[1] );
+	__m256d	 pz = _mm256_set1_pd ( P[2] );
+	for ( ; i + 4 <= Count; i += 4 )
+	{
+		__m256d dx = _mm256_sub_pd ( _mm256_loadu_pd ( X + i ), px );
+		__m256d dy = _mm256_sub_pd ( _mm256_loadu_pd ( Y + i ), py );
+		__m256d dz = _mm256_sub_pd ( _mm256_loadu_pd ( Z + i ), pz );
+		__m256d d2 = _mm256_add_pd ( _mm256_add_pd ( _mm256_mul_pd ( dx, dx ),
+			_mm256_mul_pd ( dy, dy ) ), _mm256_mul_pd ( dz, dz ) );
+		__m256d In = _mm256_cmp_pd ( d2, _mm256_loadu_pd ( Range2 + i ), _CMP_LT_OQ );
+		Mask |= (uint64_t) _mm256_movemask_pd ( In ) << i;
+	}
+	if ( i < Count )
+	{
+		Mask |= InRangeScalar ( P, X + i, Y + i, Z + i, Range2 + i, Count - i ) << i;
+	}
+	return Mask;
+} // InRangeAVX2 ()
+#endif
+
+/**
+ * @brief A version of InRangeMask(), 0 if it is not compiled in or
+ *        this CPU can not run it
+ */
+static InRangeFunc
+InRangeVersion ( int Version )
+{
+#ifdef FG_HAVE_X86_SIMD
+	__builtin_cpu_init ();
+	if ( Version == IN_RANGE_AVX2 )
+		return __builtin_cpu_supports ( "avx2" ) ? InRangeAVX2 : 0;
+	if ( Version == IN_RANGE_SSE2 )
+		return __builtin_cpu_supports ( "sse2" ) ? InRangeSSE2 : 0;
+#endif
+	if ( Version == IN_RANGE_SCALAR )
+		return InRangeScalar;
+	return 0;
+} // InRangeVersion ()
+
+/**
+ * @brief Choose the fastest version of InRangeMask() for this CPU
+ */
+static InRangeFunc
+SelectInRange ()
+{
+	for ( int Version = IN_RANGE_AVX2; Version > IN_RANGE_SCALAR; Version-- )
+	{
+		if ( InRangeVersion ( Version ) )
+			return InRangeVersion ( Version );
+	}
+	return InRangeScalar;
+} // SelectInRange ()
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Check which receivers are in range of a sender
+ * @param Pos position of the sender
+ * @param RX, RY, RZ positions of the receivers
+ * @param Range2 squared ranges of the receivers in square meters
+ * @param Count number of receivers, at most RANGE_MASK_BITS
+ * @return bit i is set if receiver i is in range
+ */
+uint64_t
+InRangeMask
+(
+	const Point3D& Pos,
+	const double* RX,
+	const double* RY,
+	const double* RZ,
+	const double* Range2,
+	size_t Count
+)
+{
+	static const InRangeFunc Func = SelectInRange ();
+	double P[3] = { Pos[X], Pos[Y], Pos[Z] };
+
+	assert ( Count <= RANGE_MASK_BITS );
+	return Func ( P, RX, RY, RZ, Range2, Count );
+} // InRangeMask ()
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief InRangeMask() with the given version, so that the versions
+ *        can be compared
+ * @param Version one of IN_RANGE_SCALAR, IN_RANGE_SSE2, IN_RANGE_AVX2
+ * @param Mask the result of InRangeMask()
+ * @return false if the version is not available on this CPU
+ */
+bool
+InRangeMaskOf
+(
+	int Version,
+	const Point3D& Pos,
+	const double* RX,
+	const double* RY,
+	const double* RZ,
+	const double* Range2,
+	size_t Count,
+	uint64_t& Mask
+)
+{
+	InRangeFunc Func = InRangeVersion ( Version );
+	double P[3] = { Pos[X], Pos[Y], Pos[Z] };
+
+	assert ( Count <= RANGE_MASK_BITS );
+	if ( Func == 0 )
+		return false;
+	Mask = Func ( P, RX, RY, RZ, Range2, Count );
+	return true;
+} // InRangeMaskOf ()
+
 //////////////////////////////////////////////////////////////////////
 /**
  * @brief Calculate the height above sea level
@@ -461,6 +670,82 @@ sgCartToGeod ( const Point3D& CartPoint , Point3D& GeodPoint )
 
 
 
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Convert a cartesian XYZ coordinate to a geodetic lat/lon/alt.
+ *
+ * Same result as sgCartToGeod(), but without pow() and with one
+ * trigonometric call less. According to
+ * D. K. Olson,
+ * Converting earth-Centered, Earth-Fixed Coordinates to Geodetic
+ * Coordinates, IEEE Transactions on Aerospace and Electronic Systems
+ * (1996) 32:473-476
+ * For positions between 1000 km below the surface and the orbits of
+ * satellites the result differs by less than a millimeter from
+ * sgCartToGeod(), the largest differences are due to rounding of the
+ * longitude in sgCartToGeod() near +/-180 degrees.
+ */
+void
+CartToGeod ( const Point3D& CartPoint , Point3D& GeodPoint )
+{
+	static const double a1 = _EQURAD * e2;
+	static const double a2 = a1 * a1;
+	static const double a3 = a1 * e2 / 2;
+	static const double a4 = 2.5 * a2;
+	static const double a5 = a1 + a3;
+	static const double a6 = 1 - e2;
+	double x = CartPoint[X];
+	double y = CartPoint[Y];
+	double z = CartPoint[Z];
+	double zp = fabs ( z );
+	double w2 = x*x + y*y;
+	double w  = sqrt ( w2 );
+	double r2 = w2 + z*z;
+	double r  = sqrt ( r2 );
+	if ( r < 1.0 )
+	{	// the center of the earth, the formulas below divide by r
+		GeodPoint[Lat] = 0;
+		GeodPoint[Lon] = 0;
+		GeodPoint[Alt] = -_EQURAD * SG_METER_TO_FEET;
+		return;
+	}
+	double lat, s, c, ss;
+	double s2 = z*z / r2;
+	double c2 = w2 / r2;
+	double u  = a2 / r;
+	double v  = a3 - a4 / r;
+	if ( c2 > 0.3 )
+	{
+		s   = ( zp / r ) * ( 1 + c2 * ( a1 + u + s2 * v ) / r );
+		lat = asin ( s );
+		ss  = s * s;
+		c   = sqrt ( 1 - ss );
+	}
+	else
+	{
+		c   = ( w / r ) * ( 1 - s2 * ( a5 - u - c2 * v ) / r );
+		lat = acos ( c );
+		ss  = 1 - c * c;
+		s   = sqrt ( ss );
+	}
+	double g  = 1 - e2 * ss;
+	double rg = _EQURAD / sqrt ( g );
+	double rf = a6 * rg;
+	u = w - rg * c;
+	v = zp - rf * s;
+	double f = c * u + s * v;
+	double m = c * v - s * u;
+	double p = m / ( rf / g + f );
+	lat += p;
+	if ( z < 0 )
+		lat = -lat;
+	GeodPoint[Lat] = lat * SG_RADIANS_TO_DEGREES;
+	GeodPoint[Lon] = atan2 ( y, x ) * SG_RADIANS_TO_DEGREES;
+	GeodPoint[Alt] = ( f + m * p / 2 ) * SG_METER_TO_FEET;
+} // CartToGeod()
+
+
+
 //////////////////////////////////////////////////////////////////////
 /**
  * @brief Opposite of sgCartToGeod
@@ -24,6 +24,8 @@
 #if !defined FG_GEOMETRY_H
 #define FG_GEOMETRY_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include <simgear/math/SGMath.hxx>
 
 #define SG_180 180.0
@@ -97,6 +99,15 @@ class Point3D
 void CopyPos (  const Point3D& src, Point3D &dst );
 void Mat4ToCoord ( const sgMat4& src,  Point3D & dst );
 float Distance ( const Point3D & P1, const Point3D & P2 );
+/** @brief maximum number of receivers checked by one InRangeMask() */
+#define RANGE_MASK_BITS 64
+uint64_t InRangeMask ( const Point3D& Pos, const double* RX, const double* RY,
+  const double* RZ, const double* Range2, size_t Count );
+/** @brief the versions of InRangeMask(), see InRangeMaskOf() */
+enum { IN_RANGE_SCALAR, IN_RANGE_SSE2, IN_RANGE_AVX2 };
+bool InRangeMaskOf ( int Version, const Point3D& Pos, const double* RX,
+  const double* RY, const double* RZ, const double* Range2, size_t Count,
+  uint64_t& Mask );
 float HeightAboveSea ( const Point3D & P );
 void sgCartToPolar3d(const Point3D& cp, Point3D& Polar );
 void CartToLatLon ( const Point3D& CartPoint , Point3D& LatLonAlt );
@@ -107,6 +118,7 @@ bool IsWithinRMiles ( double lat1, double lon1, double lat2, double lon2,
     double R );
 
 void sgCartToGeod ( const Point3D& CartPoint , Point3D& GeodPoint );
+void CartToGeod ( const Point3D& CartPoint , Point3D& GeodPoint );
 void sgGeodToCart(double lat, double lon, double alt, double* xyz);
 
 #endif
@@ -0,0 +1,465 @@
+/**
+ * @file fg_grid.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, spatial index of players
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <algorithm>
+#include "fg_grid.hxx"
+
+/** @brief Nautical Miles in a Meter */
+static const double SG_NM_TO_METER  = 1852.0000;
+
+/** @brief cell coordinates are stored with 21 bits per axis */
+static const int64_t CELL_BIAS = ( 1 << 20 );
+static const int64_t CELL_MASK = ( 1 << 21 ) - 1;
+
+/** @brief index of the lowest bit set in Mask, Mask must not be 0 */
+static inline size_t
+LowestBit ( uint64_t Mask )
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll ( Mask );
+#else
+	size_t Bit = 0;
+	while ( ( Mask & 1 ) == 0 )
+	{
+		Mask >>= 1;
+		Bit++;
+	}
+	return Bit;
+#endif
+} // LowestBit ()
+
+//////////////////////////////////////////////////////////////////////
+FG_SpatialGrid::FG_SpatialGrid ()
+{
+	m_CellRange	= 100;
+	m_CellSize	= m_CellRange * SG_NM_TO_METER;
+	m_BoundsValid	= false;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the edge length of a cell. All receivers are re-sorted.
+ * @param NauticalMiles the new edge length, usually the standard
+ *        radar range of clients (server.out_of_reach)
+ */
+void
+FG_SpatialGrid::SetCellSize ( double NauticalMiles )
+{
+	if ( NauticalMiles < 1 )
+		NauticalMiles = 1;
+	if ( NauticalMiles == m_CellRange )
+		return;
+	m_CellRange	= NauticalMiles;
+	m_CellSize	= m_CellRange * SG_NM_TO_METER;
+	EntryMap Old = m_Entries;
+	Clear ();
+	for ( EntryMap::iterator E = Old.begin(); E != Old.end(); E++ )
+	{
+		Update ( E->first, E->second.Pos, E->second.Range );
+	}
+} // FG_SpatialGrid::SetCellSize ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Add a receiver to the grid, or update an existing one.
+ *        Only if the receiver changes its cell the grid is modified.
+ */
+void
+FG_SpatialGrid::Update ( size_t ID, const Point3D& Pos, double Range )
+{
+	Entry	E;
+	E.Cell	= CellOf ( Pos );
+	E.Wide	= ( Range > m_CellRange );
+	E.Pos	= Pos;
+	E.Range	= Range;
+	EntryMap::iterator Current = m_Entries.find ( ID );
+	if ( Current != m_Entries.end() )
+	{
+		if ( ( Current->second.Cell == E.Cell )
+		&&   ( Current->second.Wide == E.Wide ) )
+		{	// still in the same cell
+			Current->second.Pos   = Pos;
+			Current->second.Range = Range;
+			Store ( MembersOf ( Current->second ), Current->second );
+			ExtendBounds ( Current->second );
+			return;
+		}
+		Unlink ( ID, Current->second );
+		Current->second = E;
+	}
+	else
+	{
+		Current = m_Entries.insert ( EntryMap::value_type ( ID, E ) ).first;
+	}
+	Link ( ID, Current->second );
+	ExtendBounds ( Current->second );
+} // FG_SpatialGrid::Update ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Remove a receiver from the grid
+ */
+void
+FG_SpatialGrid::Remove ( size_t ID )
+{
+	EntryMap::iterator Current = m_Entries.find ( ID );
+	if ( Current == m_Entries.end() )
+		return;
+	Unlink ( ID, Current->second );
+	m_Entries.erase ( Current );
+	m_BoundsValid = false;
+} // FG_SpatialGrid::Remove ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_SpatialGrid::Clear ()
+{
+	m_Entries.clear ();
+	m_Cells.clear ();
+	m_Wide = Members ();
+	m_BoundsValid = false;
+} // FG_SpatialGrid::Clear ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+size_t
+FG_SpatialGrid::Size () const
+{
+	return m_Entries.size ();
+} // FG_SpatialGrid::Size ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Collect all receivers which want data sent from Pos, ie. the
+ *        receivers whose distance to Pos is less than their range.
+ * @param Pos position of the sender
+ * @param IDs receives the IDs of the receivers (cleared first)
+ */
+void
+FG_SpatialGrid::Receivers
+(
+	const Point3D& Pos,
+	std::vector<size_t>& IDs
+)
+{
+	IDs.clear ();
+	if ( m_Entries.empty() )
+		return;
+	if ( ! m_BoundsValid )
+		UpdateBounds ();
+	for ( int i = 0; i < 3; i++ )
+	{
+		if ( ( Pos[i] < m_Min[i] ) || ( Pos[i] > m_Max[i] ) )
+			return;
+	}
+	InRange ( m_Wide, Pos, IDs );
+	int64_t X = (int64_t) floor ( Pos[0] / m_CellSize );
+	int64_t Y = (int64_t) floor ( Pos[1] / m_CellSize );
+	int64_t Z = (int64_t) floor ( Pos[2] / m_CellSize );
+	for ( int64_t x = X-1; x <= X+1; x++ )
+	{
+		for ( int64_t y = Y-1; y <= Y+1; y++ )
+		{
+			for ( int64_t z = Z-1; z <= Z+1; z++ )
+			{
+				CellMap::const_iterator C = m_Cells.find ( CellKey ( x, y, z ) );
+				if ( C == m_Cells.end() )
+					continue;
+				InRange ( C->second, Pos, IDs );
+			}
+		}
+	}
+} // FG_SpatialGrid::Receivers ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Check if at least one receiver wants data sent from Pos.
+ *        Unlike Receivers() this does not allocate memory.
+ * @param Pos position of the sender
+ * @retval true if a receiver is in range
+ */
+bool
+FG_SpatialGrid::AnyInRange ( const Point3D& Pos )
+{
+	if ( m_Entries.empty() )
+		return false;
+	if ( ! m_BoundsValid )
+		UpdateBounds ();
+	for ( int i = 0; i < 3; i++ )
+	{
+		if ( ( Pos[i] < m_Min[i] ) || ( Pos[i] > m_Max[i] ) )
+			return false;
+	}
+	if ( AnyInRange ( m_Wide, Pos ) )
+		return true;
+	int64_t X = (int64_t) floor ( Pos[0] / m_CellSize );
+	int64_t Y = (int64_t) floor ( Pos[1] / m_CellSize );
+	int64_t Z = (int64_t) floor ( Pos[2] / m_CellSize );
+	for ( int64_t x = X-1; x <= X+1; x++ )
+	{
+		for ( int64_t y = Y-1; y <= Y+1; y++ )
+		{
+			for ( int64_t z = Z-1; z <= Z+1; z++ )
+			{
+				CellMap::const_iterator C = m_Cells.find ( CellKey ( x, y, z ) );
+				if ( C == m_Cells.end() )
+					continue;
+				if ( AnyInRange ( C->second, Pos ) )
+					return true;
+			}
+		}
+	}
+	return false;
+} // FG_SpatialGrid::AnyInRange ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+bool
+FG_SpatialGrid::AnyInRange ( const Members& M, const Point3D& Pos ) const
+{
+	for ( size_t i = 0; i < M.IDs.size(); i += RANGE_MASK_BITS )
+	{
+		size_t Count = std::min<size_t> ( M.IDs.size() - i, RANGE_MASK_BITS );
+		if ( InRangeMask ( Pos, &M.X[i], &M.Y[i], &M.Z[i], &M.Range2[i], Count ) )
+			return true;
+	}
+	return false;
+} // FG_SpatialGrid::AnyInRange ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Return the distance from Pos to the nearest receiver,
+ *        regardless of its range. All receivers are visited, so the
+ *        result should be cached by the caller.
+ * @return the distance in nautical miles, negative if the grid is empty
+ */
+double
+FG_SpatialGrid::Nearest ( const Point3D& Pos ) const
+{
+	if ( m_Entries.empty() )
+		return -1.0;
+	double Min2 = Nearest2 ( m_Wide, Pos, HUGE_VAL );
+	CellMap::const_iterator C;
+	for ( C = m_Cells.begin(); C != m_Cells.end(); C++ )
+	{
+		Min2 = Nearest2 ( C->second, Pos, Min2 );
+	}
+	return sqrt ( Min2 ) / SG_NM_TO_METER;
+} // FG_SpatialGrid::Nearest ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Return the smaller of Min2 and the squared distance from Pos
+ *        to the nearest member of M
+ */
+double
+FG_SpatialGrid::Nearest2 ( const Members& M, const Point3D& Pos, double Min2 ) const
+{
+	for ( size_t i = 0; i < M.IDs.size(); i++ )
+	{
+		double DX = M.X[i] - Pos[0];
+		double DY = M.Y[i] - Pos[1];
+		double DZ = M.Z[i] - Pos[2];
+		double D2 = DX * DX + DY * DY + DZ * DZ;
+		Min2 = ( D2 < Min2 ) ? D2 : Min2;
+	}
+	return Min2;
+} // FG_SpatialGrid::Nearest2 ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Append the IDs of the members of M which are in range of Pos
+ */
+void
+FG_SpatialGrid::InRange
+(
+	const Members& M,
+	const Point3D& Pos,
+	std::vector<size_t>& IDs
+) const
+{
+	for ( size_t i = 0; i < M.IDs.size(); i += RANGE_MASK_BITS )
+	{
+		size_t Count = std::min<size_t> ( M.IDs.size() - i, RANGE_MASK_BITS );
+		uint64_t Mask = InRangeMask ( Pos, &M.X[i], &M.Y[i], &M.Z[i], &M.Range2[i], Count );
+		while ( Mask != 0 )
+		{
+			IDs.push_back ( M.IDs[i + LowestBit ( Mask )] );
+			Mask &= Mask - 1;
+		}
+	}
+} // FG_SpatialGrid::InRange ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Grow the bounding box so that the interest of E is covered.
+ *        An invalid box stays invalid, it is recalculated on demand.
+ */
+void
+FG_SpatialGrid::ExtendBounds ( const Entry& E )
+{
+	if ( ! m_BoundsValid )
+		return;
+	double R = E.Range * SG_NM_TO_METER;
+	m_Min.Set ( std::min<double> ( m_Min[0], E.Pos[0] - R ),
+		    std::min<double> ( m_Min[1], E.Pos[1] - R ),
+		    std::min<double> ( m_Min[2], E.Pos[2] - R ) );
+	m_Max.Set ( std::max<double> ( m_Max[0], E.Pos[0] + R ),
+		    std::max<double> ( m_Max[1], E.Pos[1] + R ),
+		    std::max<double> ( m_Max[2], E.Pos[2] + R ) );
+} // FG_SpatialGrid::ExtendBounds ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_SpatialGrid::UpdateBounds ()
+{
+	EntryMap::const_iterator E = m_Entries.begin();
+	if ( E == m_Entries.end() )
+		return;
+	double R = E->second.Range * SG_NM_TO_METER;
+	m_Min.Set ( E->second.Pos[0] - R, E->second.Pos[1] - R, E->second.Pos[2] - R );
+	m_Max.Set ( E->second.Pos[0] + R, E->second.Pos[1] + R, E->second.Pos[2] + R );
+	m_BoundsValid = true;
+	for ( E++; E != m_Entries.end(); E++ )
+	{
+		ExtendBounds ( E->second );
+	}
+} // FG_SpatialGrid::UpdateBounds ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+uint64_t
+FG_SpatialGrid::CellOf ( const Point3D& Pos ) const
+{
+	return CellKey (
+		(int64_t) floor ( Pos[0] / m_CellSize ),
+		(int64_t) floor ( Pos[1] / m_CellSize ),
+		(int64_t) floor ( Pos[2] / m_CellSize ) );
+} // FG_SpatialGrid::CellOf ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+uint64_t
+FG_SpatialGrid::CellKey ( int64_t X, int64_t Y, int64_t Z ) const
+{
+	return ( (uint64_t) ( ( X + CELL_BIAS ) & CELL_MASK ) << 42 )
+	     | ( (uint64_t) ( ( Y + CELL_BIAS ) & CELL_MASK ) << 21 )
+	     |   (uint64_t) ( ( Z + CELL_BIAS ) & CELL_MASK );
+} // FG_SpatialGrid::CellKey ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+FG_SpatialGrid::Members&
+FG_SpatialGrid::MembersOf ( const Entry& E )
+{
+	if ( E.Wide )
+		return m_Wide;
+	return m_Cells[E.Cell];
+} // FG_SpatialGrid::MembersOf ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Append a receiver to the members of its cell
+ */
+void
+FG_SpatialGrid::Link ( size_t ID, Entry& E )
+{
+	Members& M = MembersOf ( E );
+	E.Slot = M.IDs.size ();
+	M.IDs.push_back ( ID );
+	M.X.push_back ( 0 );
+	M.Y.push_back ( 0 );
+	M.Z.push_back ( 0 );
+	M.Range2.push_back ( 0 );
+	Store ( M, E );
+} // FG_SpatialGrid::Link ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Remove a receiver from the members of its cell. The last
+ *        member takes its slot.
+ */
+void
+FG_SpatialGrid::Unlink ( size_t ID, const Entry& E )
+{
+	CellMap::iterator C = m_Cells.end ();
+	if ( ! E.Wide )
+	{
+		C = m_Cells.find ( E.Cell );
+		if ( C == m_Cells.end() )
+			return;
+	}
+	Members& M = E.Wide ? m_Wide : C->second;
+	size_t Last = M.IDs.size () - 1;
+	if ( ( E.Slot > Last ) || ( M.IDs[E.Slot] != ID ) )
+		return;
+	if ( E.Slot != Last )
+	{
+		M.IDs[E.Slot]	 = M.IDs[Last];
+		M.X[E.Slot]	 = M.X[Last];
+		M.Y[E.Slot]	 = M.Y[Last];
+		M.Z[E.Slot]	 = M.Z[Last];
+		M.Range2[E.Slot] = M.Range2[Last];
+		m_Entries[M.IDs[E.Slot]].Slot = E.Slot;
+	}
+	M.IDs.pop_back ();
+	M.X.pop_back ();
+	M.Y.pop_back ();
+	M.Z.pop_back ();
+	M.Range2.pop_back ();
+	if ( ( ! E.Wide ) && M.IDs.empty() )
+		m_Cells.erase ( C );
+} // FG_SpatialGrid::Unlink ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Copy position and range of a receiver to its slot
+ */
+void
+FG_SpatialGrid::Store ( Members& M, const Entry& E )
+{
+	double R = E.Range * SG_NM_TO_METER;
+	M.X[E.Slot]	 = E.Pos[0];
+	M.Y[E.Slot]	 = E.Pos[1];
+	M.Z[E.Slot]	 = E.Pos[2];
+	M.Range2[E.Slot] = R * R;
+} // FG_SpatialGrid::Store ()
+//////////////////////////////////////////////////////////////////////
+
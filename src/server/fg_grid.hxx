@@ -0,0 +1,123 @@
+/**
+ * @file fg_grid.hxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, spatial index of players
+//
+//////////////////////////////////////////////////////////////////////
+
+#if !defined FG_GRID_HXX
+#define FG_GRID_HXX
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+#include "fg_geometry.hxx"
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @class FG_SpatialGrid
+ * @brief A voxel grid over earth centered (cartesian) coordinates
+ *
+ * Every entry is a receiver, identified by the ID of its list element,
+ * with a position and a range in nautical miles. A sender at position
+ * P is of interest to a receiver R if Distance (P, R) < R.Range.
+ *
+ * The edge length of a cell is chosen so that every receiver whose
+ * range does not exceed it is found in the 27 cells around the
+ * position of a sender. Receivers with a larger range are kept in a
+ * separate list, which is always part of the candidates.
+ *
+ * The positions and ranges of the receivers of a cell are kept as a
+ * structure of arrays, so that the distances are checked by the
+ * batch kernel InRangeMask() instead of one by one.
+ *
+ * Additionally a bounding box around the interest of all receivers
+ * (position +/- range) is cached, so that a sender far away from all
+ * receivers is rejected with a single comparison.
+ */
+class FG_SpatialGrid
+{
+public:
+	FG_SpatialGrid ();
+	/** set the edge length of a cell in nautical miles */
+	void	SetCellSize ( double NauticalMiles );
+	/** add a receiver, or update its position and range */
+	void	Update ( size_t ID, const Point3D& Pos, double Range );
+	/** remove a receiver */
+	void	Remove ( size_t ID );
+	/** remove all receivers */
+	void	Clear ();
+	/** number of receivers */
+	size_t	Size () const;
+	/** collect the IDs of all receivers which want data from Pos */
+	void	Receivers ( const Point3D& Pos, std::vector<size_t>& IDs );
+	/** true if at least one receiver wants data from Pos */
+	bool	AnyInRange ( const Point3D& Pos );
+	/** distance from Pos to the nearest receiver in nautical miles */
+	double	Nearest ( const Point3D& Pos ) const;
+private:
+	typedef std::vector<size_t>	IDList;
+	typedef std::vector<double>	DoubleList;
+	/** @brief the receivers of a cell, structure of arrays */
+	typedef struct
+	{
+		IDList		IDs;
+		DoubleList	X;
+		DoubleList	Y;
+		DoubleList	Z;
+		DoubleList	Range2;	// squared range in square meters
+	} Members;
+	typedef struct
+	{
+		uint64_t	Cell;
+		bool		Wide;
+		size_t		Slot;	// index in Members
+		Point3D		Pos;
+		double		Range;
+	} Entry;
+	typedef std::map<size_t,Entry>		EntryMap;
+	typedef std::map<uint64_t,Members>	CellMap;
+	uint64_t CellOf	( const Point3D& Pos ) const;
+	uint64_t CellKey ( int64_t X, int64_t Y, int64_t Z ) const;
+	Members& MembersOf ( const Entry& E );
+	void	Link	( size_t ID, Entry& E );
+	void	Unlink	( size_t ID, const Entry& E );
+	void	Store	( Members& M, const Entry& E );
+	bool	AnyInRange ( const Members& M, const Point3D& Pos ) const;
+	double	Nearest2 ( const Members& M, const Point3D& Pos, double Min2 ) const;
+	void	InRange	( const Members& M, const Point3D& Pos,
+			  std::vector<size_t>& IDs ) const;
+	void	ExtendBounds ( const Entry& E );
+	void	UpdateBounds ();
+	/** @brief edge length of a cell in meters */
+	double		m_CellSize;
+	/** @brief edge length of a cell in nautical miles */
+	double		m_CellRange;
+	EntryMap	m_Entries;
+	CellMap		m_Cells;
+	Members		m_Wide;
+	/** @brief bounding box of the interest of all receivers */
+	Point3D		m_Min;
+	Point3D		m_Max;
+	bool		m_BoundsValid;
+}; // class FG_SpatialGrid
+
+#endif
@@ -0,0 +1,484 @@
+/**
+ * @file fg_journal.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, durable message journal
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+
+#include <algorithm>
+#include <vector>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <simgear/debug/logstream.hxx>
+#include "fg_journal.hxx"
+#ifndef _MSC_VER
+	#include <dirent.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////
+FG_Journal::FG_Journal ()
+{
+	m_Open		= false;
+	m_Write.Number	= 0;
+	m_Write.Data	= 0;
+	m_Write.Size	= 0;
+	m_Read		= m_Write;
+	m_WritePos	= 0;
+	m_ReadPos	= 0;
+	m_Acked		= 0;
+	m_First		= 0;
+	m_Unacked	= 0;
+	m_Unread	= 0;
+	m_LastCheckpoint = 0;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+FG_Journal::~FG_Journal ()
+{
+	Close ();
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Open the journal in directory Dir. Segments before the last
+ *        checkpoint are deleted, the messages after it are counted.
+ *        A record which was not completely written when fgms stopped
+ *        ends the journal, it is overwritten by the next Append().
+ * @param Dir the directory of the journal, created if it does not exist
+ * @retval true if the journal is usable
+ */
+bool
+FG_Journal::Open ( const std::string& Dir )
+{
+#ifdef _MSC_VER
+	SG_LOG ( SG_FGMS, SG_ALERT, "FG_Journal: not supported on this platform" );
+	return false;
+#else
+	Close ();
+	m_Dir = Dir;
+	if ( ( mkdir ( Dir.c_str(), 0755 ) != 0 ) && ( errno != EEXIST ) )
+	{
+		SG_LOG ( SG_FGMS, SG_ALERT, "FG_Journal: could not create '"
+		  << Dir << "': " << strerror ( errno ) );
+		return false;
+	}
+	DIR* D = opendir ( Dir.c_str() );
+	if ( D == 0 )
+	{
+		SG_LOG ( SG_FGMS, SG_ALERT, "FG_Journal: could not open '"
+		  << Dir << "': " << strerror ( errno ) );
+		return false;
+	}
+	std::vector<uint32_t> Numbers;
+	struct dirent* E;
+	while ( ( E = readdir ( D ) ) != 0 )
+	{
+		unsigned int	N;
+		char		C;
+		if ( sscanf ( E->d_name, "journal.%8x%c", &N, &C ) == 1 )
+			Numbers.push_back ( N );
+	}
+	closedir ( D );
+	std::sort ( Numbers.begin(), Numbers.end() );
+	uint32_t	AckedSeg = 0;
+	size_t		AckedOff = 0;
+	FILE* F = fopen ( ( Dir + "/checkpoint" ).c_str(), "r" );
+	if ( F != 0 )
+	{
+		unsigned int	S;
+		unsigned long	O;
+		if ( fscanf ( F, "%x %lu", &S, &O ) == 2 )
+		{
+			AckedSeg = S;
+			AckedOff = O;
+		}
+		fclose ( F );
+	}
+	if ( Numbers.empty() )
+	{
+		AckedSeg = ( AckedSeg == 0 ) ? 1 : AckedSeg;
+		AckedOff = 0;
+		Numbers.push_back ( AckedSeg );
+	}
+	else if ( ( AckedSeg < Numbers.front() ) || ( AckedSeg > Numbers.back() ) )
+	{	// no or a stale checkpoint
+		AckedSeg = Numbers.front();
+		AckedOff = 0;
+	}
+	// count the messages after the checkpoint, find the end
+	size_t Count = 0;
+	for ( size_t i = 0; i < Numbers.size(); i++ )
+	{
+		if ( Numbers[i] < AckedSeg )
+		{
+			Remove ( Numbers[i] );
+			continue;
+		}
+		Segment S;
+		if ( ! Map ( Numbers[i], 0, S ) )
+		{
+			Unmap ( m_Write );
+			return false;
+		}
+		size_t Off = 0;
+		if ( Numbers[i] == AckedSeg )
+		{
+			Off = ( AckedOff > S.Size ) ? 0 : AckedOff;
+			AckedOff = Off;
+		}
+		uint32_t Len;
+		while ( Record ( S, Off, Len ) )
+		{
+			Off += HEADER_SIZE + Len;
+			Count++;
+		}
+		if ( i + 1 < Numbers.size() )
+		{
+			Unmap ( S );
+			continue;
+		}
+		// clear what follows the last record
+		size_t Last = S.Size;
+		while ( ( Last > Off ) && ( S.Data[Last - 1] == 0 ) )
+			Last--;
+		memset ( S.Data + Off, 0, Last - Off );
+		m_Write    = S;
+		m_WritePos = Off;
+	}
+	if ( ! Map ( AckedSeg, 0, m_Read ) )
+	{
+		Unmap ( m_Write );
+		return false;
+	}
+	m_ReadPos	= AckedOff;
+	m_Acked		= Pos ( AckedSeg, AckedOff );
+	m_First		= AckedSeg;
+	m_Unacked	= 0;
+	m_Unread	= Count;
+	m_Open		= true;
+	SG_LOG ( SG_FGMS, SG_ALERT, "FG_Journal: opened '" << Dir << "', "
+	  << Count << " messages to send" );
+	return true;
+#endif
+} // FG_Journal::Open ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_Journal::Close ()
+{
+	if ( ! m_Open )
+		return;
+	Checkpoint ();
+	Unmap ( m_Write );
+	Unmap ( m_Read );
+	m_Open   = false;
+	m_Unread = 0;
+} // FG_Journal::Close ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Append Msg to the journal. A new segment is started if Msg
+ *        does not fit into the current one.
+ * @retval false if the journal already has MAX_SEGMENTS segments or
+ *         the disk is full, Msg is dropped
+ */
+bool
+FG_Journal::Append ( const std::string& Msg )
+{
+	if ( ! m_Open )
+		return false;
+	if ( Msg.empty() )
+		return true;
+	size_t Need = HEADER_SIZE + Msg.size();
+	if ( m_WritePos + Need > m_Write.Size )
+	{
+		if ( m_Write.Number - m_First + 1 >= MAX_SEGMENTS )
+			return false;
+		Segment S;
+		if ( ! Map ( m_Write.Number + 1, Need, S ) )
+			return false;
+		Unmap ( m_Write );
+		m_Write    = S;
+		m_WritePos = 0;
+	}
+	// the length is written last, it makes the record valid
+	char*	 P   = m_Write.Data + m_WritePos;
+	uint32_t Len = Msg.size();
+	uint32_t Sum = Checksum ( Msg.data(), Len );
+	memcpy ( P + HEADER_SIZE, Msg.data(), Len );
+	memcpy ( P + 4, &Sum, 4 );
+	memcpy ( P, &Len, 4 );
+	m_WritePos += Need;
+	m_Unread.fetch_add ( 1, std::memory_order_relaxed );
+	return true;
+} // FG_Journal::Append ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Read the next message
+ * @param Msg receives the message
+ * @param Next receives the position after the message, pass it to
+ *        Ack() when the message is acknowledged
+ * @retval false if there is no message to read
+ */
+bool
+FG_Journal::Read ( std::string& Msg, Position& Next )
+{
+	if ( ( ! m_Open ) || ( Unread () == 0 ) )
+		return false;
+	uint32_t Len;
+	while ( ! Record ( m_Read, m_ReadPos, Len ) )
+	{	// end of the segment
+		if ( m_Read.Number >= m_Write.Number )
+		{	// should not happen, the count is wrong
+			m_Unread = 0;
+			return false;
+		}
+		Segment S;
+		if ( ! Map ( m_Read.Number + 1, 0, S ) )
+			return false;
+		Unmap ( m_Read );
+		m_Read    = S;
+		m_ReadPos = 0;
+	}
+	Msg.assign ( m_Read.Data + m_ReadPos + HEADER_SIZE, Len );
+	m_ReadPos += HEADER_SIZE + Len;
+	Next = Pos ( m_Read.Number, m_ReadPos );
+	m_Unread.fetch_sub ( 1, std::memory_order_relaxed );
+	m_Unacked++;
+	return true;
+} // FG_Journal::Read ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief The oldest message read, which ends at Next, is acknowledged.
+ *        Segments which are completely acknowledged are deleted. The
+ *        checkpoint is saved once per second at most.
+ */
+void
+FG_Journal::Ack ( Position Next )
+{
+	if ( ! m_Open )
+		return;
+	if ( m_Unacked > 0 )
+		m_Unacked--;
+	m_Acked = Next;
+	uint32_t Number = Next >> 32;
+	while ( m_First < Number )
+	{
+		Remove ( m_First );
+		m_First++;
+	}
+	if ( time ( 0 ) != m_LastCheckpoint )
+		Checkpoint ();
+} // FG_Journal::Ack ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_Journal::Rewind ()
+{
+	if ( ! m_Open )
+		return;
+	uint32_t Number = m_Acked >> 32;
+	if ( m_Read.Number != Number )
+	{
+		Segment S;
+		if ( ! Map ( Number, 0, S ) )
+			return;
+		Unmap ( m_Read );
+		m_Read = S;
+	}
+	m_ReadPos = ( uint32_t ) m_Acked;
+	m_Unread.fetch_add ( m_Unacked, std::memory_order_relaxed );
+	m_Unacked = 0;
+} // FG_Journal::Rewind ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Save the acknowledged position. The file is replaced, so it
+ *        is never seen half written.
+ */
+void
+FG_Journal::Checkpoint ()
+{
+	std::string Name = m_Dir + "/checkpoint";
+	std::string Tmp  = Name + ".tmp";
+	m_LastCheckpoint = time ( 0 );
+	FILE* F = fopen ( Tmp.c_str(), "w" );
+	if ( F == 0 )
+	{
+		SG_LOG ( SG_FGMS, SG_ALERT, "FG_Journal: could not write '"
+		  << Tmp << "': " << strerror ( errno ) );
+		return;
+	}
+	fprintf ( F, "%08x %lu\n", ( unsigned int ) ( m_Acked >> 32 ),
+	  ( unsigned long ) ( uint32_t ) m_Acked );
+	fclose ( F );
+	rename ( Tmp.c_str(), Name.c_str() );
+} // FG_Journal::Checkpoint ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Map segment Number, create it if it does not exist. The
+ *        blocks of a new segment are allocated at once, so a full disk
+ *        is noticed here and not when the mapping is written to.
+ * @param MinSize minimum size of a new segment
+ */
+bool
+FG_Journal::Map ( uint32_t Number, size_t MinSize, Segment& S )
+{
+#ifdef _MSC_VER
+	return false;
+#else
+	std::string Name = SegmentName ( Number );
+	int Fd = open ( Name.c_str(), O_RDWR | O_CREAT, 0644 );
+	if ( Fd < 0 )
+	{
+		SG_LOG ( SG_FGMS, SG_ALERT, "FG_Journal: could not open '"
+		  << Name << "': " << strerror ( errno ) );
+		return false;
+	}
+	struct stat St;
+	if ( fstat ( Fd, &St ) != 0 )
+	{
+		close ( Fd );
+		return false;
+	}
+	size_t Size = St.st_size;
+	if ( Size == 0 )
+	{
+		Size = std::max ( MinSize, ( size_t ) SEGMENT_SIZE );
+		int Err = posix_fallocate ( Fd, 0, Size );
+		if ( Err != 0 )
+		{
+			SG_LOG ( SG_FGMS, SG_ALERT, "FG_Journal: could not allocate '"
+			  << Name << "': " << strerror ( Err ) );
+			close ( Fd );
+			unlink ( Name.c_str() );
+			return false;
+		}
+	}
+	void* Data = mmap ( 0, Size, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0 );
+	close ( Fd );
+	if ( Data == MAP_FAILED )
+	{
+		SG_LOG ( SG_FGMS, SG_ALERT, "FG_Journal: could not map '"
+		  << Name << "': " << strerror ( errno ) );
+		return false;
+	}
+	S.Number = Number;
+	S.Data   = ( char* ) Data;
+	S.Size   = Size;
+	return true;
+#endif
+} // FG_Journal::Map ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_Journal::Unmap ( Segment& S )
+{
+#ifndef _MSC_VER
+	if ( S.Data != 0 )
+	{
+		munmap ( S.Data, S.Size );
+	}
+#endif
+	S.Data = 0;
+	S.Size = 0;
+} // FG_Journal::Unmap ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Check the record at Offset of segment S
+ * @param Len receives the length of the message
+ * @retval false at the end of the segment or if the record is broken
+ */
+bool
+FG_Journal::Record ( const Segment& S, size_t Offset, uint32_t& Len ) const
+{
+	uint32_t Sum;
+	if ( Offset + HEADER_SIZE > S.Size )
+		return false;
+	memcpy ( &Len, S.Data + Offset, 4 );
+	memcpy ( &Sum, S.Data + Offset + 4, 4 );
+	if ( ( Len == 0 ) || ( Len > S.Size - Offset - HEADER_SIZE ) )
+		return false;
+	return Checksum ( S.Data + Offset + HEADER_SIZE, Len ) == Sum;
+} // FG_Journal::Record ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_Journal::Remove ( uint32_t Number )
+{
+#ifndef _MSC_VER
+	unlink ( SegmentName ( Number ).c_str() );
+#endif
+} // FG_Journal::Remove ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+std::string
+FG_Journal::SegmentName ( uint32_t Number ) const
+{
+	char Name[32];
+	snprintf ( Name, sizeof ( Name ), "/journal.%08x", Number );
+	return m_Dir + Name;
+} // FG_Journal::SegmentName ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @return the FNV-1a hash of Data
+ */
+uint32_t
+FG_Journal::Checksum ( const char* Data, size_t Len )
+{
+	uint32_t H = 2166136261U;
+	for ( size_t i = 0; i < Len; i++ )
+	{
+		H ^= ( unsigned char ) Data[i];
+		H *= 16777619U;
+	}
+	return H;
+} // FG_Journal::Checksum ()
+//////////////////////////////////////////////////////////////////////
+
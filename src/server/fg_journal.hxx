@@ -0,0 +1,116 @@
+/**
+ * @file fg_journal.hxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, durable message journal
+//
+//////////////////////////////////////////////////////////////////////
+
+#if !defined FG_JOURNAL_HXX
+#define FG_JOURNAL_HXX
+
+#include <atomic>
+#include <string>
+#include <time.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @class FG_Journal
+ * @brief An append only queue of messages on disk
+ *
+ * The messages are appended to segment files of SEGMENT_SIZE bytes,
+ * which are memory mapped. Every message is stored as a record of its
+ * length, a checksum and the message itself.
+ *
+ * The journal has two read positions. Read() advances the read
+ * position, Ack() advances the acknowledged position, which is saved
+ * to a checkpoint file. Rewind() goes back to the acknowledged
+ * position, so messages which were read but never acknowledged are
+ * read again. Segments before the acknowledged position are deleted.
+ *
+ * Open() resumes from the last checkpoint, so messages which were not
+ * acknowledged before fgms stopped are read again.
+ *
+ * NOT thread safe, except for Unread().
+ */
+class FG_Journal
+{
+public:
+	/** @brief segment number in the high, offset in the low 32 bits */
+	typedef uint64_t Position;
+	enum
+	{
+		SEGMENT_SIZE	= 8 * 1024 * 1024,
+		MAX_SEGMENTS	= 64,	// Append() fails beyond
+		HEADER_SIZE	= 8	// length and checksum of a record
+	};
+	FG_Journal ();
+	~FG_Journal ();
+	/** open the journal in directory Dir, create it if needed */
+	bool	Open ( const std::string& Dir );
+	/** save the checkpoint and close the journal */
+	void	Close ();
+	/** true if the journal is open */
+	bool	IsOpen () const { return m_Open; }
+	/** append Msg, false if the journal is full */
+	bool	Append ( const std::string& Msg );
+	/** read the next message, Next receives the position after it */
+	bool	Read ( std::string& Msg, Position& Next );
+	/** the oldest message read is acknowledged, it ends at Next */
+	void	Ack ( Position Next );
+	/** read all messages again which are not acknowledged */
+	void	Rewind ();
+	/** save the acknowledged position */
+	void	Checkpoint ();
+	/** number of messages not read, thread safe */
+	size_t	Unread () const { return m_Unread.load ( std::memory_order_relaxed ); }
+private:
+	FG_Journal ( const FG_Journal& );
+	void operator = ( const FG_Journal& );
+	typedef struct
+	{
+		uint32_t	Number;
+		char*		Data;
+		size_t		Size;
+	} Segment;
+	bool	Map ( uint32_t Number, size_t MinSize, Segment& S );
+	void	Unmap ( Segment& S );
+	bool	Record ( const Segment& S, size_t Offset, uint32_t& Len ) const;
+	void	Remove ( uint32_t Number );
+	std::string	SegmentName ( uint32_t Number ) const;
+	static uint32_t	Checksum ( const char* Data, size_t Len );
+	static Position	Pos ( uint32_t Number, size_t Offset )
+			{ return ( ( Position ) Number << 32 ) | Offset; }
+	std::string		m_Dir;
+	bool			m_Open;
+	Segment			m_Write;	// the segment appended to
+	size_t			m_WritePos;
+	Segment			m_Read;		// the segment read from
+	size_t			m_ReadPos;
+	Position		m_Acked;
+	uint32_t		m_First;	// oldest segment on disk
+	size_t			m_Unacked;	// read, but not acknowledged
+	std::atomic<size_t>	m_Unread;
+	time_t			m_LastCheckpoint;
+}; // class FG_Journal
+
+#endif
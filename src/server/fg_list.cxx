@@ -145,12 +145,11 @@ FG_Player::FG_Player()
 	ModelName	= "";
 	Error		= "";
 	HasErrors	= false;
-	DoUpdate	= false;
 	IsATC		= ATC_NONE;
 	RadarRange	= 0;
 	ProtoMajor	= 0;
 	ProtoMinor	= 0;
-	LastRelayedToInactive = 0;
+	m_GeodValid	= false;
 }
 //////////////////////////////////////////////////////////////////////
 
@@ -165,12 +164,11 @@ FG_Player::FG_Player( const string& Name )
 	ModelName 	= "";
 	Error 		= "";
 	HasErrors 	= false;
-	DoUpdate	= false;
 	IsATC		= ATC_NONE;
 	RadarRange	= 0;
 	ProtoMajor	= 0;
 	ProtoMinor	= 0;
-	LastRelayedToInactive = 0;
+	m_GeodValid	= false;
 }
 //////////////////////////////////////////////////////////////////////
 
@@ -205,6 +203,39 @@ FG_Player::operator ==( const FG_Player& P )
 }
 //////////////////////////////////////////////////////////////////////
 
+//////////////////////////////////////////////////////////////////////
+/**
+ * Set the position of the player in cartesian coordinates. The
+ * geodetic position is not calculated until GetGeodPos() is called.
+ */
+void
+FG_Player::SetPosition( double x, double y, double z )
+{
+	LastPos.Set ( x, y, z );
+	m_GeodValid = false;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** NOT thread safe
+ *
+ * Return the geodetic position of LastPos, which is calculated only
+ * once per position update. Call with the list locked, on an own
+ * copy, or on an element of a snapshot, whose position is calculated
+ * by mT_FG_List::Publish().
+ */
+const Point3D&
+FG_Player::GetGeodPos() const
+{
+	if ( ! m_GeodValid )
+	{
+		CartToGeod ( LastPos, m_GeodPos );
+		m_GeodValid = true;
+	}
+	return m_GeodPos;
+}
+//////////////////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////////////////
 void
 FG_Player::assign( const FG_Player& P )
@@ -220,7 +251,8 @@ FG_Player::assign( const FG_Player& P )
 	LastSeen = P.LastSeen ;
 	LastSent = P.LastSent ;
 	LastPos = P.LastPos;
-	GeodPos = P.GeodPos;
+	m_GeodPos = P.m_GeodPos;
+	m_GeodValid = P.m_GeodValid;
 	IsLocal = P.IsLocal;
 	IsATC = P.IsATC;
 	RadarRange = P.RadarRange;
@@ -229,7 +261,5 @@ FG_Player::assign( const FG_Player& P )
 	Error = P.Error.c_str();
 	HasErrors = P.HasErrors;
 	LastOrientation	= P.LastOrientation;
-	DoUpdate	= P.DoUpdate;
-	LastRelayedToInactive = P.LastRelayedToInactive;
 }
 //////////////////////////////////////////////////////////////////////
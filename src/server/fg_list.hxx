@@ -32,6 +32,8 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <memory>
 #include <plib/netSocket.h>
 #include <pthread.h>
 #include <fg_geometry.hxx>
@@ -115,10 +117,8 @@ public:
 	string	Passwd;
 	/** @brief The model name */
 	string	ModelName;
-	/** @brief The last recorded position */
+	/** @brief The last recorded position, use SetPosition() to change it */
 	Point3D	LastPos;
-	/** @brief The last recorded position in geodectic coordinates (lat/lon/alt) */
-	Point3D	GeodPos;
 	/** @brief The last recorded orientation */
 	Point3D	LastOrientation;
 	/** @brief \b true if this client is directly connected to this \ref fgms instance */
@@ -139,20 +139,28 @@ public:
 	 * @see FG_SERVER::AddBadClient
 	 */
 	bool	HasErrors;
-	/** when did we sent updates of this player to inactive relays */
-	time_t	LastRelayedToInactive;
-	/** \b true if we need to send updates to inactive relays */
-	bool	DoUpdate;
 	FG_Player ();
 	FG_Player ( const std::string& Name );
 	FG_Player ( const FG_Player& P);
 	~FG_Player ();
 	void operator =  ( const FG_Player& P );
 	virtual bool operator ==  ( const FG_Player& P );
+	/** set LastPos, the geodetic position is recalculated on demand */
+	void SetPosition ( double x, double y, double z );
+	/** the last recorded position in geodetic coordinates (lat/lon/alt) */
+	const Point3D& GetGeodPos () const;
 private:
 	void assign ( const FG_Player& P );
+	/** @brief cache of GetGeodPos(), valid if m_GeodValid is \b true */
+	mutable Point3D	m_GeodPos;
+	mutable bool	m_GeodValid;
 }; // FG_Player
 
+/** @brief make an element ready to be shared by the readers of a snapshot */
+inline void PrepareSnapshot ( FG_ListElement& ) {}
+/** @brief readers must not write to the cache of the geodetic position */
+inline void PrepareSnapshot ( FG_Player& Player ) { Player.GetGeodPos (); }
+
 /** 
  * @class mT_FG_List
  * @brief a generic list implementation for fgms
@@ -164,6 +172,8 @@ class mT_FG_List
 public:
 	typedef std::vector<T> ListElements;
 	typedef typename std::vector<T>::iterator ListIterator;
+	/** an immutable copy of all elements, see Publish() */
+	typedef std::shared_ptr<const ListElements> Snapshot;
 	/** constructor, must supply a Name */
 	mT_FG_List   ( const std::string& Name );
 	~mT_FG_List  ();
@@ -183,6 +193,8 @@ public:
 	ListIterator Find	( const netAddress& Address, const std::string& Name = "" );
 	/** find an element by its Name */
 	ListIterator FindByName	( const std::string& Name = "" );
+	/** find an element by a (not necessarily terminated) name buffer */
+	ListIterator FindByName	( const char* Name, size_t MaxLen );
 	/** find an element by its ID */
 	ListIterator FindByID	( size_t ID );
 	/** return an iterator of the first element */
@@ -205,6 +217,10 @@ public:
 	void Unlock();
 	/** return a copy of an element at position x (thread safe) */
 	T operator []( const size_t& Index );
+	/** make a copy of all elements available to readers */
+	void Publish ();
+	/** the last published copy of all elements (lock free) */
+	Snapshot GetSnapshot () const;
 	/** @brief maximum entries this list ever had */
 	size_t		MaxID;
 	/** @brief Count of packets recieved from client */
@@ -226,6 +242,25 @@ private:
 	mT_FG_List ();
 	/** the actual storage of elements */
 	ListElements	Elements;
+	/** @brief the last published copy of Elements */
+	Snapshot	m_Snapshot;
+	/** @brief a slot of the name index */
+	typedef struct
+	{
+		size_t	Pos;	// position in Elements, NONE_EXISTANT if free
+		size_t	Hash;	// hash of the Name of Elements[Pos]
+	} IndexSlot;
+	/** @brief open addressing (linear probing) hash index over Name */
+	std::vector<IndexSlot>	m_NameIndex;
+	/** @brief maps the ID of an element to its position in Elements */
+	std::map<size_t,size_t>	m_IDIndex;
+	static size_t HashName	( const char* Name, size_t Len );
+	size_t IndexLookup	( const char* Name, size_t Len ) const;
+	size_t IndexFind	( size_t Pos ) const;
+	void   IndexInsert	( size_t Pos );
+	void   IndexErase	( size_t Pos );
+	void   IndexRebuild	( size_t Capacity );
+	size_t RemoveAt		( size_t Pos );
 };
 
 typedef mT_FG_List<FG_ListElement>		FG_List;
@@ -246,10 +281,13 @@ mT_FG_List<T>::mT_FG_List
 {
 	pthread_mutex_init ( &m_ListMutex, 0 );
 	this->Name	= Name;
+	MaxID		= 0;
 	PktsSent	= 0;
 	BytesSent	= 0;
 	PktsRcvd	= 0;
 	BytesRcvd	= 0;
+	IndexRebuild ( 64 );
+	m_Snapshot.reset ( new ListElements );
 }
 //////////////////////////////////////////////////////////////////////
 
@@ -296,6 +334,8 @@ mT_FG_List<T>::Add( T& Element, time_t TTL)
 	Element.Timeout	= TTL;
 //	pthread_mutex_lock   ( & m_ListMutex );
 	Elements.push_back   ( Element );
+	IndexInsert ( Elements.size() - 1 );
+	m_IDIndex[Element.ID] = Elements.size() - 1;
 //	pthread_mutex_unlock ( & m_ListMutex );
 	return this->MaxID;
 }
@@ -307,28 +347,28 @@ void
 mT_FG_List<T>::DeleteByPosition (int position)
 {
 	pthread_mutex_lock ( & m_ListMutex );
-	ListIterator Element;
 	this->LastRun = time (0);
-	Element = Elements.begin();
-	std::advance (Element,position);
-	Elements.erase   ( Element );
+	RemoveAt ( position );
 	pthread_mutex_unlock ( & m_ListMutex );
 }
 //////////////////////////////////////////////////////////////////////
 /** thread safe
  *
- * Delete an entry from the list
+ * Delete an entry from the list. The last element of the list is
+ * moved into the position of the deleted one, so the returned
+ * iterator points to an element which was not yet visited (or End()).
  * @param Element iterator pointing to the element to delete
+ * @return iterator pointing to the element following the deleted one
  */
 template <class T>
 typename std::vector<T>::iterator
 mT_FG_List<T>::Delete( const ListIterator& Element)
 {
-	ListIterator E;
+	size_t Pos;
 	pthread_mutex_lock   ( & m_ListMutex );
-	E = Elements.erase   ( Element );
+	Pos = RemoveAt ( Element - Elements.begin() );
 	pthread_mutex_unlock ( & m_ListMutex );
-	return (E);
+	return (Elements.begin() + Pos);
 }
 //////////////////////////////////////////////////////////////////////
 
@@ -399,7 +439,7 @@ mT_FG_List<T>::Find( const netAddress& Address, const std::string& Name)
 //////////////////////////////////////////////////////////////////////
 /** NOT thread safe
  *
- * Find an element by Name.
+ * Find an element by Name, using the name index.
  * @param Name The name (or description) of the element
  * @return iterator pointing to the found element, or End() if element
  *         could not be found
@@ -408,22 +448,36 @@ template <class T>
 typename std::vector<T>::iterator
 mT_FG_List<T>::FindByName( const std::string& Name)
 {
-	ListIterator Element;
-	ListIterator RetElem;
+	return FindByName ( Name.c_str(), Name.size() );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** NOT thread safe
+ *
+ * Find an element by Name, where Name is a buffer of at most MaxLen
+ * characters which need not be terminated (eg. T_MsgHdr::Name).
+ * @param Name The name (or description) of the element
+ * @param MaxLen The size of the Name buffer
+ * @return iterator pointing to the found element, or End() if element
+ *         could not be found
+ */
+template <class T>
+typename std::vector<T>::iterator
+mT_FG_List<T>::FindByName( const char* Name, size_t MaxLen )
+{
+	size_t Len;
+	size_t Pos;
 
 	this->LastRun = time (0);
-	RetElem = Elements.end();
-	Element = Elements.begin();
-	while (Element != Elements.end())
-	{
-		if (Element->Name == Name)
-		{
-			Element->LastSeen = this->LastRun;
-			return Element;
-		}
-		Element++;
-	}
-	return RetElem;
+	Len = 0;
+	while ((Len < MaxLen) && (Name[Len] != 0))
+		Len++;
+	Pos = IndexLookup ( Name, Len );
+	if (Pos == FG_ListElement::NONE_EXISTANT)
+		return Elements.end();
+	Elements[Pos].LastSeen = this->LastRun;
+	return Elements.begin() + Pos;
 }
 //////////////////////////////////////////////////////////////////////
 
@@ -440,21 +494,12 @@ typename std::vector<T>::iterator
 mT_FG_List<T>::FindByID
 ( size_t ID )
 {
-	ListIterator Element;
-	ListIterator RetElem;
+	std::map<size_t,size_t>::const_iterator Entry;
 	this->LastRun = time (0);
-	RetElem = Elements.end();
-	Element = Elements.begin();
-	while (Element != Elements.end())
-	{
-		if (Element->ID == ID)
-		{
-			RetElem = Element;
-			break;
-		}
-		Element++;
-	}
-	return RetElem;
+	Entry = m_IDIndex.find ( ID );
+	if (Entry == m_IDIndex.end())
+		return Elements.end();
+	return Elements.begin() + Entry->second;
 }
 //////////////////////////////////////////////////////////////////////
 
@@ -689,7 +734,228 @@ mT_FG_List<T>::Clear()
 {
 	Lock ();
 	Elements.clear ();
+	IndexRebuild ( 64 );
+	m_IDIndex.clear ();
+	Unlock ();
+	std::atomic_store ( &m_Snapshot, Snapshot ( new ListElements ) );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** thread safe
+ * Copy all elements into a new snapshot and make it the current one.
+ * Readers which still use the old snapshot keep it alive until they
+ * are done with it (read-copy-update). The elements are prepared
+ * first, see PrepareSnapshot().
+ */
+template <class T>
+void
+mT_FG_List<T>::Publish()
+{
+	Lock ();
+	for ( size_t i = 0; i < Elements.size(); i++ )
+	{
+		PrepareSnapshot ( Elements[i] );
+	}
+	Snapshot Copy ( new ListElements ( Elements ) );
 	Unlock ();
+	std::atomic_store ( &m_Snapshot, Copy );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** thread safe
+ * Return the last published snapshot. The list mutex is not taken,
+ * so readers never contend with writers of the list. The snapshot is
+ * never modified, but may be out of date by one publishing period.
+ */
+template <class T>
+typename mT_FG_List<T>::Snapshot
+mT_FG_List<T>::GetSnapshot() const
+{
+	return std::atomic_load ( &m_Snapshot );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ *
+ * FNV-1a hash of a name.
+ */
+template <class T>
+size_t
+mT_FG_List<T>::HashName( const char* Name, size_t Len )
+{
+	uint64_t Hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < Len; i++)
+	{
+		Hash ^= (unsigned char) Name[i];
+		Hash *= 1099511628211ULL;
+	}
+	return (size_t) Hash;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** NOT thread safe
+ *
+ * Lookup Name in the name index.
+ * @return the position of the element in Elements, or NONE_EXISTANT
+ */
+template <class T>
+size_t
+mT_FG_List<T>::IndexLookup( const char* Name, size_t Len ) const
+{
+	size_t Mask = m_NameIndex.size() - 1;
+	size_t Hash = HashName ( Name, Len );
+	size_t Slot = Hash & Mask;
+	while (m_NameIndex[Slot].Pos != FG_ListElement::NONE_EXISTANT)
+	{
+		const IndexSlot& S = m_NameIndex[Slot];
+		if ((S.Hash == Hash)
+		&&  (Elements[S.Pos].Name.compare (0, string::npos, Name, Len) == 0))
+		{
+			return S.Pos;
+		}
+		Slot = (Slot + 1) & Mask;
+	}
+	return FG_ListElement::NONE_EXISTANT;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** NOT thread safe
+ *
+ * @return the index slot which refers to Elements[Pos]
+ */
+template <class T>
+size_t
+mT_FG_List<T>::IndexFind( size_t Pos ) const
+{
+	size_t Mask = m_NameIndex.size() - 1;
+	const string& Name = Elements[Pos].Name;
+	size_t Slot = HashName ( Name.c_str(), Name.size() ) & Mask;
+	while (m_NameIndex[Slot].Pos != Pos)
+	{
+		Slot = (Slot + 1) & Mask;
+	}
+	return Slot;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** NOT thread safe
+ *
+ * Add Elements[Pos] to the name index. The index is kept at a load
+ * factor of at most 50%.
+ */
+template <class T>
+void
+mT_FG_List<T>::IndexInsert( size_t Pos )
+{
+	if (Elements.size() * 2 > m_NameIndex.size())
+	{
+		IndexRebuild ( m_NameIndex.size() * 2 );
+		return;	// Elements[Pos] was indexed by the rebuild
+	}
+	size_t Mask = m_NameIndex.size() - 1;
+	const string& Name = Elements[Pos].Name;
+	size_t Hash = HashName ( Name.c_str(), Name.size() );
+	size_t Slot = Hash & Mask;
+	while (m_NameIndex[Slot].Pos != FG_ListElement::NONE_EXISTANT)
+	{
+		Slot = (Slot + 1) & Mask;
+	}
+	m_NameIndex[Slot].Pos  = Pos;
+	m_NameIndex[Slot].Hash = Hash;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** NOT thread safe
+ *
+ * Remove Elements[Pos] from the name index. Following entries of the
+ * probe sequence are shifted back, so no tombstones are needed.
+ */
+template <class T>
+void
+mT_FG_List<T>::IndexErase( size_t Pos )
+{
+	size_t Mask = m_NameIndex.size() - 1;
+	size_t Hole = IndexFind ( Pos );
+	size_t Slot = Hole;
+	for (;;)
+	{
+		Slot = (Slot + 1) & Mask;
+		if (m_NameIndex[Slot].Pos == FG_ListElement::NONE_EXISTANT)
+			break;
+		size_t Home = m_NameIndex[Slot].Hash & Mask;
+		// move the entry if its home slot is not in (Hole, Slot]
+		if (((Slot > Hole) && ((Home <= Hole) || (Home > Slot)))
+		||  ((Slot < Hole) && ((Home <= Hole) && (Home > Slot))))
+		{
+			m_NameIndex[Hole] = m_NameIndex[Slot];
+			Hole = Slot;
+		}
+	}
+	m_NameIndex[Hole].Pos = FG_ListElement::NONE_EXISTANT;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** NOT thread safe
+ *
+ * Resize the name index to Capacity slots (a power of 2) and add
+ * all elements.
+ */
+template <class T>
+void
+mT_FG_List<T>::IndexRebuild( size_t Capacity )
+{
+	IndexSlot Free;
+	Free.Pos  = FG_ListElement::NONE_EXISTANT;
+	Free.Hash = 0;
+	while (Capacity < Elements.size() * 2)
+		Capacity *= 2;
+	m_NameIndex.assign ( Capacity, Free );
+	size_t Mask = Capacity - 1;
+	for (size_t Pos = 0; Pos < Elements.size(); Pos++)
+	{
+		const string& Name = Elements[Pos].Name;
+		size_t Hash = HashName ( Name.c_str(), Name.size() );
+		size_t Slot = Hash & Mask;
+		while (m_NameIndex[Slot].Pos != FG_ListElement::NONE_EXISTANT)
+		{
+			Slot = (Slot + 1) & Mask;
+		}
+		m_NameIndex[Slot].Pos  = Pos;
+		m_NameIndex[Slot].Hash = Hash;
+	}
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** NOT thread safe
+ *
+ * Remove the element at position Pos. The last element is moved into
+ * its place, which keeps removal O(1). Element IDs are not affected.
+ * @return Pos, which now holds the former last element (or is the end)
+ */
+template <class T>
+size_t
+mT_FG_List<T>::RemoveAt( size_t Pos )
+{
+	size_t Last = Elements.size() - 1;
+	IndexErase ( Pos );
+	m_IDIndex.erase ( Elements[Pos].ID );
+	if (Pos != Last)
+	{
+		m_NameIndex[IndexFind ( Last )].Pos = Pos;
+		m_IDIndex[Elements[Last].ID] = Pos;
+		Elements[Pos] = Elements[Last];
+	}
+	Elements.pop_back ();
+	return Pos;
 }
 //////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,386 @@
+/**
+ * @file fg_lod.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, level of detail for local clients
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+
+#include <time.h>
+#include <math.h>
+#include <stdlib.h>
+#include <sstream>
+#include "fg_lod.hxx"
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Convert an angle axis vector to a quaternion (w,x,y,z)
+ */
+static void
+AngleAxisToQuat ( const double* V, double* Q )
+{
+	double Angle = sqrt ( V[0]*V[0] + V[1]*V[1] + V[2]*V[2] );
+	if ( Angle < 1e-9 )
+	{
+		Q[0] = 1;
+		Q[1] = Q[2] = Q[3] = 0;
+		return;
+	}
+	double S = sin ( Angle / 2 ) / Angle;
+	Q[0] = cos ( Angle / 2 );
+	Q[1] = V[0] * S;
+	Q[2] = V[1] * S;
+	Q[3] = V[2] * S;
+} // AngleAxisToQuat ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Rotate V from the body frame of the unit quaternion Q to
+ *        the earth centered frame (SGQuat::backTransform())
+ */
+static void
+BodyToEarth ( const double* Q, const float* V, double* R )
+{
+	double Dot = Q[1]*V[0] + Q[2]*V[1] + Q[3]*V[2];
+	double F   = 2*Q[0]*Q[0] - 1;
+	R[0] = F*V[0] + 2*Dot*Q[1] + 2*Q[0] * ( Q[2]*V[2] - Q[3]*V[1] );
+	R[1] = F*V[1] + 2*Dot*Q[2] + 2*Q[0] * ( Q[3]*V[0] - Q[1]*V[2] );
+	R[2] = F*V[2] + 2*Dot*Q[3] + 2*Q[0] * ( Q[1]*V[1] - Q[2]*V[0] );
+} // BodyToEarth ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief R = A * B
+ */
+static void
+QuatMult ( const double* A, const double* B, double* R )
+{
+	R[0] = A[0]*B[0] - A[1]*B[1] - A[2]*B[2] - A[3]*B[3];
+	R[1] = A[0]*B[1] + A[1]*B[0] + A[2]*B[3] - A[3]*B[2];
+	R[2] = A[0]*B[2] - A[1]*B[3] + A[2]*B[0] + A[3]*B[1];
+	R[3] = A[0]*B[3] + A[1]*B[2] - A[2]*B[1] + A[3]*B[0];
+} // QuatMult ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+FG_LodPolicy::FG_LodPolicy ()
+{
+	Forwarded  = 0;
+	Thinned    = 0;
+	Predicted  = 0;
+	m_MaxAngle = 5 * M_PI / 180;
+	m_Silence  = 1000;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the bands of the policy
+ * @param Spec a list of 'range:rate[:error]' separated by blanks or
+ *        commas, range in nautical miles, rate in packets per second,
+ *        error in meters. The ranges must ascend. An empty list
+ *        disables the policy
+ * @retval false if Spec is invalid, the bands are not changed then
+ */
+bool
+FG_LodPolicy::SetBands ( const std::string& Spec )
+{
+	std::vector<Band> Bands;
+	const char* P = Spec.c_str ();
+	while ( *P != 0 )
+	{
+		if ( ( *P == ' ' ) || ( *P == '\t' ) || ( *P == ',' ) )
+		{
+			P++;
+			continue;
+		}
+		char* End;
+		Band B;
+		B.Range = strtod ( P, &End );
+		if ( ( End == P ) || ( *End != ':' ) || ( B.Range <= 0 ) )
+			return false;
+		P = End + 1;
+		long Rate = strtol ( P, &End, 10 );
+		if ( ( End == P ) || ( Rate < 0 ) || ( Rate > 1000 ) )
+			return false;
+		B.Error = 0;
+		if ( *End == ':' )
+		{
+			P = End + 1;
+			B.Error = strtod ( P, &End );
+			if ( ( End == P ) || ( B.Error < 0 ) )
+				return false;
+		}
+		if ( ( *End != 0 ) && ( *End != ' ' ) && ( *End != '\t' ) && ( *End != ',' ) )
+			return false;
+		P = End;
+		if ( ( ! Bands.empty () ) && ( B.Range <= Bands.back().Range ) )
+			return false;
+		if ( Bands.size () == MAX_BANDS )
+			return false;
+		B.Rate     = Rate;
+		B.Interval = ( Rate == 0 ) ? 0 : 1000 / Rate;
+		Bands.push_back ( B );
+	}
+	m_Bands = Bands;
+	Clear ();
+	return true;
+} // FG_LodPolicy::SetBands ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_LodPolicy::SetAngle ( int Degrees )
+{
+	m_MaxAngle = ( Degrees < 0 ) ? 0 : Degrees * M_PI / 180;
+} // FG_LodPolicy::SetAngle ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_LodPolicy::SetSilence ( int Ms )
+{
+	m_Silence = ( Ms < 0 ) ? 0 : Ms;
+} // FG_LodPolicy::SetSilence ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+std::string
+FG_LodPolicy::GetBands () const
+{
+	std::ostringstream S;
+	for ( size_t i = 0; i < m_Bands.size (); i++ )
+	{
+		if ( i > 0 )
+			S << " ";
+		S << m_Bands[i].Range << ":" << m_Bands[i].Rate;
+		if ( m_Bands[i].Error > 0 )
+			S << ":" << m_Bands[i].Error;
+	}
+	return S.str ();
+} // FG_LodPolicy::GetBands ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Decide if a packet of a sender is forwarded to a receiver
+ * @param Sender the ID of the sender
+ * @param Receiver the ID of the receiver
+ * @param Distance between both in nautical miles. Receivers beyond
+ *        the last band are treated as in the last band
+ * @param Motion the motion sent in the packet
+ * @retval true if the packet should be forwarded
+ *
+ * A packet is forwarded if the interval of the band has passed since
+ * the last forwarded packet. Packets may be early by a quarter of the
+ * interval, so a sender which sends exactly at the rate of the band
+ * is not thinned because of jitter. The next packet is due one
+ * interval after the last one was due, so the average rate does not
+ * exceed the rate of the band.
+ *
+ * If the band has an error, a due packet is only forwarded if the
+ * receiver can not predict it, see Predictable().
+ */
+bool
+FG_LodPolicy::Forward
+(
+	size_t Sender,
+	size_t Receiver,
+	double Distance,
+	const FG_Motion& Motion
+)
+{
+	if ( m_Bands.empty () )
+		return true;
+	size_t i = 0;
+	while ( ( i < m_Bands.size () - 1 ) && ( Distance >= m_Bands[i].Range ) )
+	{
+		i++;
+	}
+	const Band& B = m_Bands[i];
+	if ( ( B.Interval == 0 ) && ( B.Error == 0 ) )
+	{
+		Forwarded++;
+		return true;
+	}
+	uint32_t Ms  = Now ();
+	uint64_t Key = ( ( uint64_t ) Sender << 32 ) | ( uint32_t ) Receiver;
+	PairMap::iterator Pair = m_Pairs.end ();
+	int32_t Late = 0;
+	if ( B.Interval != 0 )
+	{
+		Pair = m_Pairs.find ( Key );
+		if ( Pair != m_Pairs.end () )
+		{
+			Late = ( int32_t ) ( Ms - ( Pair->second + B.Interval ) );
+			if ( Late < - ( int32_t ) ( B.Interval / 4 ) )
+			{
+				Thinned++;
+				return false;
+			}
+		}
+	}
+	if ( B.Error != 0 )
+	{
+		ReckoningMap::iterator R = m_Reckonings.find ( Key );
+		if ( R == m_Reckonings.end () )
+		{
+			R = m_Reckonings.insert ( ReckoningMap::value_type ( Key, Reckoning () ) ).first;
+		}
+		else if ( ( ( uint32_t ) ( Ms - R->second.SentAt ) < m_Silence )
+		&&        ( Predictable ( R->second.Sent, Motion, B.Error ) ) )
+		{
+			Predicted++;
+			return false;
+		}
+		R->second.Sent   = Motion;
+		R->second.SentAt = Ms;
+	}
+	if ( B.Interval != 0 )
+	{
+		if ( Pair == m_Pairs.end () )
+			m_Pairs[Key] = Ms;
+		else
+			Pair->second = ( Late > ( int32_t ) B.Interval ) ? Ms : Pair->second + B.Interval;
+	}
+	Forwarded++;
+	return true;
+} // FG_LodPolicy::Forward ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_LodPolicy::Expire ()
+{
+	uint32_t Ms = Now ();
+	PairMap::iterator Pair = m_Pairs.begin ();
+	while ( Pair != m_Pairs.end () )
+	{
+		if ( ( int32_t ) ( Ms - Pair->second ) > EXPIRE_TIME )
+			Pair = m_Pairs.erase ( Pair );
+		else
+			Pair++;
+	}
+	ReckoningMap::iterator R = m_Reckonings.begin ();
+	while ( R != m_Reckonings.end () )
+	{
+		if ( ( int32_t ) ( Ms - R->second.SentAt ) > EXPIRE_TIME )
+			R = m_Reckonings.erase ( R );
+		else
+			R++;
+	}
+} // FG_LodPolicy::Expire ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_LodPolicy::Clear ()
+{
+	m_Pairs.clear ();
+	m_Reckonings.clear ();
+} // FG_LodPolicy::Clear ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Check if a receiver predicts a packet from the last one
+ * @param Sent the motion of the last packet the receiver got
+ * @param Motion the motion of the current packet
+ * @param Error maximum distance in meters
+ * @retval true if extrapolating Sent to the time of Motion ends up
+ *         closer than Error to the position of Motion, and closer
+ *         than m_MaxAngle to its orientation
+ *
+ * The extrapolation is the one of FlightGear clients: the velocity and
+ * acceleration are rotated from the body frame to the earth centered
+ * frame, the orientation is turned by the angular velocity.
+ * If the sender reports other velocities than it moves, the
+ * prediction fails and the packets are forwarded.
+ */
+bool
+FG_LodPolicy::Predictable
+(
+	const FG_Motion& Sent,
+	const FG_Motion& Motion,
+	double Error
+) const
+{
+	double Dt = Motion.Time - Sent.Time;
+	if ( ( Dt < 0 ) || ( Dt > MAX_PREDICTION ) )
+		return false;
+	double Axis[3] = { Sent.Orientation[0], Sent.Orientation[1], Sent.Orientation[2] };
+	double Q[4];
+	double Vel[3], Accel[3];
+	AngleAxisToQuat ( Axis, Q );
+	BodyToEarth ( Q, Sent.LinearVel, Vel );
+	BodyToEarth ( Q, Sent.LinearAccel, Accel );
+	double Miss = 0;
+	for ( int i = 0; i < 3; i++ )
+	{
+		double D = Sent.Position[i] + Vel[i] * Dt + Accel[i] * Dt * Dt / 2
+		  - Motion.Position[i];
+		Miss += D * D;
+	}
+	if ( Miss > Error * Error )
+		return false;
+	if ( m_MaxAngle == 0 )
+		return true;
+	double Turn[3] = { Sent.AngularVel[0] * Dt, Sent.AngularVel[1] * Dt,
+	  Sent.AngularVel[2] * Dt };
+	double T[4], P[4], R[4];
+	AngleAxisToQuat ( Turn, T );
+	QuatMult ( Q, T, P );
+	double Real[3] = { Motion.Orientation[0], Motion.Orientation[1],
+	  Motion.Orientation[2] };
+	AngleAxisToQuat ( Real, R );
+	double Dot = fabs ( P[0]*R[0] + P[1]*R[1] + P[2]*R[2] + P[3]*R[3] );
+	if ( Dot > 1 )
+		Dot = 1;
+	return ( 2 * acos ( Dot ) <= m_MaxAngle );
+} // FG_LodPolicy::Predictable ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @return a monotonic time in milliseconds, wrapping after 49 days
+ */
+uint32_t
+FG_LodPolicy::Now ()
+{
+#ifdef _MSC_VER
+	return ( uint32_t ) ( time ( 0 ) * 1000 );
+#else
+	struct timespec T;
+	#ifdef CLOCK_MONOTONIC_COARSE
+	clock_gettime ( CLOCK_MONOTONIC_COARSE, &T );
+	#else
+	clock_gettime ( CLOCK_MONOTONIC, &T );
+	#endif
+	return ( uint32_t ) ( ( uint64_t ) T.tv_sec * 1000 + T.tv_nsec / 1000000 );
+#endif
+} // FG_LodPolicy::Now ()
+//////////////////////////////////////////////////////////////////////
+
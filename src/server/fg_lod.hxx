@@ -0,0 +1,141 @@
+/**
+ * @file fg_lod.hxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, level of detail for local clients
+//
+//////////////////////////////////////////////////////////////////////
+
+#if !defined FG_LOD_HXX
+#define FG_LOD_HXX
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stddef.h>
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief The motion of a player as sent in a position packet
+ *
+ * The velocities and accelerations are in the body frame of the
+ * player, as FlightGear clients extrapolate them.
+ */
+typedef struct st_motion
+{
+	double	Time;		// simulation time of the sender, seconds
+	double	Position[3];	// cartesian, meters
+	float	Orientation[3];	// angle axis, earth centered
+	float	LinearVel[3];	// m/s
+	float	LinearAccel[3];	// m/s^2
+	float	AngularVel[3];	// rad/s
+} FG_Motion;
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @class FG_LodPolicy
+ * @brief Limit the rate of packets forwarded to far away clients
+ *
+ * The policy is a list of distance bands, each with the maximum
+ * number of packets per second a receiver within the band gets from
+ * a single sender, eg. "10:0 40:10 100:2":
+ *
+ * - closer than 10 nm every packet is forwarded (0 = no limit)
+ * - closer than 40 nm at most 10 packets/s
+ * - all others at most 2 packets/s
+ *
+ * The time of the last forwarded packet is kept for every pair of
+ * sender and receiver, in 32 bit milliseconds. Pairs which did not
+ * forward a packet for EXPIRE_TIME are removed by Expire(), this also
+ * removes the pairs of players which left, as player IDs are not
+ * reused.
+ *
+ * A band may have a third field, an error in meters, eg. "100:2:50".
+ * Receivers within such a band get a packet only if the receiver can
+ * not predict it: the motion of the last forwarded packet is
+ * extrapolated, and the packet is dropped if the prediction is closer
+ * than the error to the real position and differs less than the
+ * maximum angle (SetAngle()) from the real orientation. At least one
+ * packet per SetSilence() is forwarded anyway.
+ *
+ * Without bands every packet is forwarded.
+ *
+ * NOT thread safe, the caller serializes the calls.
+ */
+class FG_LodPolicy
+{
+public:
+	enum
+	{
+		MAX_BANDS	= 16,
+		EXPIRE_TIME	= 10000,	// ms
+		MAX_PREDICTION	= 30		// seconds
+	};
+	FG_LodPolicy ();
+	/** set the bands from a string, false if it is invalid */
+	bool	SetBands ( const std::string& Spec );
+	/** maximum error of a predicted orientation, 0 = ignored */
+	void	SetAngle ( int Degrees );
+	/** maximum time between two forwarded packets of a prediction */
+	void	SetSilence ( int Ms );
+	/** the bands as a string, as accepted by SetBands() */
+	std::string GetBands () const;
+	/** true if there is at least one band */
+	bool	Enabled () const { return ! m_Bands.empty (); }
+	/** true if a packet of Sender should be sent to Receiver */
+	bool	Forward ( size_t Sender, size_t Receiver, double Distance,
+		  const FG_Motion& Motion );
+	/** remove pairs which have been idle for long */
+	void	Expire ();
+	/** forget all pairs */
+	void	Clear ();
+	/** packets forwarded by the policy */
+	size_t	Forwarded;
+	/** packets not forwarded because of the rate of the band */
+	size_t	Thinned;
+	/** packets not forwarded because the receiver predicts them */
+	size_t	Predicted;
+private:
+	typedef struct
+	{
+		double		Range;		// nautical miles
+		uint32_t	Rate;		// packets per second, 0 = all
+		uint32_t	Interval;	// ms
+		double		Error;		// meters, 0 = no prediction
+	} Band;
+	typedef struct
+	{
+		FG_Motion	Sent;		// the last forwarded packet
+		uint32_t	SentAt;		// ms
+	} Reckoning;
+	typedef std::unordered_map<uint64_t,uint32_t>	PairMap;
+	typedef std::unordered_map<uint64_t,Reckoning>	ReckoningMap;
+	static uint32_t	Now ();
+	bool	Predictable ( const FG_Motion& Sent, const FG_Motion& Motion,
+		  double Error ) const;
+	std::vector<Band>	m_Bands;
+	PairMap		m_Pairs;	// last forwarded packet (ms) by pair
+	ReckoningMap	m_Reckonings;	// for bands with an error only
+	double		m_MaxAngle;	// radians
+	uint32_t	m_Silence;	// ms
+}; // class FG_LodPolicy
+
+#endif
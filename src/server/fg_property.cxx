@@ -0,0 +1,302 @@
+/**
+ * @file fg_property.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, properties forwarded to far away clients
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sstream>
+#include <flightgear/MultiPlayer/mpmessages.hxx>
+#include <flightgear/MultiPlayer/tiny_xdr.hxx>
+#include "fg_property.hxx"
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Read a 32 bit word of the packet, which need not be aligned
+ */
+static inline uint32_t
+ReadWord ( const char* P )
+{
+	xdr_data_t W;
+	memcpy ( &W, P, sizeof ( W ) );
+	return XDR_decode<uint32_t> ( W );
+} // ReadWord ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+FG_PropertyFilter::FG_PropertyFilter ()
+{
+	Trimmed    = 0;
+	Unparsable = 0;
+	BytesSaved = 0;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the bands of the filter
+ * @param Spec a list of 'range:ids' separated by blanks, range in
+ *        nautical miles, ids a comma separated list of IDs or ranges
+ *        of IDs (eg. 100-199), or '*' for all properties.
+ *        The ranges must ascend. An empty list disables the filter
+ * @retval false if Spec is invalid, the bands are not changed then
+ */
+bool
+FG_PropertyFilter::SetBands ( const std::string& Spec )
+{
+	std::vector<Band> Bands;
+	const char* P = Spec.c_str ();
+	while ( *P != 0 )
+	{
+		if ( ( *P == ' ' ) || ( *P == '\t' ) )
+		{
+			P++;
+			continue;
+		}
+		char* End;
+		Band B;
+		B.Range = strtod ( P, &End );
+		if ( ( End == P ) || ( *End != ':' ) || ( B.Range <= 0 ) )
+			return false;
+		if ( ( ! Bands.empty () ) && ( B.Range <= Bands.back().Range ) )
+			return false;
+		if ( Bands.size () == MAX_BANDS )
+			return false;
+		P = End + 1;
+		B.All = false;
+		B.Ids.assign ( ( MAX_ID + 1 ) / 64, 0 );
+		const char* Start = P;
+		if ( *P == '*' )
+		{
+			B.All = true;
+			P++;
+		}
+		while ( ( ! B.All ) && ( *P != 0 ) && ( *P != ' ' ) && ( *P != '\t' ) )
+		{
+			unsigned long First = strtoul ( P, &End, 10 );
+			unsigned long Last  = First;
+			if ( End == P )
+				return false;
+			P = End;
+			if ( *P == '-' )
+			{
+				P++;
+				Last = strtoul ( P, &End, 10 );
+				if ( End == P )
+					return false;
+				P = End;
+			}
+			if ( ( First > Last ) || ( Last > MAX_ID ) )
+				return false;
+			for ( unsigned long Id = First; Id <= Last; Id++ )
+			{
+				B.Ids[Id / 64] |= ( uint64_t ) 1 << ( Id % 64 );
+			}
+			if ( *P == ',' )
+				P++;
+		}
+		if ( ( *P != 0 ) && ( *P != ' ' ) && ( *P != '\t' ) )
+			return false;
+		B.Spec.assign ( Start, P - Start );
+		Bands.push_back ( B );
+	}
+	m_Bands = Bands;
+	return true;
+} // FG_PropertyFilter::SetBands ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+std::string
+FG_PropertyFilter::GetBands () const
+{
+	std::ostringstream S;
+	for ( size_t i = 0; i < m_Bands.size (); i++ )
+	{
+		if ( i > 0 )
+			S << " ";
+		S << m_Bands[i].Range << ":" << m_Bands[i].Spec;
+	}
+	return S.str ();
+} // FG_PropertyFilter::GetBands ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @param Distance of the receiver to the sender in nautical miles.
+ *        Receivers beyond the last band are treated as in the last band
+ * @return the band of the receiver, -1 if it gets all properties
+ */
+int
+FG_PropertyFilter::GetBand ( double Distance ) const
+{
+	if ( m_Bands.empty () )
+		return -1;
+	size_t i = 0;
+	while ( ( i < m_Bands.size () - 1 ) && ( Distance >= m_Bands[i].Range ) )
+	{
+		i++;
+	}
+	if ( m_Bands[i].All )
+		return -1;
+	return i;
+} // FG_PropertyFilter::GetBand ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Copy a position packet with the properties of a band only
+ * @param Band as returned by GetBand()
+ * @param Msg the packet
+ * @param Bytes the size of the packet
+ * @param Out receives the trimmed packet, at least Bytes in size
+ * @return the size of the trimmed packet, 0 if the packet can not be
+ *         trimmed and should be sent as it is
+ *
+ * The properties are not decoded, the ones to keep are copied as they
+ * are and the length in the header is adjusted.
+ */
+int
+FG_PropertyFilter::Trim ( int Band, const char* Msg, int Bytes, char* Out )
+{
+	const size_t Fixed = sizeof ( T_MsgHdr ) + sizeof ( T_PositionMsg );
+	if ( ( Band < 0 ) || ( Band >= ( int ) m_Bands.size () )
+	||   ( Bytes < ( int ) Fixed ) )
+	{
+		return 0;
+	}
+	const std::vector<uint64_t>& Ids = m_Bands[Band].Ids;
+	const char* Pos = Msg + Fixed;
+	const char* End = Msg + Bytes;
+	char* To = Out + Fixed;
+	const char* Run = Pos;	// consecutive properties to keep
+	Property Prop;
+	while ( Pos < End )
+	{
+		if ( ! NextProperty ( Pos, End, Prop ) )
+		{
+			Unparsable++;
+			return 0;
+		}
+		if ( ( Ids[Prop.Id / 64] & ( ( uint64_t ) 1 << ( Prop.Id % 64 ) ) ) == 0 )
+		{
+			if ( Prop.Start != Run )
+			{
+				memcpy ( To, Run, Prop.Start - Run );
+				To += Prop.Start - Run;
+			}
+			Run = Pos;
+		}
+	}
+	memcpy ( To, Run, End - Run );
+	To += End - Run;
+	memcpy ( Out, Msg, Fixed );
+	int Len = To - Out;
+	( ( T_MsgHdr* ) Out )->MsgLen = XDR_encode<uint32_t> ( Len );
+	Trimmed++;
+	return Len;
+} // FG_PropertyFilter::Trim ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Read the property at Pos without copying it
+ * @param Pos the start of the property, advanced to the next one
+ * @param End the end of the packet
+ * @param Prop receives the ID and the bytes of the property
+ * @retval false if the property is not valid or exceeds End
+ */
+bool
+FG_PropertyFilter::NextProperty ( const char*& Pos, const char* End, Property& Prop )
+{
+	if ( End - Pos < 4 )
+		return false;
+	uint32_t Word = ReadWord ( Pos );
+	size_t Bytes;
+	if ( Word & 0xffff0000 )
+	{	// short encoding, ID and value in one word
+		Prop.Id = Word >> 16;
+		Bytes   = 4;
+		if ( IsString ( Prop.Id ) )
+		{	// the value is the length of the text which follows
+			uint32_t Len = Word & 0xffff;
+			if ( Len > MAX_STRING )
+				return false;
+			Bytes = 4 + ( ( Len + 3 ) & ~3 );
+		}
+	}
+	else if ( Word == 0 )
+	{
+		return false;
+	}
+	else if ( IsString ( Word ) )
+	{
+		if ( End - Pos < 8 )
+			return false;
+		uint32_t Len = ReadWord ( Pos + 4 );
+		if ( Len > MAX_STRING )
+			return false;
+		Prop.Id = Word;
+		Bytes   = 8 + ( ( Len + 3 ) & ~3 ) * 4;
+	}
+	else
+	{
+		Prop.Id = Word;
+		Bytes   = 8;
+	}
+	if ( ( size_t ) ( End - Pos ) < Bytes )
+		return false;
+	Prop.Start = Pos;
+	Prop.Bytes = Bytes;
+	Pos += Bytes;
+	return true;
+} // FG_PropertyFilter::NextProperty ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief The IDs FlightGear sends as strings
+ */
+bool
+FG_PropertyFilter::IsString ( uint32_t Id )
+{
+	switch ( Id )
+	{
+	case 1101:	// sim/model/livery/file
+	case 1200:	// environment/wildfire/data
+	case 1400:	// scenery/events
+	case 10001:	// sim/multiplay/transmission-freq-hz
+	case 10002:	// sim/multiplay/chat
+		return true;
+	}
+	if ( ( Id >= 10100 ) && ( Id <= 10119 ) )
+		return true;	// sim/multiplay/generic/string[n]
+	if ( ( Id >= 12000 ) && ( Id <= 12029 ) )
+		return true;	// sim/multiplay/emesary/bridge[n]
+	return false;
+} // FG_PropertyFilter::IsString ()
+//////////////////////////////////////////////////////////////////////
+
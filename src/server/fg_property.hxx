@@ -0,0 +1,114 @@
+/**
+ * @file fg_property.hxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, properties forwarded to far away clients
+//
+//////////////////////////////////////////////////////////////////////
+
+#if !defined FG_PROPERTY_HXX
+#define FG_PROPERTY_HXX
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @class FG_PropertyFilter
+ * @brief Trim the properties of position packets for far away clients
+ *
+ * A position packet ends with a stream of properties. Every property
+ * starts with a 32 bit word:
+ *
+ * - if the upper 16 bits are set, the word holds the ID in the upper
+ *   and the value in the lower 16 bits (short encoding, since 2017).
+ *   For a string the value is the length, the text follows as bytes,
+ *   padded to a multiple of 4 bytes.
+ * - otherwise the word is the ID. A string is followed by its length
+ *   and one 32 bit word per character, padded to a multiple of 4
+ *   characters. All other values are one 32 bit word.
+ *
+ * The stream itself does not tell which IDs are strings, these are
+ * the IDs FlightGear sends as strings (see IsString()). If the stream
+ * does not end exactly at the end of the packet, it is not trimmed.
+ *
+ * The filter is a list of distance bands, each with the IDs of the
+ * properties a receiver within the band gets, eg.
+ * "20:* 60:100-199,10002 100:10002":
+ *
+ * - closer than 20 nm all properties are forwarded
+ * - closer than 60 nm the surface positions and chat
+ * - all others only chat
+ *
+ * An empty list of IDs forwards only the position.
+ *
+ * NOT thread safe, the caller serializes the calls.
+ */
+class FG_PropertyFilter
+{
+public:
+	enum
+	{
+		MAX_BANDS	= 8,
+		MAX_ID		= 0xffff,
+		MAX_STRING	= 1024		// characters
+	};
+	/** a property within a packet */
+	typedef struct
+	{
+		uint32_t	Id;
+		const char*	Start;		// the first byte of the property
+		size_t		Bytes;		// including the ID
+	} Property;
+	FG_PropertyFilter ();
+	/** set the bands from a string, false if it is invalid */
+	bool	SetBands ( const std::string& Spec );
+	/** the bands as a string, as accepted by SetBands() */
+	std::string GetBands () const;
+	/** true if there is at least one band */
+	bool	Enabled () const { return ! m_Bands.empty (); }
+	/** the band of a receiver at Distance, -1 if it gets everything */
+	int	GetBand ( double Distance ) const;
+	/** copy Msg to Out with the properties of Band only */
+	int	Trim ( int Band, const char* Msg, int Bytes, char* Out );
+	/** read the property at Pos, advance Pos to the next one */
+	static bool NextProperty ( const char*& Pos, const char* End, Property& Prop );
+	/** true if Id is sent as a string */
+	static bool IsString ( uint32_t Id );
+	/** packets trimmed */
+	size_t	Trimmed;
+	/** packets not trimmed, because their properties were not understood */
+	size_t	Unparsable;
+	/** bytes removed from trimmed packets */
+	uint64_t BytesSaved;
+private:
+	typedef struct
+	{
+		double			Range;	// nautical miles
+		bool			All;
+		std::string		Spec;	// the IDs as configured
+		std::vector<uint64_t>	Ids;	// bitmap, MAX_ID + 1 bits
+	} Band;
+	std::vector<Band>	m_Bands;
+}; // class FG_PropertyFilter
+
+#endif
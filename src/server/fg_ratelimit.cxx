@@ -0,0 +1,304 @@
+/**
+ * @file fg_ratelimit.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, per source rate limiting
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+
+#include "fg_ratelimit.hxx"
+
+//////////////////////////////////////////////////////////////////////
+FG_RateLimit::FG_RateLimit ()
+{
+	for ( size_t i = 0; i < SHARDS; i++ )
+	{
+		pthread_mutex_init ( &m_Shards[i].Mutex, 0 );
+	}
+	m_Rate		= 0;
+	m_Burst		= 0;
+	m_Escalate	= 10;
+	m_BlockTime	= 60;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+FG_RateLimit::~FG_RateLimit ()
+{
+	for ( size_t i = 0; i < SHARDS; i++ )
+	{
+		pthread_mutex_destroy ( &m_Shards[i].Mutex );
+	}
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_RateLimit::SetRate ( int Rate )
+{
+	m_Rate = ( Rate < 0 ) ? 0 : Rate;
+} // FG_RateLimit::SetRate ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the size of the buckets. 0 allows bursts of two seconds
+ *        worth of packets.
+ */
+void
+FG_RateLimit::SetBurst ( int Burst )
+{
+	m_Burst = ( Burst < 0 ) ? 0 : Burst;
+} // FG_RateLimit::SetBurst ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_RateLimit::SetEscalate ( int Seconds )
+{
+	m_Escalate = ( Seconds < 0 ) ? 0 : Seconds;
+} // FG_RateLimit::SetEscalate ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_RateLimit::SetBlockTime ( int Seconds )
+{
+	m_BlockTime = ( Seconds < 1 ) ? 1 : Seconds;
+} // FG_RateLimit::SetBlockTime ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Never limit packets of Address, eg. of relays, which send
+ *        the packets of all their players.
+ */
+void
+FG_RateLimit::Exempt ( const netAddress& Address )
+{
+	uint32_t IP = Address.getIP ();
+	Shard& S = ShardOf ( IP );
+	pthread_mutex_lock ( &S.Mutex );
+	Bucket& B = S.Buckets[IP];
+	B.IsExempt = true;
+	pthread_mutex_unlock ( &S.Mutex );
+} // FG_RateLimit::Exempt ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Limit Address again, eg. when it is no longer a relay. The
+ *        source starts with a full bucket.
+ */
+void
+FG_RateLimit::Unexempt ( const netAddress& Address )
+{
+	uint32_t IP = Address.getIP ();
+	Shard& S = ShardOf ( IP );
+	pthread_mutex_lock ( &S.Mutex );
+	BucketMap::iterator It = S.Buckets.find ( IP );
+	if ( ( It != S.Buckets.end() ) && It->second.IsExempt )
+	{
+		S.Buckets.erase ( It );
+	}
+	pthread_mutex_unlock ( &S.Mutex );
+} // FG_RateLimit::Unexempt ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** thread safe
+ *
+ * Take a token from the bucket of Address.
+ *
+ * If a shard is full, sources without a bucket are not limited. This
+ * keeps the memory bounded if the source addresses are spoofed, in
+ * which case limiting them would not help anyway.
+ * @param Address the sender of a packet
+ * @param TTL receives the time to block the source on ESCALATE
+ * @return what to do with the packet
+ */
+FG_RateLimit::RESULT
+FG_RateLimit::Check ( const netAddress& Address, time_t& TTL )
+{
+	uint32_t Rate = m_Rate.load ( std::memory_order_relaxed );
+	if ( Rate == 0 )
+		return PASS;
+	uint32_t IP  = Address.getIP ();
+	uint64_t Ms  = Now ();
+	Shard&   S   = ShardOf ( IP );
+	RESULT   Result = PASS;
+	pthread_mutex_lock ( &S.Mutex );
+	BucketMap::iterator It = S.Buckets.find ( IP );
+	if ( It == S.Buckets.end() )
+	{
+		if ( S.Buckets.size() >= MAX_BUCKETS )
+		{
+			pthread_mutex_unlock ( &S.Mutex );
+			return PASS;
+		}
+		Bucket N;
+		N.Tokens	= Capacity ();
+		N.LastFill	= Ms;
+		N.LastStrike	= 0;
+		N.Strikes	= 0;
+		N.Offences	= 0;
+		N.BlockedUntil	= 0;
+		N.IsExempt	= false;
+		It = S.Buckets.insert ( BucketMap::value_type ( IP, N ) ).first;
+	}
+	Bucket& B = It->second;
+	if ( B.IsExempt )
+	{
+		pthread_mutex_unlock ( &S.Mutex );
+		return PASS;
+	}
+	// refill, Rate tokens per second are Rate/1000 per ms
+	B.Tokens   += ( int64_t ) ( Ms - B.LastFill ) * Rate;
+	B.LastFill  = Ms;
+	if ( B.Tokens > Capacity () )
+		B.Tokens = Capacity ();
+	if ( B.Tokens >= 1000 )
+	{
+		B.Tokens -= 1000;
+		pthread_mutex_unlock ( &S.Mutex );
+		return PASS;
+	}
+	Result = DROP;
+	uint64_t Second = Ms / 1000;
+	if ( Second < B.BlockedUntil )
+	{	// blocked already, see the blacklist
+		pthread_mutex_unlock ( &S.Mutex );
+		return DROP;
+	}
+	if ( Second != B.LastStrike )
+	{
+		B.Strikes    = ( Second == B.LastStrike + 1 ) ? B.Strikes + 1 : 1;
+		B.LastStrike = Second;
+		uint32_t Escalate = m_Escalate.load ( std::memory_order_relaxed );
+		if ( ( Escalate != 0 ) && ( B.Strikes >= Escalate ) )
+		{
+			B.Strikes = 0;
+			B.Offences++;
+			uint32_t Shift = ( B.Offences > 16 ) ? 16 : B.Offences - 1;
+			uint64_t Block = ( uint64_t ) m_BlockTime.load ( std::memory_order_relaxed ) << Shift;
+			TTL = ( Block > MAX_BLOCK_TIME ) ? MAX_BLOCK_TIME : ( time_t ) Block;
+			B.BlockedUntil = Second + TTL;
+			Result = ESCALATE;
+		}
+	}
+	pthread_mutex_unlock ( &S.Mutex );
+	return Result;
+} // FG_RateLimit::Check ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Free the buckets of sources which did not send anything for
+ *        IDLE_TIME seconds. Buckets of offenders are kept for
+ *        OFFENCE_MEMORY seconds, so the block time of a returning
+ *        offender keeps growing.
+ */
+void
+FG_RateLimit::Expire ()
+{
+	uint64_t Ms = Now ();
+	for ( size_t i = 0; i < SHARDS; i++ )
+	{
+		Shard& S = m_Shards[i];
+		pthread_mutex_lock ( &S.Mutex );
+		BucketMap::iterator It = S.Buckets.begin ();
+		while ( It != S.Buckets.end() )
+		{
+			const Bucket& B = It->second;
+			uint64_t Keep = ( B.Offences != 0 ) ? OFFENCE_MEMORY : IDLE_TIME;
+			if ( ( ! B.IsExempt ) && ( Ms - B.LastFill > Keep * 1000 ) )
+			{
+				It = S.Buckets.erase ( It );
+				continue;
+			}
+			It++;
+		}
+		pthread_mutex_unlock ( &S.Mutex );
+	}
+} // FG_RateLimit::Expire ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_RateLimit::Clear ()
+{
+	for ( size_t i = 0; i < SHARDS; i++ )
+	{
+		pthread_mutex_lock ( &m_Shards[i].Mutex );
+		m_Shards[i].Buckets.clear ();
+		pthread_mutex_unlock ( &m_Shards[i].Mutex );
+	}
+} // FG_RateLimit::Clear ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @return a monotonic time in milliseconds
+ */
+uint64_t
+FG_RateLimit::Now ()
+{
+#ifdef _MSC_VER
+	return ( uint64_t ) time ( 0 ) * 1000;
+#else
+	struct timespec T;
+	#ifdef CLOCK_MONOTONIC_COARSE
+	clock_gettime ( CLOCK_MONOTONIC_COARSE, &T );
+	#else
+	clock_gettime ( CLOCK_MONOTONIC, &T );
+	#endif
+	return ( uint64_t ) T.tv_sec * 1000 + T.tv_nsec / 1000000;
+#endif
+} // FG_RateLimit::Now ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+FG_RateLimit::Shard&
+FG_RateLimit::ShardOf ( uint32_t IP )
+{
+	// the top bits of the product depend on all bits of IP
+	uint32_t H = IP * 0x9E3779B1U;
+	return m_Shards[H >> 28];
+} // FG_RateLimit::ShardOf ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @return the size of a bucket in 1/1000 packets
+ */
+int64_t
+FG_RateLimit::Capacity () const
+{
+	int64_t Burst = m_Burst.load ( std::memory_order_relaxed );
+	if ( Burst == 0 )
+		Burst = 2 * ( int64_t ) m_Rate.load ( std::memory_order_relaxed );
+	return Burst * 1000;
+} // FG_RateLimit::Capacity ()
+//////////////////////////////////////////////////////////////////////
+
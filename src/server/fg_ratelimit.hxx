@@ -0,0 +1,122 @@
+/**
+ * @file fg_ratelimit.hxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, per source rate limiting
+//
+//////////////////////////////////////////////////////////////////////
+
+#if !defined FG_RATELIMIT_HXX
+#define FG_RATELIMIT_HXX
+
+#include <atomic>
+#include <time.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unordered_map>
+#include <plib/netSocket.h>
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @class FG_RateLimit
+ * @brief A token bucket for every source IP
+ *
+ * Every source IP owns a bucket of at most Burst tokens, which is
+ * refilled with Rate tokens per second. Every packet takes one token,
+ * a packet arriving at an empty bucket is dropped.
+ *
+ * A source which keeps the bucket empty for Escalate seconds in a row
+ * is reported by Check(), so it can be blacklisted. The block time is
+ * doubled with every repeated offence, up to MAX_BLOCK_TIME. While a
+ * source is blocked, its packets do not count as a new offence.
+ *
+ * The buckets are spread over SHARDS hash tables with a lock each, so
+ * workers only contend for the same lock if their sources do.
+ */
+class FG_RateLimit
+{
+public:
+	/** @brief result of Check() */
+	enum RESULT
+	{
+		PASS,		// accept the packet
+		DROP,		// drop the packet
+		ESCALATE	// drop the packet and block the source
+	};
+	enum
+	{
+		SHARDS		= 16,
+		MAX_BUCKETS	= 4096,		// per shard
+		IDLE_TIME	= 60,		// seconds until a bucket is freed
+		OFFENCE_MEMORY	= 86400,	// seconds offences are remembered
+		MAX_BLOCK_TIME	= 172800	// 2 days
+	};
+	FG_RateLimit ();
+	~FG_RateLimit ();
+	/** packets per second per source, 0 disables rate limiting */
+	void	SetRate ( int Rate );
+	/** maximum number of packets sent at once */
+	void	SetBurst ( int Burst );
+	/** seconds over the limit until a source is blocked, 0 = never */
+	void	SetEscalate ( int Seconds );
+	/** block time of the first offence */
+	void	SetBlockTime ( int Seconds );
+	/** never limit Address */
+	void	Exempt ( const netAddress& Address );
+	/** limit Address again, undoes Exempt() */
+	void	Unexempt ( const netAddress& Address );
+	/** check a packet of Address, TTL receives the block time on ESCALATE */
+	RESULT	Check ( const netAddress& Address, time_t& TTL );
+	/** free buckets of sources which have been idle for long */
+	void	Expire ();
+	/** forget all buckets and exemptions */
+	void	Clear ();
+	/** true if rate limiting is enabled */
+	bool	Enabled () const { return m_Rate.load ( std::memory_order_relaxed ) != 0; }
+private:
+	FG_RateLimit ( const FG_RateLimit& );
+	void operator = ( const FG_RateLimit& );
+	typedef struct
+	{
+		int64_t		Tokens;		// in 1/1000 packets
+		uint64_t	LastFill;	// ms
+		uint64_t	LastStrike;	// s, last second over the limit
+		uint32_t	Strikes;	// seconds over the limit in a row
+		uint32_t	Offences;	// number of escalations
+		uint64_t	BlockedUntil;	// s, end of the last block time
+		bool		IsExempt;
+	} Bucket;
+	typedef std::unordered_map<uint32_t,Bucket>	BucketMap;
+	typedef struct
+	{
+		pthread_mutex_t	Mutex;
+		BucketMap	Buckets;
+	} Shard;
+	static uint64_t	Now ();
+	Shard&	ShardOf ( uint32_t IP );
+	int64_t	Capacity () const;
+	Shard			m_Shards[SHARDS];
+	std::atomic<uint32_t>	m_Rate;
+	std::atomic<uint32_t>	m_Burst;
+	std::atomic<uint32_t>	m_Escalate;
+	std::atomic<uint32_t>	m_BlockTime;
+}; // class FG_RateLimit
+
+#endif
@@ -0,0 +1,266 @@
+/**
+ * @file fg_reactor.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, event loop helpers
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+
+#include <algorithm>
+#include <simgear/debug/logstream.hxx>
+#include "fg_reactor.hxx"
+#ifdef FG_HAVE_EPOLL
+	#include <sys/epoll.h>
+	#include <unistd.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////
+FG_Reactor::FG_Reactor ()
+{
+	m_Fd = -1;
+#ifdef FG_HAVE_EPOLL
+	m_Fd = epoll_create ( 8 );
+	if ( m_Fd < 0 )
+	{
+		SG_LOG ( SG_FGMS, SG_ALERT, "FG_Reactor - epoll_create: "
+		  << strerror ( errno ) );
+	}
+#endif
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+FG_Reactor::~FG_Reactor ()
+{
+#ifdef FG_HAVE_EPOLL
+	if ( m_Fd >= 0 )
+	{
+		::close ( m_Fd );
+	}
+#endif
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Watch a socket for read events (incoming data or connections)
+ * @retval true on success
+ */
+bool
+FG_Reactor::Add ( netSocket* Socket )
+{
+	if ( ( Socket == 0 ) || ( Socket->getHandle() < 0 ) )
+		return false;
+	if ( std::find ( m_Sockets.begin(), m_Sockets.end(), Socket ) != m_Sockets.end() )
+		return true;
+#ifdef FG_HAVE_EPOLL
+	struct epoll_event E;
+	memset ( &E, 0, sizeof ( E ) );
+	E.events   = EPOLLIN;
+	E.data.ptr = Socket;
+	if ( epoll_ctl ( m_Fd, EPOLL_CTL_ADD, Socket->getHandle(), &E ) != 0 )
+	{
+		SG_LOG ( SG_FGMS, SG_ALERT, "FG_Reactor::Add() - "
+		  << strerror ( errno ) );
+		return false;
+	}
+#endif
+	m_Sockets.push_back ( Socket );
+	return true;
+} // FG_Reactor::Add ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_Reactor::Remove ( netSocket* Socket )
+{
+	std::vector<netSocket*>::iterator S;
+	S = std::find ( m_Sockets.begin(), m_Sockets.end(), Socket );
+	if ( S == m_Sockets.end() )
+		return;
+#ifdef FG_HAVE_EPOLL
+	struct epoll_event E;	// needed by kernels before 2.6.9
+	epoll_ctl ( m_Fd, EPOLL_CTL_DEL, Socket->getHandle(), &E );
+#endif
+	m_Sockets.erase ( S );
+} // FG_Reactor::Remove ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Forget all sockets. The sockets are not accessed, so this
+ *        is safe if they have already been deleted.
+ */
+void
+FG_Reactor::Clear ()
+{
+#ifdef FG_HAVE_EPOLL
+	// closed sockets have been removed from the epoll set by the
+	// kernel, but the others have to go, too. Start a new set.
+	if ( m_Fd >= 0 )
+	{
+		::close ( m_Fd );
+	}
+	m_Fd = epoll_create ( 8 );
+#endif
+	m_Sockets.clear ();
+} // FG_Reactor::Clear ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Wait for events.
+ * @param Timeout maximum time to wait in milliseconds
+ * @param Ready receives the sockets which are ready to read
+ * @param MaxReady size of Ready
+ * @return number of ready sockets, 0 on timeout, -1 on error
+ */
+int
+FG_Reactor::Wait ( int Timeout, netSocket** Ready, int MaxReady )
+{
+	if ( m_Sockets.empty() )
+		return 0;
+#ifdef FG_HAVE_EPOLL
+	struct epoll_event Events[8];
+	if ( MaxReady > 8 )
+		MaxReady = 8;
+	int N = epoll_wait ( m_Fd, Events, MaxReady, Timeout );
+	for ( int i = 0; i < N; i++ )
+	{
+		Ready[i] = ( netSocket* ) Events[i].data.ptr;
+	}
+	return N;
+#else
+	std::vector<netSocket*> Reads ( m_Sockets );
+	Reads.push_back ( 0 );
+	int N = netSocket::select ( &Reads[0], 0, ( Timeout + 999 ) / 1000 );
+	if ( N <= 0 )
+		return N;
+	N = 0;
+	for ( size_t i = 0; ( i < m_Sockets.size() ) && ( N < MaxReady ); i++ )
+	{
+		if ( Reads[i] != 0 )
+		{
+			Ready[N++] = Reads[i];
+		}
+	}
+	return N;
+#endif
+} // FG_Reactor::Wait ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+FG_TimerWheel::FG_TimerWheel ()
+{
+	Start ( time ( 0 ) );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_TimerWheel::Start ( time_t Now )
+{
+	for ( size_t i = 0; i < SLOTS; i++ )
+	{
+		m_Slots[i].clear ();
+	}
+	m_Current = 0;
+	m_Now     = Now;
+} // FG_TimerWheel::Start ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Add a periodic timer
+ * @param ID returned by Advance() when the timer expires
+ * @param Interval in seconds, at least 1
+ */
+void
+FG_TimerWheel::Add ( int ID, time_t Interval )
+{
+	Timer T;
+	T.ID       = ID;
+	T.Interval = ( Interval < 1 ) ? 1 : Interval;
+	T.Rounds   = 0;
+	Insert ( T );
+} // FG_TimerWheel::Add ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Advance the wheel to Now.
+ *
+ * Every timer is reported at most once per call, even if the clock
+ * jumped by more than its interval.
+ * @param Now the current time
+ * @param Expired receives the IDs of expired timers (cleared first)
+ * @return number of expired timers
+ */
+size_t
+FG_TimerWheel::Advance ( time_t Now, std::vector<int>& Expired )
+{
+	Expired.clear ();
+	if ( Now < m_Now )
+	{	// clock went backwards
+		m_Now = Now;
+		return 0;
+	}
+	if ( ( Now - m_Now ) > SLOTS )
+	{	// clock jumped, don't spin through the same slots again
+		m_Now = Now - SLOTS;
+	}
+	while ( m_Now < Now )
+	{
+		m_Now++;
+		m_Current = ( m_Current + 1 ) % SLOTS;
+		TimerList Due;
+		Due.swap ( m_Slots[m_Current] );
+		for ( size_t i = 0; i < Due.size(); i++ )
+		{
+			if ( Due[i].Rounds > 0 )
+			{
+				Due[i].Rounds--;
+				m_Slots[m_Current].push_back ( Due[i] );
+				continue;
+			}
+			if ( std::find ( Expired.begin(), Expired.end(), Due[i].ID ) == Expired.end() )
+			{
+				Expired.push_back ( Due[i].ID );
+			}
+			Insert ( Due[i] );
+		}
+	}
+	return Expired.size ();
+} // FG_TimerWheel::Advance ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_TimerWheel::Insert ( Timer& T )
+{
+	T.Rounds = ( T.Interval - 1 ) / SLOTS;
+	m_Slots[( m_Current + T.Interval ) % SLOTS].push_back ( T );
+} // FG_TimerWheel::Insert ()
+//////////////////////////////////////////////////////////////////////
+
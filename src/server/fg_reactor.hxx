@@ -0,0 +1,101 @@
+/**
+ * @file fg_reactor.hxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, event loop helpers
+//
+//////////////////////////////////////////////////////////////////////
+
+#if !defined FG_REACTOR_HXX
+#define FG_REACTOR_HXX
+
+#include <vector>
+#include <time.h>
+#include <plib/netSocket.h>
+
+#if defined(__linux__)
+	#define FG_HAVE_EPOLL 1
+#endif
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @class FG_Reactor
+ * @brief Wait for read events on a set of sockets
+ *
+ * Sockets are registered once and stay registered until they are
+ * removed. On linux epoll is used, elsewhere netSocket::select().
+ * All sockets which are ready are reported by a single Wait().
+ */
+class FG_Reactor
+{
+public:
+	FG_Reactor ();
+	~FG_Reactor ();
+	/** watch Socket for incoming data or connections */
+	bool	Add ( netSocket* Socket );
+	/** do not watch Socket any longer */
+	void	Remove ( netSocket* Socket );
+	/** remove all sockets */
+	void	Clear ();
+	/** wait at most Timeout milliseconds, return number of ready sockets */
+	int	Wait ( int Timeout, netSocket** Ready, int MaxReady );
+private:
+	FG_Reactor ( const FG_Reactor& );
+	void operator = ( const FG_Reactor& );
+	int			m_Fd;
+	std::vector<netSocket*>	m_Sockets;
+}; // class FG_Reactor
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @class FG_TimerWheel
+ * @brief Periodic timers with a resolution of one second
+ *
+ * Every timer is identified by an ID given by the user. Timers are
+ * kept in a wheel of SLOTS slots, one slot per second. Advancing the
+ * wheel only visits the slots of the elapsed seconds, so the cost does
+ * not depend on the number of timers which are not due.
+ */
+class FG_TimerWheel
+{
+public:
+	FG_TimerWheel ();
+	/** set the current time, removes all timers */
+	void	Start ( time_t Now );
+	/** add a timer which expires every Interval seconds */
+	void	Add ( int ID, time_t Interval );
+	/** advance to Now, collect IDs of expired timers */
+	size_t	Advance ( time_t Now, std::vector<int>& Expired );
+private:
+	enum { SLOTS = 64 };
+	typedef struct
+	{
+		int	ID;
+		time_t	Interval;
+		time_t	Rounds;
+	} Timer;
+	typedef std::vector<Timer>	TimerList;
+	void	Insert ( Timer& T );
+	TimerList	m_Slots[SLOTS];
+	size_t		m_Current;
+	time_t		m_Now;
+}; // class FG_TimerWheel
+
+#endif
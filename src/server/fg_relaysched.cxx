@@ -0,0 +1,200 @@
+/**
+ * @file fg_relaysched.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, rate of updates sent to relays
+//
+//////////////////////////////////////////////////////////////////////
+
+#ifdef HAVE_CONFIG_H
+	#include "config.h"
+#endif
+
+#include <time.h>
+#include "fg_relaysched.hxx"
+
+/** @brief minimum time between two packets of a tier in ms */
+static const uint64_t Interval[FG_RelayScheduler::TIERS] =
+{
+	0,
+	FG_RelayScheduler::NEAR_INTERVAL,
+	FG_RelayScheduler::FAR_INTERVAL,
+	FG_RelayScheduler::REMOTE_INTERVAL
+};
+
+//////////////////////////////////////////////////////////////////////
+FG_RelayScheduler::FG_RelayScheduler ()
+{
+	m_Budget = 0;
+	Clear ();
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_RelayScheduler::SetBudget ( int BytesPerSecond )
+{
+	m_Budget = ( BytesPerSecond < 0 ) ? 0 : BytesPerSecond;
+} // FG_RelayScheduler::SetBudget ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Decide if a packet of a player is sent to a relay
+ * @param Relay the key of the relay
+ * @param Player the ID of the sending player
+ * @param Pos the position of the sending player
+ * @param Pilots the players behind the relay, 0 if there are none
+ * @param Bytes size of the packet
+ * @retval true if the packet should be sent
+ */
+bool
+FG_RelayScheduler::Send
+(
+	uint64_t Relay,
+	size_t Player,
+	const Point3D& Pos,
+	FG_SpatialGrid* Pilots,
+	int Bytes
+)
+{
+	uint64_t Ms = Now ();
+	RelayMap::iterator R = m_Relays.find ( Relay );
+	if ( R == m_Relays.end() )
+	{
+		FG_RelayScheduler::Relay N;
+		N.Tokens   = m_Budget;
+		N.LastFill = Ms;
+		R = m_Relays.insert ( RelayMap::value_type ( Relay, N ) ).first;
+	}
+	PairMap::iterator P = R->second.Pairs.find ( Player );
+	if ( P == R->second.Pairs.end() )
+	{
+		Pair N;
+		N.LastSent     = 0;
+		N.NextClassify = 0;
+		N.Tier         = TIER_FULL;
+		P = R->second.Pairs.insert ( PairMap::value_type ( Player, N ) ).first;
+	}
+	Pair& Current = P->second;
+	if ( Ms >= Current.NextClassify )
+	{
+		Current.Tier         = Classify ( Pos, Pilots );
+		Current.NextClassify = Ms + CLASSIFY_INTERVAL;
+	}
+	uint64_t Idle = Ms - Current.LastSent;
+	if ( Idle < Interval[Current.Tier] )
+	{
+		Skipped++;
+		return false;
+	}
+	if ( m_Budget != 0 )
+	{	// refill, the budget of one second at most
+		FG_RelayScheduler::Relay& Target = R->second;
+		Target.Tokens  += ( int64_t ) ( Ms - Target.LastFill ) * m_Budget / 1000;
+		Target.LastFill = Ms;
+		if ( Target.Tokens > m_Budget )
+			Target.Tokens = m_Budget;
+		if ( ( Current.Tier != TIER_FULL )
+		&&   ( Target.Tokens < Bytes )
+		&&   ( Idle < REMOTE_INTERVAL ) )
+		{
+			OverBudget++;
+			return false;
+		}
+		Target.Tokens -= Bytes;
+		if ( Target.Tokens < -m_Budget )
+		{	// do not punish the next second, too
+			Target.Tokens = -m_Budget;
+		}
+	}
+	Current.LastSent = Ms;
+	Sent[Current.Tier]++;
+	return true;
+} // FG_RelayScheduler::Send ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_RelayScheduler::Forget ( size_t Player )
+{
+	RelayMap::iterator R;
+	for ( R = m_Relays.begin(); R != m_Relays.end(); R++ )
+	{
+		R->second.Pairs.erase ( Player );
+	}
+} // FG_RelayScheduler::Forget ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+void
+FG_RelayScheduler::Clear ()
+{
+	m_Relays.clear ();
+	for ( int i = 0; i < TIERS; i++ )
+	{
+		Sent[i] = 0;
+	}
+	Skipped    = 0;
+	OverBudget = 0;
+} // FG_RelayScheduler::Clear ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @return the tier of a player at Pos for the pilots of a relay
+ */
+int
+FG_RelayScheduler::Classify ( const Point3D& Pos, FG_SpatialGrid* Pilots )
+{
+	if ( Pilots == 0 )
+		return TIER_REMOTE;
+	if ( Pilots->AnyInRange ( Pos ) )
+		return TIER_FULL;
+	double Distance = Pilots->Nearest ( Pos );
+	if ( ( Distance >= 0 ) && ( Distance < NEAR_RANGE ) )
+		return TIER_NEAR;
+	if ( ( Distance >= 0 ) && ( Distance < FAR_RANGE ) )
+		return TIER_FAR;
+	return TIER_REMOTE;
+} // FG_RelayScheduler::Classify ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @return a monotonic time in milliseconds
+ */
+uint64_t
+FG_RelayScheduler::Now ()
+{
+#ifdef _MSC_VER
+	return ( uint64_t ) time ( 0 ) * 1000;
+#else
+	struct timespec T;
+	#ifdef CLOCK_MONOTONIC_COARSE
+	clock_gettime ( CLOCK_MONOTONIC_COARSE, &T );
+	#else
+	clock_gettime ( CLOCK_MONOTONIC, &T );
+	#endif
+	return ( uint64_t ) T.tv_sec * 1000 + T.tv_nsec / 1000000;
+#endif
+} // FG_RelayScheduler::Now ()
+//////////////////////////////////////////////////////////////////////
+
@@ -0,0 +1,117 @@
+/**
+ * @file fg_relaysched.hxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, rate of updates sent to relays
+//
+//////////////////////////////////////////////////////////////////////
+
+#if !defined FG_RELAYSCHED_HXX
+#define FG_RELAYSCHED_HXX
+
+#include <map>
+#include <unordered_map>
+#include <stddef.h>
+#include <stdint.h>
+#include "fg_geometry.hxx"
+#include "fg_grid.hxx"
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @class FG_RelayScheduler
+ * @brief Decide which packets of a player are sent to a relay
+ *
+ * Every pair of player and relay is assigned a tier, by the distance
+ * of the player to the nearest pilot behind the relay:
+ *
+ * - TIER_FULL:   a pilot has the player within its radar range,
+ *                every packet is sent
+ * - TIER_NEAR:   a pilot is closer than NEAR_RANGE, 5 packets/s
+ * - TIER_FAR:    a pilot is closer than FAR_RANGE, 1 packet/s
+ * - TIER_REMOTE: all others, 1 packet every 5 seconds
+ *
+ * The tier is checked once per second, not for every packet.
+ *
+ * Optionally every relay has a budget of bytes per second. Packets of
+ * TIER_NEAR and TIER_FAR are only sent while the budget lasts, so the
+ * traffic to a relay is limited even if many players are around.
+ * Packets of TIER_FULL are always sent, and a player is sent at least
+ * once per REMOTE_INTERVAL, so it does not expire on the relay.
+ *
+ * NOT thread safe, the caller serializes the calls.
+ */
+class FG_RelayScheduler
+{
+public:
+	enum TIER
+	{
+		TIER_FULL,
+		TIER_NEAR,
+		TIER_FAR,
+		TIER_REMOTE,
+		TIERS
+	};
+	enum
+	{
+		NEAR_RANGE	= 200,		// nautical miles
+		FAR_RANGE	= 1000,		// nautical miles
+		NEAR_INTERVAL	= 200,		// ms
+		FAR_INTERVAL	= 1000,		// ms
+		REMOTE_INTERVAL	= 5000,		// ms
+		CLASSIFY_INTERVAL = 1000	// ms
+	};
+	FG_RelayScheduler ();
+	/** bytes per second for every relay, 0 = unlimited */
+	void	SetBudget ( int BytesPerSecond );
+	/** true if the packet of Player should be sent to Relay */
+	bool	Send ( uint64_t Relay, size_t Player, const Point3D& Pos,
+		  FG_SpatialGrid* Pilots, int Bytes );
+	/** forget the state of Player, eg. when it leaves */
+	void	Forget ( size_t Player );
+	/** forget everything */
+	void	Clear ();
+	/** packets sent per tier */
+	size_t	Sent[TIERS];
+	/** packets not sent, because the tier did not want them */
+	size_t	Skipped;
+	/** packets not sent, because the budget was spent */
+	size_t	OverBudget;
+private:
+	typedef struct
+	{
+		uint64_t	LastSent;	// ms
+		uint64_t	NextClassify;	// ms
+		int		Tier;
+	} Pair;
+	typedef std::unordered_map<size_t,Pair>	PairMap;
+	typedef struct
+	{
+		int64_t		Tokens;		// bytes
+		uint64_t	LastFill;	// ms
+		PairMap		Pairs;
+	} Relay;
+	typedef std::map<uint64_t,Relay>	RelayMap;
+	static uint64_t	Now ();
+	static int	Classify ( const Point3D& Pos, FG_SpatialGrid* Pilots );
+	RelayMap	m_Relays;
+	int64_t		m_Budget;
+}; // class FG_RelayScheduler
+
+#endif
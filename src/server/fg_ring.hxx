@@ -0,0 +1,180 @@
+/**
+ * @file fg_ring.hxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, bounded lock free message queue
+//
+//////////////////////////////////////////////////////////////////////
+
+#if !defined FG_RING_HXX
+#define FG_RING_HXX
+
+#include <atomic>
+#include <utility>
+#include <stddef.h>
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @class mT_FG_Ring
+ * @brief A bounded queue for many producers and a single consumer
+ *
+ * The elements are kept in a ring of slots, the capacity is rounded
+ * up to a power of 2. Every slot carries a sequence number, which
+ * tells whether the slot is free for the producer of a position or
+ * filled for the consumer. Producers claim a position with a single
+ * compare-and-swap, neither side ever takes a lock.
+ *
+ * Push() fails if the ring is full, so the queue never grows.
+ */
+template <class T>
+class mT_FG_Ring
+{
+public:
+	mT_FG_Ring ( size_t Capacity );
+	~mT_FG_Ring ();
+	/** thread safe, false if the ring is full */
+	bool	Push ( const T& Element );
+	/** only one thread may pop, false if the ring is empty */
+	bool	Pop ( T& Element );
+	/** number of elements, a snapshot if other threads push */
+	size_t	Size () const;
+	/** true if there is no element to pop */
+	bool	Empty () const { return Size () == 0; }
+	/** maximum number of elements */
+	size_t	Capacity () const { return m_Mask + 1; }
+private:
+	mT_FG_Ring ( const mT_FG_Ring& );
+	void operator = ( const mT_FG_Ring& );
+	typedef struct
+	{
+		std::atomic<size_t>	Seq;
+		T			Data;
+	} Slot;
+	Slot*			m_Slots;
+	size_t			m_Mask;
+	// head and tail are written by different threads
+	char			m_Pad0[64];
+	std::atomic<size_t>	m_Head;	// next position to pop
+	char			m_Pad1[64];
+	std::atomic<size_t>	m_Tail;	// next position to push
+	char			m_Pad2[64];
+}; // class mT_FG_Ring
+
+//////////////////////////////////////////////////////////////////////
+template <class T>
+mT_FG_Ring<T>::mT_FG_Ring ( size_t Capacity )
+{
+	size_t Size = 2;
+	while ( Size < Capacity )
+		Size <<= 1;
+	m_Slots = new Slot[Size];
+	m_Mask  = Size - 1;
+	for ( size_t i = 0; i < Size; i++ )
+	{
+		m_Slots[i].Seq.store ( i, std::memory_order_relaxed );
+	}
+	m_Head.store ( 0, std::memory_order_relaxed );
+	m_Tail.store ( 0, std::memory_order_relaxed );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+template <class T>
+mT_FG_Ring<T>::~mT_FG_Ring ()
+{
+	delete [] m_Slots;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** thread safe
+ *
+ * A slot is free for position Pos if its sequence number is Pos. The
+ * producer which advances m_Tail from Pos owns the slot, fills it and
+ * publishes it by setting the sequence number to Pos+1.
+ */
+template <class T>
+bool
+mT_FG_Ring<T>::Push ( const T& Element )
+{
+	size_t Pos = m_Tail.load ( std::memory_order_relaxed );
+	Slot*  S;
+	for (;;)
+	{
+		S = &m_Slots[Pos & m_Mask];
+		size_t Seq = S->Seq.load ( std::memory_order_acquire );
+		intptr_t Diff = ( intptr_t ) Seq - ( intptr_t ) Pos;
+		if ( Diff == 0 )
+		{
+			if ( m_Tail.compare_exchange_weak ( Pos, Pos + 1,
+			  std::memory_order_relaxed ) )
+				break;
+		}
+		else if ( Diff < 0 )
+		{	// the slot still holds the element of the last round
+			return false;
+		}
+		else
+		{	// another producer took Pos
+			Pos = m_Tail.load ( std::memory_order_relaxed );
+		}
+	}
+	S->Data = Element;
+	S->Seq.store ( Pos + 1, std::memory_order_release );
+	return true;
+} // mT_FG_Ring::Push ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/** NOT thread safe, only one consumer
+ *
+ * The element is swapped out of its slot, so no copy is made. The slot
+ * is freed for the next round by setting its sequence number to
+ * Pos + Capacity().
+ */
+template <class T>
+bool
+mT_FG_Ring<T>::Pop ( T& Element )
+{
+	size_t Pos = m_Head.load ( std::memory_order_relaxed );
+	Slot*  S   = &m_Slots[Pos & m_Mask];
+	if ( S->Seq.load ( std::memory_order_acquire ) != Pos + 1 )
+		return false;
+	std::swap ( Element, S->Data );
+	S->Data = T ();
+	S->Seq.store ( Pos + m_Mask + 1, std::memory_order_release );
+	m_Head.store ( Pos + 1, std::memory_order_relaxed );
+	return true;
+} // mT_FG_Ring::Pop ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+template <class T>
+size_t
+mT_FG_Ring<T>::Size () const
+{
+	size_t Head = m_Head.load ( std::memory_order_acquire );
+	size_t Tail = m_Tail.load ( std::memory_order_acquire );
+	return ( Tail > Head ) ? Tail - Head : 0;
+} // mT_FG_Ring::Size ()
+//////////////////////////////////////////////////////////////////////
+
+#endif
@@ -62,6 +62,12 @@ bool    AddCLI = true;
 // how long should malicious IPs be blocked?
 const int DEFAULT_BLOCK_TIME = 172800; // 2 days
 
+// players connected via a relay are keyed by ip and port of the relay
+static inline uint64_t RelayKey ( const netAddress& Relay )
+{
+        return ( (uint64_t) Relay.getIP() << 16 ) | ( Relay.getPort() & 0xffff );
+}
+
 #ifndef DEF_SERVER_LOG
         #define DEF_SERVER_LOG "fg_server.log"
 #endif
@@ -70,7 +76,7 @@ const int DEFAULT_BLOCK_TIME = 172800; // 2 days
         #define DEF_UPDATE_SECS 10
 #endif
 
-extern void SigHUPHandler ( int SigType );
+extern void ReloadConfig ();
 #ifndef DEF_EXIT_FILE
         #define DEF_EXIT_FILE "fgms_exit"
 #endif
@@ -181,6 +187,7 @@ FG_SERVER::FG_SERVER
         m_ReinitData            = true; // init the data port
         m_ReinitTelnet          = true; // init the telnet port
         m_ReinitAdmin           = true; // init the telnet port
+        m_ReinitReactor         = true; // register sockets in Loop()
         m_ListenPort            = 5000; // port for client connections
         m_PlayerExpires         = 10; // standard expiration period
         m_Listening             = false;
@@ -201,7 +208,18 @@ FG_SERVER::FG_SERVER
         m_RelayMap              = std::map<uint32_t, std::string>();
         m_IsTracked             = false; // off until config file read
         m_Tracker               = 0; // no tracker yet
+        m_TrackerRunning        = false;
         m_UpdateTrackerFreq     = DEF_UPDATE_SECS;
+        m_TrackerWindow         = FG_TRACKER::DEF_WINDOW;
+        m_TrackerDelta          = 0;     // report all players
+        m_TrackerBinary         = false;
+        m_TrackerJournal        = "tracker_journal";
+        m_TrackerReport.reserve ( 65536 );
+        m_BatchIO               = false; // one syscall per datagram
+        m_NumWorkers            = 1;     // only the main thread
+        m_TickRate              = 0;     // forward every packet at once
+        m_Ticker                = 0;
+        pthread_mutex_init ( &m_PacketMutex, 0 );
         // clear stats - should show what type of packet was received
         m_PacketsReceived       = 0;
         m_PingReceived          = 0;
@@ -227,6 +245,14 @@ FG_SERVER::FG_SERVER
         m_CrossFeedSent         = 0;
         mT_CrossFeedFailed      = 0;
         mT_CrossFeedSent        = 0;
+        mT_RateLimited          = 0;
+        m_LodLastStats          = 0;
+        m_PredictedLastStats    = 0;
+        m_TrimmedLastStats      = 0;
+        m_TickForwarded         = 0;
+        m_TickSuperseded        = 0;
+        mT_TickForwarded        = 0;
+        mT_TickSuperseded       = 0;
         m_TrackerConnect        = 0;
         m_TrackerDisconnect     = 0;
         m_TrackerPosition       = 0; // Tracker messages queued
@@ -241,7 +267,9 @@ FG_SERVER::FG_SERVER
         m_useStatFile           = ( stat ( stat_file,&buf ) ) ? true : false;
 
         m_Uptime                = time(0);
+        m_LastStats             = m_Uptime;
         m_WantExit              = false;
+        m_WantReinit            = 0;
         ConfigFile              = "";
         SetLog (SG_FGMS|SG_FGTRACKER, SG_INFO);
         // SetLog (SG_ALL, SG_DISABLED);
@@ -278,11 +306,32 @@ admin_helper( void* context )
         return 0;
 }
 
+static void*
+worker_helper( void* context )
+{
+        st_worker* w = reinterpret_cast<st_worker*> ( context );
+        sigset_t   signals;
+        sigfillset ( &signals ); // signals are handled by the main thread
+        pthread_sigmask ( SIG_BLOCK, &signals, 0 );
+        w->Instance->WorkerLoop ( w );
+        return 0;
+}
+
+static void*
+ticker_helper( void* context )
+{
+        st_worker* w = reinterpret_cast<st_worker*> ( context );
+        sigset_t   signals;
+        sigfillset ( &signals ); // signals are handled by the main thread
+        pthread_sigmask ( SIG_BLOCK, &signals, 0 );
+        w->Instance->TickLoop ( w );
+        return 0;
+}
+
 void* detach_tracker ( void* vp )
 {
         FG_TRACKER* pt = reinterpret_cast<FG_TRACKER*> (vp);
         pt->Loop();
-        delete pt;
         return ( ( void* ) 0xdead );
 }
 
@@ -317,6 +366,11 @@ FG_SERVER::Init()
                         << m_LogFileName );
         }
         }
+        //////////////////////////////////////////////////
+        //      from now on log messages are written by
+        //      a background thread
+        //////////////////////////////////////////////////
+        sglog().start_async ();
         if ( m_Initialized == false )
         {
                 if ( m_Listening )
@@ -332,7 +386,9 @@ FG_SERVER::Init()
         if ( m_ReinitData )
         {
                 if ( m_DataSocket )
-                {
+                {       // the workers and the ticker send with it,
+                        // Loop() starts them again with the new one
+                        StopWorkers ();
                         delete m_DataSocket;
                         m_DataSocket = 0;
                 }
@@ -345,6 +401,12 @@ FG_SERVER::Init()
                 }
                 m_DataSocket->setBlocking ( false );
                 m_DataSocket->setSockOpt ( SO_REUSEADDR, true );
+#ifdef SO_REUSEPORT
+                if ( m_NumWorkers > 1 )
+                {
+                        m_DataSocket->setSockOpt ( SO_REUSEPORT, true );
+                }
+#endif
                 if ( m_DataSocket->bind ( m_BindAddress.c_str(), m_ListenPort ) != 0 )
                 {
                         SG_CONSOLE ( SG_FGMS, SG_ALERT, "FG_SERVER::Init() - "
@@ -353,6 +415,7 @@ FG_SERVER::Init()
                         return ( ERROR_COULDNT_BIND );
                 }
                 m_ReinitData = false;
+                m_ReinitReactor = true;
         }
         if ( m_ReinitTelnet )
         {
@@ -393,6 +456,7 @@ FG_SERVER::Init()
                         }
                 }
                 m_ReinitTelnet = false;
+                m_ReinitReactor = true;
         }
         if ( m_ReinitAdmin )
         {
@@ -427,6 +491,7 @@ FG_SERVER::Init()
                         }
                 }
                 m_ReinitAdmin = false;
+                m_ReinitReactor = true;
         }
         SG_CONSOLE (SG_FGMS, SG_ALERT, "# This is " << m_ServerName << "(" << m_FQDN << ")");
         SG_CONSOLE ( SG_FGMS, SG_ALERT, "# FlightGear Multiplayer Server v"
@@ -462,8 +527,8 @@ FG_SERVER::Init()
         }
         if (( m_IsTracked ) && (m_Tracker != 0))
         {
-                pthread_t th;
-                pthread_create ( &th, NULL, &detach_tracker, m_Tracker );
+                pthread_create ( &m_TrackerThread, NULL, &detach_tracker, m_Tracker );
+                m_TrackerRunning = true;
                 SG_CONSOLE ( SG_FGMS, SG_ALERT, "# tracked to "
                            << m_Tracker->GetTrackerServer ()
                            << ":" << m_Tracker->GetTrackerPort ()
@@ -516,6 +581,8 @@ FG_SERVER::Init()
 //////////////////////////////////////////////////////////////////////
 /**
  * @brief Do anything necessary to (re-) init the server  used to handle kill -HUP
+ *        Called by Loop() with the worker threads and the ticker stopped,
+ *        see RequestReinit().
  */
 void
 FG_SERVER::PrepareInit()
@@ -523,22 +590,36 @@ FG_SERVER::PrepareInit()
         if ( ! m_IsParent )
                 return;
         SG_LOG ( SG_FGMS, SG_ALERT, "# caught SIGHUP, doing reinit!" );
-        // release all locks
-        m_PlayerList.Unlock ();
-        m_RelayList.Unlock ();
-        m_CrossfeedList.Unlock ();
-        m_WhiteList.Unlock ();
-        m_BlackList.Unlock ();
-        // and clear all but the player list
+        // clear all but the player list
         m_RelayList.Clear ();
         m_WhiteList.Clear ();
         m_BlackList.Clear ();
+        m_RateLimit.Clear ();
+        m_RelaySched.Clear ();
+        pthread_mutex_lock ( &m_PacketMutex );
+        m_Lod.Clear ();
+        pthread_mutex_unlock ( &m_PacketMutex );
+        m_Egress.Clear ();
         m_CrossfeedList.Clear ();
         m_RelayMap.clear ();    // clear(): is a std::map (NOT a FG_List)
         CloseTracker ();
 } // FG_SERVER::PrepareInit ()
 //////////////////////////////////////////////////////////////////////
 
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Reinit the server as soon as possible. Only sets a flag, so
+ *        it is safe to call from a signal handler. Loop() stops all
+ *        threads using the lists and the data socket, before the
+ *        config is read again.
+ */
+void
+FG_SERVER::RequestReinit()
+{
+        m_WantReinit = 1;
+} // FG_SERVER::RequestReinit ()
+//////////////////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////////////////
 /**
  * @brief Handle an admin session. 
@@ -571,8 +652,7 @@ FG_SERVER::HandleTelnet( int Fd )
 {
         errno = 0;
         string          Message;
-        /** @brief  Geodetic Coordinates */
-        FG_Player       CurrentPlayer;
+        PlayerList::Snapshot Players;
         netSocket       NewTelnet;
         unsigned int    it;
         NewTelnet.setHandle ( Fd );
@@ -606,7 +686,8 @@ FG_SERVER::HandleTelnet( int Fd )
                 }
                 return ( 0 );
         }
-        Message  = "# "+ NumToStr ( m_PlayerList.Size(), 0 );
+        Players  = m_PlayerList.GetSnapshot ();
+        Message  = "# "+ NumToStr ( Players->size(), 0 );
         Message += " pilot(s) online\n";
         if ( NewTelnet.write_str ( Message ) < 0 )
         {
@@ -621,18 +702,9 @@ FG_SERVER::HandleTelnet( int Fd )
         //      create list of players
         //
         //////////////////////////////////////////////////
-        it = 0;
-        for ( ;; )
+        for ( it = 0; it < Players->size(); it++ )
         {
-                if ( it < m_PlayerList.Size() )
-                {
-                        CurrentPlayer = m_PlayerList[it];
-                        it++;
-                }
-                else
-                {
-                        break;
-                }
+                const FG_Player& CurrentPlayer = (*Players)[it];
                 if (CurrentPlayer.Name.compare (0, 3, "obs", 3) == 0)
                 {
                         continue;
@@ -661,9 +733,9 @@ FG_SERVER::HandleTelnet( int Fd )
                 Message += NumToStr ( CurrentPlayer.LastPos[X], 6 ) +" ";
                 Message += NumToStr ( CurrentPlayer.LastPos[Y], 6 ) +" ";
                 Message += NumToStr ( CurrentPlayer.LastPos[Z], 6 ) +" ";
-                Message += NumToStr ( CurrentPlayer.GeodPos[Lat], 6 ) +" ";
-                Message += NumToStr ( CurrentPlayer.GeodPos[Lon], 6 ) +" ";
-                Message += NumToStr ( CurrentPlayer.GeodPos[Alt], 6 ) +" ";
+                Message += NumToStr ( CurrentPlayer.GetGeodPos()[Lat], 6 ) +" ";
+                Message += NumToStr ( CurrentPlayer.GetGeodPos()[Lon], 6 ) +" ";
+                Message += NumToStr ( CurrentPlayer.GetGeodPos()[Alt], 6 ) +" ";
                 Message += NumToStr ( CurrentPlayer.LastOrientation[X], 6 ) +" ";
                 Message += NumToStr ( CurrentPlayer.LastOrientation[Y], 6 ) +" ";
                 Message += NumToStr ( CurrentPlayer.LastOrientation[Z], 6 ) +" ";
@@ -688,24 +760,50 @@ FG_SERVER::HandleTelnet( int Fd )
  *         the internal list anyway, but mark them as bad. But first
  *          we look if it isn't already there.
  *          Send an error message to the bad client.
+ *
+ * Senders of bad packets are remembered in m_BadSenders, so repeated
+ * bad packets neither search the player list nor build a message.
  * @param Sender
- * @param ErrorMsg
+ * @param Error the result of PacketIsValid()
+ * @param State the decoded packet
  * @param IsLocal
+ * @param Bytes
  */
 void
 FG_SERVER::AddBadClient
-( const netAddress& Sender, string&     ErrorMsg, bool IsLocal, int Bytes)
+(
+        const netAddress&       Sender,
+        int                     Error,
+        const FG_PlayerState&   State,
+        bool                    IsLocal,
+        int                     Bytes
+)
 {
-        string          Message;
         FG_Player       NewPlayer;
         PlayerIt        CurrentPlayer;
+        uint32_t        Key = Sender.getIP ();
         //////////////////////////////////////////////////
         //      see, if we already know the client
         //////////////////////////////////////////////////
         m_PlayerList.Lock ();
-        CurrentPlayer = m_PlayerList.Find (Sender);
+        CurrentPlayer = m_PlayerList.End ();
+        mT_BadSendersIt Known = m_BadSenders.find ( Key );
+        if ( Known != m_BadSenders.end() )
+        {
+                CurrentPlayer = m_PlayerList.FindByID ( Known->second );
+                if ( ( CurrentPlayer != m_PlayerList.End () )
+                &&   ( CurrentPlayer->Address != Sender ) )
+                {
+                        CurrentPlayer = m_PlayerList.End ();
+                }
+        }
+        if ( CurrentPlayer == m_PlayerList.End () )
+        {
+                CurrentPlayer = m_PlayerList.Find (Sender);
+        }
         if ( CurrentPlayer != m_PlayerList.End () )
         {
+                m_BadSenders[Key] = CurrentPlayer->ID;
                 CurrentPlayer->UpdateRcvd (Bytes);
                 m_PlayerList.UpdateRcvd (Bytes);
                 m_PlayerList.Unlock();
@@ -724,29 +822,107 @@ FG_SERVER::AddBadClient
         NewPlayer.Address   = Sender;
         NewPlayer.IsLocal   = IsLocal;
         NewPlayer.HasErrors = true;
-        NewPlayer.Error     = ErrorMsg;
+        NewPlayer.Error     = PacketErrorMsg ( Error, State, Sender );
         NewPlayer.UpdateRcvd (Bytes);
-        SG_LOG ( SG_FGMS, SG_WARN, "FG_SERVER::AddBadClient() - " << ErrorMsg );
-        m_PlayerList.Add (NewPlayer, m_PlayerExpires);
+        SG_LOG ( SG_FGMS, SG_WARN, "FG_SERVER::AddBadClient() - " << NewPlayer.Error );
+        m_BadSenders[Key] = m_PlayerList.Add (NewPlayer, m_PlayerExpires);
         m_PlayerList.UpdateRcvd (Bytes);
         m_PlayerList.Unlock();
 } // FG_SERVER::AddBadClient ()
 
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Decode the header of a packet, and the position if it is a
+ *        position packet. Fields which are not present are zero.
+ *
+ * Nothing beyond Bytes is read. A packet too small for the header
+ * decodes to all zero. The position is only decoded if the packet
+ * holds all of it, both by MsgLen and by the bytes received, so
+ * HasPosition is false for a truncated or short position packet and
+ * PacketIsValid() rejects it.
+ * @param Msg the packet as received
+ * @param Bytes the number of bytes received
+ */
+void
+FG_PlayerState::Decode ( const char* Msg, int Bytes )
+{
+        const T_MsgHdr*         MsgHdr;
+        const T_PositionMsg*    PosMsg;
+        const uint32_t          PosLen = sizeof ( T_MsgHdr ) + sizeof ( T_PositionMsg );
+
+        HasPosition = false;
+        Model       = "";
+        if ( Bytes < ( int ) sizeof ( T_MsgHdr ) )
+        {
+                memset ( Callsign, 0, MAX_CALLSIGN_LEN );
+                Magic      = 0;
+                MsgId      = 0;
+                MsgLen     = 0;
+                Version    = 0;
+                RadarRange = 0;
+        }
+        else
+        {
+                MsgHdr      = ( const T_MsgHdr* ) Msg;
+                memcpy ( Callsign, MsgHdr->Name, MAX_CALLSIGN_LEN );
+                Magic       = XDR_decode<uint32_t> ( MsgHdr->Magic );
+                MsgId       = XDR_decode<uint32_t> ( MsgHdr->MsgId );
+                MsgLen      = XDR_decode<uint32_t> ( MsgHdr->MsgLen );
+                Version     = XDR_decode<uint32_t> ( MsgHdr->Version );
+                RadarRange  = XDR_decode<uint32_t> ( MsgHdr->RadarRange );
+        }
+        if ( ( MsgId != FGFS::POS_DATA )
+        ||   ( MsgLen < PosLen )
+        ||   ( MsgLen > ( uint32_t ) Bytes ) )
+        {
+                memset ( Position, 0, sizeof ( Position ) );
+                memset ( Orientation, 0, sizeof ( Orientation ) );
+                memset ( &Motion, 0, sizeof ( Motion ) );
+                return;
+        }
+        PosMsg = ( const T_PositionMsg* ) ( Msg + sizeof ( T_MsgHdr ) );
+        for ( int i = 0; i < 3; i++ )
+        {
+                Position[i]    = XDR_decode64<double> ( PosMsg->position[i] );
+                Orientation[i] = XDR_decode<float> ( PosMsg->orientation[i] );
+                Motion.Position[i]    = Position[i];
+                Motion.Orientation[i] = Orientation[i];
+                Motion.LinearVel[i]   = XDR_decode<float> ( PosMsg->linearVel[i] );
+                Motion.LinearAccel[i] = XDR_decode<float> ( PosMsg->linearAccel[i] );
+                Motion.AngularVel[i]  = XDR_decode<float> ( PosMsg->angularVel[i] );
+        }
+        Motion.Time = XDR_decode64<double> ( PosMsg->time );
+        Model       = PosMsg->Model;
+        HasPosition = true;
+} // FG_PlayerState::Decode ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief 'hidden' feature of fgms. If a callsign starts with 'obs',
+ *        the packets are not sent to other clients. Useful for test
+ *        connections.
+ */
+bool
+FG_PlayerState::IsObserver () const
+{
+        return ( ( Callsign[0] == 'o' ) && ( Callsign[1] == 'b' ) && ( Callsign[2] == 's' ) );
+} // FG_PlayerState::IsObserver ()
+//////////////////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////////////////
 /**
  * @brief Insert a new client to internal list
  * @param Sender
- * @param Msg
+ * @param State the decoded position packet of the client
  */
 void
-FG_SERVER::AddClient( const netAddress& Sender,char* Msg )
+FG_SERVER::AddClient( const netAddress& Sender, const FG_PlayerState& State )
 {
-        uint32_t        MsgMagic;
         uint32_t        ProtoVersion;
+        uint32_t        RadarRange;
         string          Message;
         string          Origin;
-        T_MsgHdr*       MsgHdr;
-        T_PositionMsg*  PosMsg;
         FG_Player       NewPlayer;
         bool            IsLocal;
         typedef struct
@@ -756,17 +932,15 @@ FG_SERVER::AddClient( const netAddress& Sender,char* Msg )
         } converter;
         converter* tmp;
 
-        MsgHdr          = ( T_MsgHdr* ) Msg;
-        PosMsg          = ( T_PositionMsg* ) ( Msg + sizeof ( T_MsgHdr ) );
-        MsgMagic        = XDR_decode<uint32_t> ( MsgHdr->Magic );
         IsLocal         = true;
-        if ( MsgMagic == RELAY_MAGIC ) // not a local client
+        if ( State.Magic == RELAY_MAGIC ) // not a local client
         {
                 IsLocal = false;
         }
-        ProtoVersion    = XDR_decode<uint32_t> ( MsgHdr->Version );
+        ProtoVersion    = State.Version;
         tmp = ( converter* ) & ProtoVersion;
-        NewPlayer.Name      = MsgHdr->Name;
+        NewPlayer.Name.assign ( State.Callsign,
+          strnlen ( State.Callsign, MAX_CALLSIGN_LEN ) );
         NewPlayer.Passwd    = "test"; //MsgHdr->Passwd;
         NewPlayer.ModelName = "* unknown *";
         NewPlayer.Origin    = Sender.getHost ();
@@ -774,18 +948,10 @@ FG_SERVER::AddClient( const netAddress& Sender,char* Msg )
         NewPlayer.IsLocal   = IsLocal;
         NewPlayer.ProtoMajor    = tmp->High;
         NewPlayer.ProtoMinor    = tmp->Low;
-        NewPlayer.LastPos.Set (
-                XDR_decode64<double> ( PosMsg->position[X] ),
-                XDR_decode64<double> ( PosMsg->position[Y] ),
-                XDR_decode64<double> ( PosMsg->position[Z] )
-        );
-        NewPlayer.LastOrientation.Set (
-                XDR_decode<float> ( PosMsg->orientation[X] ),
-                XDR_decode<float> ( PosMsg->orientation[Y] ),
-                XDR_decode<float> ( PosMsg->orientation[Z] )
-        );
-        sgCartToGeod ( NewPlayer.LastPos, NewPlayer.GeodPos );
-        NewPlayer.ModelName = PosMsg->Model;
+        NewPlayer.SetPosition ( State.Position[X], State.Position[Y], State.Position[Z] );
+        NewPlayer.LastOrientation.Set ( State.Orientation[X],
+          State.Orientation[Y], State.Orientation[Z] );
+        NewPlayer.ModelName.assign ( State.Model, strnlen ( State.Model, MAX_MODEL_NAME_LEN ) );
         if ( ( NewPlayer.ModelName == "OpenRadar" ) || ( NewPlayer.ModelName.find("ATC") != std::string::npos ) )
         {       // client is an ATC
                 if ( str_ends_with ( NewPlayer.Name, "_DL" ) )
@@ -803,8 +969,8 @@ FG_SERVER::AddClient( const netAddress& Sender,char* Msg )
                 else    NewPlayer.IsATC = FG_Player::ATC;
         }
 
-        MsgHdr->RadarRange = XDR_decode<uint32_t> ( MsgHdr->RadarRange );
-        tmp =  ( converter* ) & MsgHdr->RadarRange;
+        RadarRange = State.RadarRange;
+        tmp =  ( converter* ) & RadarRange;
         if ( ( tmp->Low != 0 ) || ( tmp->High == 0 ) )
         {
                 // client comes from an old server which overwrites the radar range
@@ -819,6 +985,15 @@ FG_SERVER::AddClient( const netAddress& Sender,char* Msg )
         if ( NewPlayer.RadarRange == 0 )
                 NewPlayer.RadarRange = m_PlayerIsOutOfReach;
         m_PlayerList.Add ( NewPlayer, m_PlayerExpires );
+        if ( IsLocal )
+        {
+                m_PlayerGrid.Update ( NewPlayer.ID, NewPlayer.LastPos, NewPlayer.RadarRange );
+        }
+        else
+        {
+                RelayPlayers ( NewPlayer.Address ).Update ( NewPlayer.ID,
+                  NewPlayer.LastPos, NewPlayer.RadarRange );
+        }
         size_t NumClients = m_PlayerList.Size ();
         if ( NumClients > m_NumMaxClients )
         {
@@ -888,6 +1063,7 @@ FG_SERVER::AddRelay( const string& Relay, int Port )
         if ( CurrentEntry == m_RelayList.End() )
         {       
                 m_RelayList.Add (B, 0);
+                m_RateLimit.Exempt ( B.Address );
                 string S;
                 if (B.Address.getHost() == Relay)
                 {
@@ -951,9 +1127,62 @@ FG_SERVER::AddTracker( const string& Server, int Port, bool IsTracked )
         CloseTracker();
         m_IsTracked = IsTracked;
         m_Tracker = new FG_TRACKER ( Port, Server, m_ServerName, m_FQDN );
+        m_Tracker->SetWindow ( m_TrackerWindow );
+        m_Tracker->SetBinary ( m_TrackerBinary );
+        m_Tracker->SetJournal ( m_TrackerJournal );
         return ( SUCCESS );
 } // FG_SERVER::AddTracker()
 
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the number of messages sent to the tracker before it
+ *        has to acknowledge them. Call before AddTracker().
+ * @param Window number of messages
+ */
+void
+FG_SERVER::SetTrackerWindow( int Window )
+{
+        m_TrackerWindow = ( Window < 1 ) ? 1 : Window;
+} // FG_SERVER::SetTrackerWindow()
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Only report players to the tracker which moved at least
+ *        Meters since they were reported last. 0 reports all players.
+ * @param Meters the minimum distance
+ */
+void
+FG_SERVER::SetTrackerDelta( int Meters )
+{
+        m_TrackerDelta = ( Meters < 0 ) ? 0 : Meters;
+} // FG_SERVER::SetTrackerDelta()
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Offer the tracker to send messages in binary frames instead
+ *        of text. The text protocol is kept if the tracker does not
+ *        accept the offer. Call before AddTracker().
+ * @param Binary true to offer binary framing
+ */
+void
+FG_SERVER::SetTrackerBinary( bool Binary )
+{
+        m_TrackerBinary = Binary;
+} // FG_SERVER::SetTrackerBinary()
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Keep the messages for the tracker in a journal on disk until
+ *        the tracker acknowledged them. Call before AddTracker().
+ * @param Dir directory of the journal, an empty string keeps the
+ *        messages in memory
+ */
+void
+FG_SERVER::SetTrackerJournal( const string& Dir )
+{
+        m_TrackerJournal = Dir;
+} // FG_SERVER::SetTrackerJournal()
+
 //////////////////////////////////////////////////////////////////////
 /**
  * @brief Add an IP to the whitelist
@@ -970,25 +1199,72 @@ FG_SERVER::AddWhitelist( const string& DottedIP )
         if ( CurrentEntry == m_WhiteList.End() )
         {
                 m_WhiteList.Add (B, 0);
+                m_RateLimit.Exempt ( B.Address );
         }
 } // FG_SERVER::AddBlacklist()
 
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Exempt Address from the rate limit if it is whitelisted or
+ *        a relay, limit it otherwise. Call after an entry of either
+ *        list was added or deleted.
+ * @param Address IP of the entry
+ */
+void
+FG_SERVER::UpdateExempt( const netAddress& Address )
+{
+        m_WhiteList.Lock ();
+        bool Trusted = ( m_WhiteList.Find ( Address, "" ) != m_WhiteList.End() );
+        m_WhiteList.Unlock ();
+        m_RelayList.Lock ();
+        Trusted = Trusted || ( m_RelayList.Find ( Address, "" ) != m_RelayList.End() );
+        m_RelayList.Unlock ();
+        if ( Trusted )
+        {
+                m_RateLimit.Exempt ( Address );
+        }
+        else
+        {
+                m_RateLimit.Unexempt ( Address );
+        }
+} // FG_SERVER::UpdateExempt()
+
 //////////////////////////////////////////////////////////////////////
 /**
  * @brief Add an IP to the blacklist
- * @param FourDottedIP IP to add to blacklist
+ * @param DottedIP IP to add to blacklist, or a network in CIDR
+ *        notation (eg. 192.168.1.0/24) to block all of its IPs
  */
 void
 FG_SERVER::AddBlacklist( const string& DottedIP, const string& Reason, time_t Timeout)
 {
         FG_ListElement B (Reason);
-        B.Address.set (DottedIP.c_str(), 0);
+        string  IP   = DottedIP;
+        int     Bits = 32;
+        size_t  Slash = DottedIP.find ( '/' );
+        if ( Slash != string::npos )
+        {
+                IP   = DottedIP.substr ( 0, Slash );
+                Bits = atoi ( DottedIP.c_str() + Slash + 1 );
+                if ( ( Bits < 1 ) || ( Bits > 32 ) )
+                {
+                        SG_LOG ( SG_FGMS, SG_ALERT, "FG_SERVER::AddBlacklist() - "
+                          << "invalid network " << DottedIP );
+                        return;
+                }
+        }
+        B.Address.set (IP.c_str(), 0);
         m_BlackList.Lock ();
         ItList CurrentEntry = m_BlackList.Find ( B.Address, "" );
+        size_t ID = ( CurrentEntry == m_BlackList.End() ) ? 0 : CurrentEntry->ID;
         m_BlackList.Unlock ();
-        if ( CurrentEntry == m_BlackList.End() )
+        if ( ( ID == 0 ) || ( m_BlackList.PrefixLength ( ID ) != Bits ) )
         {       // FIXME: every list has its own standard TTL
-                m_BlackList.Add (B, Timeout);
+                m_BlackList.Add (B, Timeout, Bits);
+        }
+        else
+        {       // eg. a repeated offence is blocked longer
+                m_BlackList.Extend ( ID, Timeout );
         }
 } // FG_SERVER::AddBlacklist()
 
@@ -1037,84 +1313,110 @@ FG_SERVER::IsKnownRelay( const netAddress& SenderAddress, size_t Bytes)
 //      check if the packet is valid
 //
 //////////////////////////////////////////////////////////////////////
-/**
- * @brief
+/** thread safe
+ *
+ * Check the header of a packet. Only the decoded header is looked at,
+ * nothing is allocated. All conditions are evaluated at once, so a
+ * valid packet costs a single branch.
+ * @param Bytes size of the packet
+ * @param State the decoded packet
+ * @return PACKET_VALID or the reason to reject the packet,
+ *         see PacketErrorMsg()
  */
-bool
+int
 FG_SERVER::PacketIsValid
 (
-        int             Bytes,
-        T_MsgHdr*       MsgHdr,
-        const netAddress& SenderAddress
-)
+        int                     Bytes,
+        const FG_PlayerState&   State
+) const
+{
+        typedef struct
+        {
+                uint16_t High;
+                uint16_t Low;
+        } converter;
+        const converter* Version = ( const converter* ) & State.Version;
+
+        bool TooSmall  = Bytes < ( int ) sizeof ( T_MsgHdr );
+        bool BadMagic  = ( State.Magic != MSG_MAGIC ) & ( State.Magic != RELAY_MAGIC );
+        bool BadProto  = Version->High != m_ProtoMajorVersion;
+        bool ShortPos  = ( State.MsgId == FGFS::POS_DATA ) & ! State.HasPosition;
+        if ( ! ( TooSmall | BadMagic | BadProto | ShortPos ) )
+        {
+                return PACKET_VALID;
+        }
+        if ( TooSmall )
+                return PACKET_TOO_SMALL;
+        if ( BadMagic )
+                return PACKET_BAD_MAGIC;
+        if ( BadProto )
+                return PACKET_BAD_VERSION;
+        return PACKET_SHORT_POSITION;
+} // FG_SERVER::PacketIsValid ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Describe why a packet was rejected by PacketIsValid().
+ *        Only called if the message is really needed.
+ * @param Error the result of PacketIsValid()
+ * @param State the decoded packet
+ * @param Sender the sender of the packet
+ * @return a human readable message
+ */
+string
+FG_SERVER::PacketErrorMsg
+(
+        int                     Error,
+        const FG_PlayerState&   State,
+        const netAddress&       Sender
+) const
 {
-        uint32_t        MsgMagic;
-        uint32_t        MsgLen;
-        uint32_t        MsgId;
-        uint32_t        ProtoVer;
         string          ErrorMsg;
-        string          Origin;
         typedef struct
         {
                 uint16_t High;
                 uint16_t Low;
         } converter;
-        converter*    tmp;
+        const converter* tmp;
 
-        Origin   = SenderAddress.getHost();
-        MsgMagic = XDR_decode<uint32_t> ( MsgHdr->Magic );
-        MsgId    = XDR_decode<uint32_t> ( MsgHdr->MsgId );
-        MsgLen   = XDR_decode<uint32_t> ( MsgHdr->MsgLen );
-        if ( Bytes < ( int ) sizeof ( MsgHdr ) )
+        ErrorMsg = Sender.getHost();
+        switch ( Error )
         {
-                ErrorMsg  = SenderAddress.getHost();
+        case PACKET_TOO_SMALL:
                 ErrorMsg += " packet size is too small!";
-                AddBadClient ( SenderAddress, ErrorMsg, true, Bytes );
-                return ( false );
-        }
-        if ( ( MsgMagic != MSG_MAGIC ) && ( MsgMagic != RELAY_MAGIC ) )
-        {
-                char m[5];
-                memcpy ( m, ( char* ) &MsgMagic, 4 );
-                m[4] = 0;
-                ErrorMsg  = Origin;
-                ErrorMsg += " BAD magic number: ";
-                ErrorMsg += m;
-                AddBadClient ( SenderAddress, ErrorMsg, true, Bytes );
-                return ( false );
-        }
-        ProtoVer = XDR_decode<uint32_t> ( MsgHdr->Version );
-        tmp = ( converter* ) & ProtoVer;
-        if ( tmp->High != m_ProtoMajorVersion )
-        {
-                MsgHdr->Version = XDR_decode<uint32_t> ( MsgHdr->Version );
-                ErrorMsg  = Origin;
+                break;
+        case PACKET_BAD_MAGIC:
+                {
+                        char m[5];
+                        memcpy ( m, ( const char* ) &State.Magic, 4 );
+                        m[4] = 0;
+                        ErrorMsg += " BAD magic number: ";
+                        ErrorMsg += m;
+                }
+                break;
+        case PACKET_BAD_VERSION:
                 ErrorMsg += " BAD protocol version! Should be ";
-                tmp = ( converter* ) ( & PROTO_VER );
+                tmp = ( const converter* ) ( & PROTO_VER );
                 ErrorMsg += NumToStr ( tmp->High, 0 );
                 ErrorMsg += "." + NumToStr ( tmp->Low, 0 );
                 ErrorMsg += " but is ";
-                tmp = ( converter* ) ( & MsgHdr->Version );
+                tmp = ( const converter* ) ( & State.Version );
                 ErrorMsg += NumToStr ( tmp->Low, 0 );
                 ErrorMsg += "." + NumToStr ( tmp->High, 0 );
-                AddBadClient ( SenderAddress, ErrorMsg, true, Bytes );
-                return ( false );
-        }
-        if ( MsgId == FGFS::POS_DATA )
-        {
-                if ( MsgLen < sizeof ( T_MsgHdr ) + sizeof ( T_PositionMsg ) )
-                {
-                        ErrorMsg  = Origin;
-                        ErrorMsg += " Client sends insufficient position data, ";
-                        ErrorMsg += "should be ";
-                        ErrorMsg += NumToStr ( sizeof ( T_MsgHdr ) +sizeof ( T_PositionMsg ) );
-                        ErrorMsg += " is: " + NumToStr ( MsgHdr->MsgLen );
-                        AddBadClient ( SenderAddress, ErrorMsg, true, Bytes );
-                        return ( false );
-                }
+                break;
+        case PACKET_SHORT_POSITION:
+                ErrorMsg += " Client sends insufficient or truncated position data, ";
+                ErrorMsg += "should be ";
+                ErrorMsg += NumToStr ( sizeof ( T_MsgHdr ) +sizeof ( T_PositionMsg ) );
+                ErrorMsg += " is: " + NumToStr ( State.MsgLen );
+                break;
+        default:
+                ErrorMsg += " sent a valid packet";
+                break;
         }
-        return ( true );
-} // FG_SERVER::PacketIsValid ()
+        return ErrorMsg;
+} // FG_SERVER::PacketErrorMsg ()
 //////////////////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////////////////
@@ -1124,11 +1426,10 @@ FG_SERVER::PacketIsValid
  *         mainly used for testing and debugging
  */
 void
-FG_SERVER::SendToCrossfeed( char* Msg, int Bytes, const netAddress& SenderAddress)
+FG_SERVER::SendToCrossfeed( char* Msg, int Bytes, const netAddress& SenderAddress, st_worker& Worker )
 {
         T_MsgHdr*       MsgHdr;
         uint32_t        MsgMagic;
-        int             sent;
         ItList          Entry;
 
         MsgHdr          = ( T_MsgHdr* ) Msg;
@@ -1136,9 +1437,17 @@ FG_SERVER::SendToCrossfeed( char* Msg, int Bytes, const netAddress& SenderAddres
         MsgHdr->Magic   = XDR_encode<uint32_t> ( RELAY_MAGIC );
         m_CrossfeedList.Lock();
         for (Entry = m_CrossfeedList.Begin(); Entry != m_CrossfeedList.End(); Entry++)
-        {
-                sent = m_DataSocket->sendto ( Msg, Bytes, 0, &Entry->Address );
-                m_CrossfeedList.UpdateSent (Entry, sent);
+        {       // count only what was sent or queued
+                if ( m_Egress.Send ( Worker.Socket, Msg, Bytes, Entry->Address,
+                  FG_Egress::NO_SENDER ) )
+                {
+                        m_CrossfeedList.UpdateSent (Entry, Bytes);
+                        m_CrossFeedSent.fetch_add ( 1, std::memory_order_relaxed );
+                }
+                else
+                {
+                        m_CrossFeedFailed.fetch_add ( 1, std::memory_order_relaxed );
+                }
         }
         m_CrossfeedList.Unlock();
         MsgHdr->Magic = MsgMagic;  // restore the magic value
@@ -1147,25 +1456,23 @@ FG_SERVER::SendToCrossfeed( char* Msg, int Bytes, const netAddress& SenderAddres
 
 //////////////////////////////////////////////////////////////////////
 /**
- * @brief  Send message to all relay servers
+ * @brief  Collect all relay servers which want the message
+ *         in Worker.RelayTo, they are served by FlushSendTo().
+ *         m_RelaySched decides by the distance of the sender to
+ *         the pilots behind a relay, how many of the packets of
+ *         the sender the relay gets.
  */
 void
-FG_SERVER::SendToRelays( char* Msg, int Bytes, PlayerIt& SendingPlayer )
+FG_SERVER::SendToRelays( char* Msg, int Bytes, PlayerIt& SendingPlayer, st_worker& Worker )
 {
-        T_MsgHdr*       MsgHdr;
-        uint32_t        MsgMagic;
-        uint32_t        MsgId;
         unsigned int    PktsForwarded = 0;
         ItList          CurrentRelay;
+        mT_RelayPlayersIt Pilots;
 
         if ( (! SendingPlayer->IsLocal ) && ( ! m_IamHUB ) )
         {
                 return;
         }
-        MsgHdr    = ( T_MsgHdr* ) Msg;
-        MsgMagic  = XDR_decode<uint32_t> ( MsgHdr->Magic );
-        MsgId     = XDR_decode<uint32_t> ( MsgHdr->MsgId );
-        MsgHdr->Magic = XDR_encode<uint32_t> ( RELAY_MAGIC );
         m_RelayList.Lock ();
         CurrentRelay = m_RelayList.Begin();
         while ( CurrentRelay != m_RelayList.End() )
@@ -1173,9 +1480,12 @@ FG_SERVER::SendToRelays( char* Msg, int Bytes, PlayerIt& SendingPlayer )
 
                 if ( CurrentRelay->Address.getIP() != SendingPlayer->Address.getIP() )
                 {
-                        if ( SendingPlayer->DoUpdate || IsInRange ( *CurrentRelay, SendingPlayer, MsgId ) )
+                        uint64_t Key = RelayKey ( CurrentRelay->Address );
+                        Pilots = m_RelayPlayers.find ( Key );
+                        if ( m_RelaySched.Send ( Key, SendingPlayer->ID, SendingPlayer->LastPos,
+                          ( Pilots == m_RelayPlayers.end() ) ? 0 : &Pilots->second, Bytes ) )
                         {
-                                m_DataSocket->sendto ( Msg, Bytes, 0, &CurrentRelay->Address );
+                                Worker.RelayTo.push_back ( CurrentRelay->Address );
                                 m_RelayList.UpdateSent (CurrentRelay, Bytes);
                                 PktsForwarded++;
                         }
@@ -1183,10 +1493,63 @@ FG_SERVER::SendToRelays( char* Msg, int Bytes, PlayerIt& SendingPlayer )
                 CurrentRelay++;
         }
         m_RelayList.Unlock ();
-        MsgHdr->Magic = XDR_encode<uint32_t> ( MsgMagic ); // restore the magic value
 } // FG_SERVER::SendToRelays ()
 //////////////////////////////////////////////////////////////////////
 
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief  Send a message to all local clients collected in
+ *         Worker.SendTo and all relays in Worker.RelayTo,
+ *         either with one syscall per receiver or batched.
+ *         Clients in Worker.TrimTo get the trimmed copies of
+ *         the message. All lists are cleared afterwards.
+ */
+void
+FG_SERVER::FlushSendTo( char* Msg, int Bytes, st_worker& Worker )
+{
+        T_MsgHdr*       MsgHdr;
+        uint32_t        MsgMagic;
+
+        MsgHdr    = ( T_MsgHdr* ) Msg;
+        MsgMagic  = MsgHdr->Magic;
+        if ( ! Worker.SendTo.empty() )
+        {
+                MsgHdr->Magic = XDR_encode<uint32_t> ( MSG_MAGIC );
+                SendToAll ( Msg, Bytes, Worker.Socket, Worker.SendTo, Worker.Sender );
+        }
+        for ( int b = 0; b < FG_PropertyFilter::MAX_BANDS; b++ )
+        {
+                if ( Worker.TrimTo[b].empty() )
+                        continue;
+                char* Trimmed = &Worker.Trimmed[b][0];
+                ( ( T_MsgHdr* ) Trimmed )->Magic = XDR_encode<uint32_t> ( MSG_MAGIC );
+                SendToAll ( Trimmed, Worker.TrimmedBytes[b], Worker.Socket, Worker.TrimTo[b],
+                  Worker.Sender );
+        }
+        if ( ! Worker.RelayTo.empty() )
+        {
+                MsgHdr->Magic = XDR_encode<uint32_t> ( RELAY_MAGIC );
+                SendToAll ( Msg, Bytes, Worker.Socket, Worker.RelayTo, Worker.Sender );
+        }
+        MsgHdr->Magic = MsgMagic;  // restore the magic value
+} // FG_SERVER::FlushSendTo ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief  Send a message to a list of addresses, the list is
+ *         cleared afterwards. Addresses which can not take the
+ *         message now get it queued by m_Egress.
+ * @param Sender the player the message is a position of,
+ *         FG_Egress::NO_SENDER for other messages
+ */
+void
+FG_SERVER::SendToAll( char* Msg, int Bytes, netSocket* Socket, std::vector<netAddress>& To, size_t Sender )
+{
+        m_Egress.Send ( Socket, m_BatchIO, Msg, Bytes, To, Sender );
+} // FG_SERVER::SendToAll ()
+//////////////////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////////////////
 //      Remove Player from list
 void
@@ -1216,6 +1579,19 @@ FG_SERVER::DropClient( PlayerIt& CurrentPlayer )
         {
                 Origin = "LOCAL";
         }
+        m_PlayerGrid.Remove ( CurrentPlayer->ID );
+        DropRelayPlayer ( *CurrentPlayer );
+        m_RelaySched.Forget ( CurrentPlayer->ID );
+        m_LatestStates.erase ( CurrentPlayer->ID );
+        if ( CurrentPlayer->IsLocal )
+        {
+                m_Egress.Forget ( CurrentPlayer->Address );
+        }
+        mT_BadSendersIt Bad = m_BadSenders.find ( CurrentPlayer->Address.getIP () );
+        if ( ( Bad != m_BadSenders.end() ) && ( Bad->second == CurrentPlayer->ID ) )
+        {
+                m_BadSenders.erase ( Bad );
+        }
         SG_LOG (SG_FGMS, SG_INFO, "Dropping pilot "
                 << CurrentPlayer->Name << "@" << Origin
                 << " after " << time(0)-CurrentPlayer->JoinTime << " seconds. "
@@ -1229,27 +1605,87 @@ FG_SERVER::DropClient( PlayerIt& CurrentPlayer )
 //////////////////////////////////////////////////////////////////////
 /**
  * @brief Handle client connections
+ *
+ * The packet is processed while holding m_PacketMutex, the (possibly
+ * many) sendto() calls to the receivers are done afterwards, so that
+ * several workers can send in parallel.
  * @param Msg
  * @param Bytes
  * @param SenderAddress
+ * @param Worker the worker which received the packet
  */
 void
 FG_SERVER::HandlePacket
 (
         char* Msg,
         int Bytes,
-        const netAddress& SenderAddress
+        const netAddress& SenderAddress,
+        st_worker& Worker
+)
+{
+        //////////////////////////////////////////////////
+        //
+        //  drop packets of sources which send too
+        //  fast, before any work is done for them
+        //
+        //////////////////////////////////////////////////
+        time_t BlockTime = 0;
+        switch ( m_RateLimit.Check ( SenderAddress, BlockTime ) )
+        {
+        case FG_RateLimit::PASS:
+                break;
+        case FG_RateLimit::ESCALATE:
+                SG_LOG ( SG_FGMS, SG_ALERT, "FG_SERVER::HandlePacket() - "
+                  << SenderAddress.getHost() << " exceeds the rate limit, "
+                  << "blocked for " << BlockTime << " seconds" );
+                pthread_mutex_lock ( &m_PacketMutex );
+                AddBlacklist ( SenderAddress.getHost(), "rate limit exceeded", BlockTime );
+                pthread_mutex_unlock ( &m_PacketMutex );
+                Worker.PktsRateLimited.fetch_add ( 1, std::memory_order_relaxed );
+                return;
+        case FG_RateLimit::DROP:
+                Worker.PktsRateLimited.fetch_add ( 1, std::memory_order_relaxed );
+                return;
+        }
+        if ( m_BlackList.IsBlocked ( SenderAddress, Bytes ) )
+        {       // lock free, before the crossfeed and m_PacketMutex
+                m_BlackRejected.fetch_add ( 1, std::memory_order_relaxed );
+                return;
+        }
+        //////////////////////////////////////////////////
+        //
+        //  First of all, send packet to all
+        //  crossfeed servers.
+        //
+        //////////////////////////////////////////////////
+        SendToCrossfeed ( Msg, Bytes, SenderAddress, Worker );
+        pthread_mutex_lock ( &m_PacketMutex );
+        m_PacketsReceived++;
+        ProcessPacket ( Msg, Bytes, SenderAddress, Worker );
+        pthread_mutex_unlock ( &m_PacketMutex );
+        FlushSendTo ( Msg, Bytes, Worker );
+} // FG_SERVER::HandlePacket ();
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Process a packet, collect the receivers in Worker.SendTo
+ *        and Worker.RelayTo. In tick mode position packets are
+ *        only kept, see KeepLatest(). Called with m_PacketMutex held.
+ */
+void
+FG_SERVER::ProcessPacket
+(
+        char* Msg,
+        int Bytes,
+        const netAddress& SenderAddress,
+        st_worker& Worker
 )
 {
         T_MsgHdr*       MsgHdr;
-        T_PositionMsg*  PosMsg;
         uint32_t        MsgId;
         uint32_t        MsgMagic;
         PlayerIt        SendingPlayer;
-        PlayerIt        CurrentPlayer;
-        ItList          CurrentEntry;
-        time_t          Now;
-        unsigned int    PktsForwarded = 0;
         typedef struct
         {
                 uint16_t High;
@@ -1257,34 +1693,20 @@ FG_SERVER::HandlePacket
         } converter;
         converter* tmp;
 
+        FG_PlayerState& State = Worker.State;
         MsgHdr    = ( T_MsgHdr* ) Msg;
-        MsgMagic  = XDR_decode<uint32_t> ( MsgHdr->Magic );
-        MsgId     = XDR_decode<uint32_t> ( MsgHdr->MsgId );
-        Now       = time ( 0 );
-        //////////////////////////////////////////////////
-        //
-        //  First of all, send packet to all
-        //  crossfeed servers.
-        //
-        //////////////////////////////////////////////////
-        SendToCrossfeed ( Msg, Bytes, SenderAddress );
+        State.Decode ( Msg, Bytes );
+        MsgMagic  = State.Magic;
+        MsgId     = State.MsgId;
         //////////////////////////////////////////////////
         //
         //  Now do the local processing
         //
         //////////////////////////////////////////////////
-        m_BlackList.Lock ();
-        CurrentEntry = m_BlackList.Find ( SenderAddress, "" );
-        if ( CurrentEntry != m_BlackList.End() )
-        {
-                m_BlackList.UpdateRcvd (CurrentEntry, Bytes);
-                m_BlackRejected++;
-                m_BlackList.Unlock ();
-                return;
-        }
-        m_BlackList.Unlock ();
-        if ( ! PacketIsValid ( Bytes, MsgHdr, SenderAddress ) )
+        int Error = PacketIsValid ( Bytes, State );
+        if ( Error != PACKET_VALID )
         {
+                AddBadClient ( SenderAddress, Error, State, true, Bytes );
                 m_PacketsInvalid++;
                 return;
         }
@@ -1319,7 +1741,7 @@ FG_SERVER::HandlePacket
                         // send packet verbatim back to sender
                         m_PingReceived++;
                         MsgHdr->MsgId = XDR_encode<uint32_t> ( FGFS::PONG );
-                        m_DataSocket->sendto ( Msg, Bytes, 0, &SenderAddress );
+                        Worker.Socket->sendto ( Msg, Bytes, 0, &SenderAddress );
                         return;
                 }
                 else if ( MsgId == FGFS::PONG )
@@ -1337,7 +1759,7 @@ FG_SERVER::HandlePacket
         //
         //////////////////////////////////////////////////
         m_PlayerList.Lock();
-        SendingPlayer = m_PlayerList.FindByName ( MsgHdr->Name );
+        SendingPlayer = m_PlayerList.FindByName ( State.Callsign, MAX_CALLSIGN_LEN );
         if (SendingPlayer == m_PlayerList.End () )
         {
                 // unknown, add to the list
@@ -1347,7 +1769,7 @@ FG_SERVER::HandlePacket
                         m_PlayerList.Unlock();
                         return;
                 }
-                AddClient ( SenderAddress, Msg );
+                AddClient ( SenderAddress, State );
                 SendingPlayer = m_PlayerList.Last();
         }
         else
@@ -1363,28 +1785,22 @@ FG_SERVER::HandlePacket
                         return;
                 }
                 m_PlayerList.UpdateRcvd (SendingPlayer, Bytes);
-                if ( MsgId == FGFS::POS_DATA )
+                if ( State.HasPosition )
                 {
-                        PosMsg = ( T_PositionMsg* ) ( Msg + sizeof ( T_MsgHdr ) );
-                        double x = XDR_decode64<double> ( PosMsg->position[X] );
-                        double y = XDR_decode64<double> ( PosMsg->position[Y] );
-                        double z = XDR_decode64<double> ( PosMsg->position[Z] );
-                        if ( ( x == 0.0 ) || ( y == 0.0 ) || ( z == 0.0 ) )
+                        if ( ( State.Position[X] == 0.0 )
+                        ||   ( State.Position[Y] == 0.0 )
+                        ||   ( State.Position[Z] == 0.0 ) )
                         {
                                 // ignore while position is not settled
                                 m_PlayerList.Unlock();
                                 return;
                         }
-                        SendingPlayer->LastPos.Set ( x, y, z );
-                        SendingPlayer->LastOrientation.Set (
-                                XDR_decode<float> ( PosMsg->orientation[X] ),
-                                XDR_decode<float> ( PosMsg->orientation[Y] ),
-                                XDR_decode<float> ( PosMsg->orientation[Z] )
-                        );
-                        sgCartToGeod ( SendingPlayer->LastPos, SendingPlayer->GeodPos );
-                }
-                MsgHdr->RadarRange = XDR_decode<uint32_t> ( MsgHdr->RadarRange );
-                tmp =  ( converter* ) & MsgHdr->RadarRange;
+                        SendingPlayer->SetPosition ( State.Position[X],
+                          State.Position[Y], State.Position[Z] );
+                        SendingPlayer->LastOrientation.Set ( State.Orientation[X],
+                          State.Orientation[Y], State.Orientation[Z] );
+                }
+                tmp =  ( converter* ) & State.RadarRange;
                 if ( ( tmp->High != 0 ) && ( tmp->Low == 0 ) )
                 {       // client is 'new' and transmit radar range
                         if ( tmp->High != SendingPlayer->RadarRange )
@@ -1399,113 +1815,214 @@ FG_SERVER::HandlePacket
                                 }
                         }
                 }
+                if ( SendingPlayer->IsLocal )
+                {
+                        m_PlayerGrid.Update ( SendingPlayer->ID,
+                          SendingPlayer->LastPos, SendingPlayer->RadarRange );
+                }
+                else
+                {
+                        RelayPlayers ( SendingPlayer->Address ).Update ( SendingPlayer->ID,
+                          SendingPlayer->LastPos, SendingPlayer->RadarRange );
+                }
         }
         m_PlayerList.Unlock();
-        //////////////////////////////////////////
-        //
-        //      send the packet to all clients.
-        //      since we are walking through the list,
-        //      we look for the sending client, too. if it
-        //      is not already there, add it to the list
-        //
-        //////////////////////////////////////////////////
-        MsgHdr->Magic = XDR_encode<uint32_t> ( MSG_MAGIC );
-        CurrentPlayer = m_PlayerList.Begin();
-        while ( CurrentPlayer != m_PlayerList.End() )
-        {
-                //////////////////////////////////////////////////
-                //
-                //      ignore clients with errors
-                //
-                //////////////////////////////////////////////////
-                if ( CurrentPlayer->HasErrors )
+        // the radar range is forwarded decoded, as it always was.
+        // Receiving servers recognize this (see AddClient)
+        MsgHdr->RadarRange = State.RadarRange;
+        if ( ( m_TickRate != 0 ) && ( MsgId == FGFS::POS_DATA ) )
+        {       // forwarded with the next tick, see Tick()
+                KeepLatest ( Msg, Bytes, SendingPlayer->ID );
+                return;
+        }
+        FanOut ( Msg, Bytes, SendingPlayer, Worker );
+} // FG_SERVER::ProcessPacket ();
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Collect the local clients and relays which get the packet
+ *        of SendingPlayer in Worker.SendTo, Worker.TrimTo and
+ *        Worker.RelayTo. Worker.State must hold the decoded packet.
+ *        Called with m_PacketMutex held.
+ */
+void
+FG_SERVER::FanOut
+(
+        char* Msg,
+        int Bytes,
+        PlayerIt& SendingPlayer,
+        st_worker& Worker
+)
+{
+        PlayerIt        CurrentPlayer;
+        unsigned int    PktsForwarded = 0;
+
+        FG_PlayerState& State = Worker.State;
+        Worker.Sender = State.HasPosition ? SendingPlayer->ID : FG_Egress::NO_SENDER;
+        //////////////////////////////////////////////////
+        // 'hidden' feature of fgms. If a callsign starts
+        // with 'obs', do not send the packet to other
+        // clients. Useful for test connections.
+        //////////////////////////////////////////////////
+        if ( State.IsObserver () )
+        {
+                SendToRelays ( Msg, Bytes, SendingPlayer, Worker );
+                return;
+        }
+        //////////////////////////////////////////
+        //
+        //      send the packet to all local clients
+        //      near the sender. The grid only holds
+        //      local clients and returns those which
+        //      have the sender within their radar
+        //      range ('radio' rules, see
+        //      ReceiverWantsData()). The distances are
+        //      checked in batches by InRangeMask().
+        //      Far away receivers get less position
+        //      packets, or only those they can not
+        //      predict, see m_Lod, and less properties,
+        //      see m_PropertyFilter.
+        //
+        //////////////////////////////////////////////////
+        bool Thin = State.HasPosition && m_Lod.Enabled ();
+        bool Trim = State.HasPosition && m_PropertyFilter.Enabled ();
+        if ( Trim )
+        {
+                for ( int b = 0; b < FG_PropertyFilter::MAX_BANDS; b++ )
+                        Worker.TrimmedBytes[b] = -1;
+        }
+        m_PlayerGrid.Receivers ( SendingPlayer->LastPos, Worker.Receivers );
+        for ( size_t i = 0; i < Worker.Receivers.size(); i++ )
+        {
+                if ( Worker.Receivers[i] == SendingPlayer->ID )
+                {
+                        continue; // don't send packet back to sender
+                }
+                CurrentPlayer = m_PlayerList.FindByID ( Worker.Receivers[i] );
+                if ( CurrentPlayer == m_PlayerList.End() )
                 {
-                        if ((Now - CurrentPlayer->LastSeen) > CurrentPlayer->Timeout )
-                        {
-                                DropClient (CurrentPlayer); 
-                        }
-                        else
-                        {
-                                CurrentPlayer++;
-                        }
                         continue;
                 }
                 //////////////////////////////////////////////////
-                //        Sender == CurrentPlayer?
+                //      ignore clients with errors
                 //////////////////////////////////////////////////
-                //  FIXME: if Sender is a Relay,
-                //         CurrentPlayer->Address will be
-                //         address of Relay and not the client's!
-                //         so use a clientID instead
-                if ( CurrentPlayer->Name == MsgHdr->Name )
-                {
-                        //////////////////////////////////////////////////
-                        //      send update to inactive relays?
-                        //////////////////////////////////////////////////
-                        CurrentPlayer->DoUpdate = ( (Now - CurrentPlayer->LastRelayedToInactive) > UPDATE_INACTIVE_PERIOD );
-                        if ( CurrentPlayer->DoUpdate )
-                        {
-                                CurrentPlayer->LastRelayedToInactive = Now;
-                        }
-                        CurrentPlayer++;
-                        continue; // don't send packet back to sender
+                if ( CurrentPlayer->HasErrors || ! CurrentPlayer->IsLocal )
+                {
+                        continue;
                 }
-                //////////////////////////////////////////////////
-                // 'hidden' feature of fgms. If a callsign starts
-                // with 'obs', do not send the packet to other
-                // clients. Useful for test connections.
-                //////////////////////////////////////////////////
-                if ( std::string (MsgHdr->Name).compare (0, 3, "obs", 3) == 0 )
+                // if ( MsgId == CHAT_MSG_ID ) and
+                //   not ReceiverWantsChat( SendingPlayer, *CurrentPlayer )
+                //   continue;
+                float Dist = 0;
+                if ( Thin || Trim )
+                {
+                        Dist = Distance ( SendingPlayer->LastPos, CurrentPlayer->LastPos );
+                }
+                if ( Thin && ! m_Lod.Forward ( SendingPlayer->ID, CurrentPlayer->ID,
+                  Dist, State.Motion ) )
                 {
-                        CurrentPlayer++;
                         continue;
                 }
-                //////////////////////////////////////////////////
-                //      do not send packet to clients which
-                //      are out of reach.
-                //////////////////////////////////////////////////
-                if ( MsgId == CHAT_MSG_ID )
-                {       // apply 'radio' rules
-                        // if ( not ReceiverWantsChat( SendingPlayer, *CurrentPlayer ) )
-                        if ( ! ReceiverWantsData ( SendingPlayer, *CurrentPlayer ) )
-                        {
-                                CurrentPlayer++;
-                                continue;
-                        }
+                int Band = Trim ? m_PropertyFilter.GetBand ( Dist ) : -1;
+                if ( ( Band >= 0 ) && ( Worker.TrimmedBytes[Band] < 0 ) )
+                {       // trim once per band and packet
+                        Worker.Trimmed[Band].resize ( MAX_PACKET_SIZE );
+                        Worker.TrimmedBytes[Band] = m_PropertyFilter.Trim ( Band,
+                          Msg, Bytes, &Worker.Trimmed[Band][0] );
                 }
-                else
+                if ( ( Band >= 0 ) && ( Worker.TrimmedBytes[Band] > 0 ) )
                 {
-                        // apply 'visibility' rules, for now we apply 'radio' rules
-                        if ( ! ReceiverWantsData ( SendingPlayer, *CurrentPlayer ) )
-                        {
-                                CurrentPlayer++;
-                                continue;
-                        }
+                        Worker.TrimTo[Band].push_back ( CurrentPlayer->Address );
+                        m_PlayerList.UpdateSent (CurrentPlayer, Worker.TrimmedBytes[Band]);
+                        m_PropertyFilter.BytesSaved += Bytes - Worker.TrimmedBytes[Band];
                 }
-                //////////////////////////////////////////////////
-                //
-                //  only send packet to local clients
-                //
-                //////////////////////////////////////////////////
-                if ( CurrentPlayer->IsLocal )
+                else
                 {
-                        m_DataSocket->sendto ( Msg, Bytes, 0, &CurrentPlayer->Address );
+                        Worker.SendTo.push_back ( CurrentPlayer->Address );
                         m_PlayerList.UpdateSent (CurrentPlayer, Bytes);
-                        PktsForwarded++;
                 }
-                CurrentPlayer++;
+                PktsForwarded++;
         }
-        if ( SendingPlayer->ID ==  FG_ListElement::NONE_EXISTANT )
+        SendToRelays ( Msg, Bytes, SendingPlayer, Worker );
+} // FG_SERVER::FanOut ();
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Keep the packet as the newest state of player ID, which is
+ *        forwarded with the next tick. A state which was not yet
+ *        forwarded is superseded. Called with m_PacketMutex held.
+ */
+void
+FG_SERVER::KeepLatest( const char* Msg, int Bytes, size_t ID )
+{
+        mT_LatestStatesIt Slot = m_LatestStates.find ( ID );
+        if ( Slot == m_LatestStates.end() )
         {
-                // player not yet in our list
-                // should not happen, but test just in case
-                SG_LOG ( SG_FGMS, SG_ALERT, "## BAD => "
-                         << MsgHdr->Name << ":" << SenderAddress.getHost()
-                       );
-                return;
+                Slot = m_LatestStates.insert ( mT_LatestStates::value_type (
+                  ID, st_latest_state() ) ).first;
+                Slot->second.Msg.resize ( MAX_PACKET_SIZE );
+                Slot->second.Fresh = false;
         }
-        SendToRelays ( Msg, Bytes, SendingPlayer );
-} // FG_SERVER::HandlePacket ();
+        if ( Slot->second.Fresh )
+        {
+                m_TickSuperseded++;
+        }
+        else
+        {
+                Slot->second.Fresh = true;
+                m_TickPending.push_back ( ID );
+        }
+        memcpy ( &Slot->second.Msg[0], Msg, Bytes );
+        Slot->second.Bytes = Bytes;
+} // FG_SERVER::KeepLatest ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Forward the newest state of every player which sent a
+ *        position since the last tick.
+ *
+ * The state is copied, so m_PacketMutex is only held while the
+ * receivers are collected, not while the packet is sent.
+ */
+void
+FG_SERVER::Tick( st_worker& Ticker )
+{
+        char            Msg[MAX_PACKET_SIZE];
+        int             Bytes;
+        PlayerIt        SendingPlayer;
+
+        pthread_mutex_lock ( &m_PacketMutex );
+        m_TickWork.swap ( m_TickPending );
+        pthread_mutex_unlock ( &m_PacketMutex );
+        for ( size_t i = 0; i < m_TickWork.size(); i++ )
+        {
+                pthread_mutex_lock ( &m_PacketMutex );
+                mT_LatestStatesIt Slot = m_LatestStates.find ( m_TickWork[i] );
+                if ( ( Slot == m_LatestStates.end() ) || ( ! Slot->second.Fresh ) )
+                {       // the player left
+                        pthread_mutex_unlock ( &m_PacketMutex );
+                        continue;
+                }
+                Slot->second.Fresh = false;
+                SendingPlayer = m_PlayerList.FindByID ( m_TickWork[i] );
+                if ( SendingPlayer == m_PlayerList.End() )
+                {
+                        pthread_mutex_unlock ( &m_PacketMutex );
+                        continue;
+                }
+                Bytes = Slot->second.Bytes;
+                memcpy ( Msg, &Slot->second.Msg[0], Bytes );
+                Ticker.State.Decode ( Msg, Bytes );
+                FanOut ( Msg, Bytes, SendingPlayer, Ticker );
+                m_TickForwarded++;
+                pthread_mutex_unlock ( &m_PacketMutex );
+                FlushSendTo ( Msg, Bytes, Ticker );
+        }
+        m_TickWork.clear ();
+} // FG_SERVER::Tick ()
 //////////////////////////////////////////////////////////////////////
 
 /**
@@ -1514,24 +2031,66 @@ FG_SERVER::HandlePacket
 void FG_SERVER::Show_Stats ( void )
 {
         int pilot_cnt, local_cnt;
+        // the counters of ProcessPacket() and Tick() are taken and reset
+        // under m_PacketMutex, the others are atomic
+        pthread_mutex_lock ( &m_PacketMutex );
+        size_t PacketsReceived  = m_PacketsReceived;
+        size_t PacketsInvalid   = m_PacketsInvalid;
+        size_t UnknownRelay     = m_UnknownRelay;
+        size_t RelayMagic       = m_RelayMagic;
+        size_t PositionData     = m_PositionData;
+        size_t UnkownMsgID      = m_UnkownMsgID;
+        size_t TickForwarded    = m_TickForwarded;
+        size_t TickSuperseded   = m_TickSuperseded;
+        m_PacketsReceived = m_PacketsInvalid = 0;
+        m_UnknownRelay = m_PositionData = 0;
+        m_RelayMagic = m_UnkownMsgID = 0;
+        m_TickForwarded = m_TickSuperseded = 0;
+        // packets not forwarded to local clients by the LOD policy
+        size_t LodThinned       = m_Lod.Thinned;
+        size_t LodPredicted     = m_Lod.Predicted;
+        // packets rewritten by the property filter
+        size_t PfTrimmed        = m_PropertyFilter.Trimmed;
+        size_t PfUnparsable     = m_PropertyFilter.Unparsable;
+        pthread_mutex_unlock ( &m_PacketMutex );
+        size_t BlackRejected    = m_BlackRejected.exchange ( 0 );
+        size_t CrossFeedFailed  = m_CrossFeedFailed.exchange ( 0 );
+        size_t CrossFeedSent    = m_CrossFeedSent.exchange ( 0 );
         // update totals since start
-        mT_PacketsReceived += m_PacketsReceived;
-        mT_BlackRejected   += m_BlackRejected;
-        mT_PacketsInvalid  += m_PacketsInvalid;
-        mT_UnknownRelay    += m_UnknownRelay;
-        mT_RelayMagic      += m_RelayMagic;
-        mT_PositionData    += m_PositionData;
-        mT_UnkownMsgID     += m_UnkownMsgID;
+        mT_PacketsReceived += PacketsReceived;
+        mT_BlackRejected   += BlackRejected;
+        mT_PacketsInvalid  += PacketsInvalid;
+        mT_UnknownRelay    += UnknownRelay;
+        mT_RelayMagic      += RelayMagic;
+        mT_PositionData    += PositionData;
+        mT_UnkownMsgID     += UnkownMsgID;
         mT_TelnetReceived  += m_TelnetReceived;
-        mT_CrossFeedFailed += m_CrossFeedFailed;
-        mT_CrossFeedSent   += m_CrossFeedSent;
+        mT_CrossFeedFailed += CrossFeedFailed;
+        mT_CrossFeedSent   += CrossFeedSent;
+        // packets dropped by the rate limit are counted by the workers
+        size_t RateLimited = 0;
+        for ( size_t i = 0; i < m_Workers.size(); i++ )
+        {
+                size_t Count = m_Workers[i]->PktsRateLimited.load ();
+                RateLimited += Count - m_Workers[i]->RateLimitedLastStats;
+                m_Workers[i]->RateLimitedLastStats = Count;
+        }
+        mT_RateLimited     += RateLimited;
+        mT_TickForwarded   += TickForwarded;
+        mT_TickSuperseded  += TickSuperseded;
+        size_t LodThinnedSince  = LodThinned - m_LodLastStats;
+        size_t LodPredictedSince = LodPredicted - m_PredictedLastStats;
+        m_LodLastStats     = LodThinned;
+        m_PredictedLastStats = LodPredicted;
+        size_t Trimmed     = PfTrimmed - m_TrimmedLastStats;
+        m_TrimmedLastStats = PfTrimmed;
         // output to LOG and cerr channels
         pilot_cnt = local_cnt = 0;
-        FG_Player CurrentPlayer; // get LOCAL pilot count
-        pilot_cnt = m_PlayerList.Size ();
+        PlayerList::Snapshot Players = m_PlayerList.GetSnapshot ();
+        pilot_cnt = Players->size ();
         for (int i = 0; i < pilot_cnt; i++)
-        {
-                CurrentPlayer = m_PlayerList[i];
+        {       // get LOCAL pilot count
+                const FG_Player& CurrentPlayer = (*Players)[i];
                 if (CurrentPlayer.ID == FG_ListElement::NONE_EXISTANT)
                         continue;
                 if ( CurrentPlayer.IsLocal )
@@ -1541,18 +2100,23 @@ void FG_SERVER::Show_Stats ( void )
         }
         SG_LOG ( SG_FGMS, SG_ALERT, "## Pilots: total " << pilot_cnt << ", local " << local_cnt );
         SG_LOG ( SG_FGMS, SG_ALERT, "## Since: Packets " <<
-                   m_PacketsReceived << " BL=" <<
-                   m_BlackRejected << " INV=" <<
-                   m_PacketsInvalid << " UR=" <<
-                   m_UnknownRelay << " RD=" <<
-                   m_RelayMagic << " PD=" <<
-                   m_PositionData << " NP=" <<
-                   m_UnkownMsgID << " CF=" <<
-                   m_CrossFeedSent << "/" << m_CrossFeedFailed << " TN=" <<
-                   m_TelnetReceived
+                   PacketsReceived << " RL=" <<
+                   RateLimited << " BL=" <<
+                   BlackRejected << " INV=" <<
+                   PacketsInvalid << " UR=" <<
+                   UnknownRelay << " RD=" <<
+                   RelayMagic << " PD=" <<
+                   PositionData << " NP=" <<
+                   UnkownMsgID << " CF=" <<
+                   CrossFeedSent << "/" << CrossFeedFailed << " TN=" <<
+                   m_TelnetReceived << " LOD=" <<
+                   LodThinnedSince << "/" << LodPredictedSince << " PF=" <<
+                   Trimmed << " TK=" <<
+                   TickForwarded << "/" << TickSuperseded
                  );
         SG_LOG ( SG_FGMS, SG_ALERT, "## Total: Packets " <<
-                   mT_PacketsReceived << " BL=" <<
+                   mT_PacketsReceived << " RL=" <<
+                   mT_RateLimited << " BL=" <<
                    mT_BlackRejected << " INV=" <<
                    mT_PacketsInvalid << " UR=" <<
                    mT_UnknownRelay << " RD=" <<
@@ -1561,13 +2125,26 @@ void FG_SERVER::Show_Stats ( void )
                    mT_UnkownMsgID <<  " CF=" <<
                    mT_CrossFeedSent << "/" << mT_CrossFeedFailed << " TN=" <<
                    mT_TelnetReceived << " TC/D/P=" <<
-                   m_TrackerConnect << "/" << m_TrackerDisconnect << "/" << m_TrackerPosition
+                   m_TrackerConnect << "/" << m_TrackerDisconnect << "/" << m_TrackerPosition << " LOD=" <<
+                   LodThinned << "/" << LodPredicted << " PF=" <<
+                   PfTrimmed << "/" << PfUnparsable << " TK=" <<
+                   mT_TickForwarded << "/" << mT_TickSuperseded << " EQ=" <<
+                   m_Egress.Queued.load () << "/" << m_Egress.Superseded.load () << "/" <<
+                   m_Egress.Dropped.load () << "/" << m_Egress.Errors.load ()
                  );
+        // packet rate of every worker since the last stats
+        time_t Now = time ( 0 );
+        time_t Elapsed = ( Now > m_LastStats ) ? ( Now - m_LastStats ) : 1;
+        for ( size_t i = 0; i < m_Workers.size(); i++ )
+        {
+                size_t Pkts = m_Workers[i]->PktsReceived.load () - m_Workers[i]->PktsLastStats;
+                m_Workers[i]->PktsLastStats += Pkts;
+                SG_LOG ( SG_FGMS, SG_ALERT, "## Worker " << i << ": Packets "
+                  << Pkts << " (" << Pkts / Elapsed << "/s)" );
+        }
+        m_LastStats = Now;
         // restart 'since' last stat counter
-        m_PacketsReceived = m_BlackRejected = m_PacketsInvalid = 0;
-        m_UnknownRelay = m_PositionData = m_TelnetReceived = 0; // reset
-        m_RelayMagic = m_UnkownMsgID = 0; // reset
-        m_CrossFeedFailed = m_CrossFeedSent = 0;
+        m_TelnetReceived = 0; // reset
 }
 
 /**
@@ -1618,7 +2195,7 @@ FG_SERVER::check_files()
                 m_ReinitData    = true; // init the data port
                 m_ReinitTelnet  = true; // init the telnet port
                 m_ReinitAdmin   = true; // init the admin port
-                SigHUPHandler ( 0 );
+                m_WantReinit    = 1;
         }
         else if ( m_useStatFile && ( stat ( stat_file,&buf ) == 0 ) )
         {
@@ -1669,14 +2246,11 @@ FG_SERVER::WantExit()
 int
 FG_SERVER::Loop()
 {
-        int         Bytes;
-        char        Msg[MAX_PACKET_SIZE];
-        netAddress  SenderAddress;
-        netSocket*  ListenSockets[3 + MAX_TELNETS];
-        time_t      LastTrackerUpdate;
-        time_t      CurrentTime;
-        LastTrackerUpdate = time ( 0 );
-        PlayerIt        CurrentPlayer;
+        FG_Reactor      Reactor;
+        FG_TimerWheel   Timers;
+        netSocket*      Ready[3];
+        std::vector<int> Expired;
+        int             NumReady;
         m_IsParent = true;
         if ( m_Listening == false )
         {
@@ -1694,6 +2268,7 @@ FG_SERVER::Loop()
                         m_AdminSocket->close();
                         delete m_AdminSocket;
                         m_AdminSocket = 0;
+                        m_ReinitReactor = true;
                         SG_CONSOLE (SG_FGMS, SG_ALERT, "# Admin port disabled, please set user and password");
                 }
         }
@@ -1707,6 +2282,20 @@ FG_SERVER::Loop()
         }
         //////////////////////////////////////////////////
         //
+        //      periodic jobs
+        //
+        //////////////////////////////////////////////////
+        Timers.Start ( time ( 0 ) );
+        Timers.Add ( TIMER_EXPIRE_PLAYERS, 1 );
+        Timers.Add ( TIMER_PUBLISH_PLAYERS, 1 );
+        Timers.Add ( TIMER_EXPIRE_BLACKLIST, 1 );
+        Timers.Add ( TIMER_UPDATE_TRACKER, m_UpdateTrackerFreq );
+        Timers.Add ( TIMER_CHECK_FILES, m_UpdateTrackerFreq );
+        Timers.Add ( TIMER_EXPIRE_RATELIMIT, 10 );
+        Timers.Add ( TIMER_EXPIRE_LOD, 10 );
+        Timers.Add ( TIMER_EXPIRE_EGRESS, 10 );
+        //////////////////////////////////////////////////
+        //
         //      infinite listening loop
         //
         //////////////////////////////////////////////////
@@ -1722,112 +2311,578 @@ FG_SERVER::Loop()
                         cout << "bummer 2!" << endl;
                         return 2;
                 }
-                CurrentTime = time ( 0 );
-                // check timeout
-                CurrentPlayer = m_PlayerList.Begin();
-                for (size_t i = 0; i < m_PlayerList.Size(); i++)
-                {       
-                        if(!m_PlayerList.CheckTTL ( i ) || (((CurrentTime - CurrentPlayer->LastSeen) > CurrentPlayer->Timeout ) &&  ((CurrentTime - CurrentPlayer->JoinTime) > 30)))
-                        {
-                                DropClient (CurrentPlayer); 
-                        }
-                        CurrentPlayer++;
+                if ( m_WantReinit )
+                {       // the workers and the ticker use the lists and
+                        // the data socket, which are replaced now
+                        m_WantReinit = 0;
+                        StopWorkers ();
+                        ReloadConfig ();
+                        m_ReinitReactor = true;
                 }
-                for (size_t i = 0; i < m_BlackList.Size(); i++)
-                {
-                        if(!m_BlackList.CheckTTL ( i ))
-                        {
-                                m_BlackList.DeleteByPosition ( i );
-                        }
+                if ( m_ReinitReactor )
+                {       // (re)register sockets, they changed in Init()
+                        m_ReinitReactor = false;
+                        StopWorkers ();
+                        Reactor.Clear ();
+                        Reactor.Add ( m_DataSocket );
+                        Reactor.Add ( m_TelnetSocket );
+                        Reactor.Add ( m_AdminSocket );
+                        StartWorkers ();
                 }
-                
-                // Update some things every (default) 10 secondes
-        if ( ( ( CurrentTime - LastTrackerUpdate ) >= m_UpdateTrackerFreq ) ||
-             ( ( CurrentTime - LastTrackerUpdate ) < 0 ) )
+                Timers.Advance ( time ( 0 ), Expired );
+                for ( size_t i = 0; i < Expired.size(); i++ )
                 {
-                        LastTrackerUpdate = time ( 0 );
-                        if ( m_PlayerList.Size() >0 )
-                        {
-                                // updates the position of the users
-                                // regularly (tracker)
-                                UpdateTracker ("" , "", "", LastTrackerUpdate, UPDATE );
-                        }
-                        if ( check_files() )
+                        switch ( Expired[i] )
                         {
+                        case TIMER_EXPIRE_PLAYERS:
+                                pthread_mutex_lock ( &m_PacketMutex );
+                                ExpirePlayers ();
+                                pthread_mutex_unlock ( &m_PacketMutex );
+                                break;
+                        case TIMER_PUBLISH_PLAYERS:
+                                pthread_mutex_lock ( &m_PacketMutex );
+                                m_PlayerList.Publish ();
+                                pthread_mutex_unlock ( &m_PacketMutex );
+                                break;
+                        case TIMER_EXPIRE_BLACKLIST:
+                                ExpireBlacklist ();
+                                break;
+                        case TIMER_UPDATE_TRACKER:
+                                if ( m_PlayerList.Size() >0 )
+                                {
+                                        // updates the position of the users
+                                        // regularly (tracker)
+                                        UpdateTracker ("" , "", "", time ( 0 ), UPDATE );
+                                }
+                                break;
+                        case TIMER_CHECK_FILES:
+                                if ( check_files() )
+                                {
+                                        m_WantExit = true;
+                                }
+                                break;
+                        case TIMER_EXPIRE_RATELIMIT:
+                                m_RateLimit.Expire ();
+                                break;
+                        case TIMER_EXPIRE_LOD:
+                                pthread_mutex_lock ( &m_PacketMutex );
+                                m_Lod.Expire ();
+                                pthread_mutex_unlock ( &m_PacketMutex );
+                                break;
+                        case TIMER_EXPIRE_EGRESS:
+                                m_Egress.Expire ();
                                 break;
                         }
-                } // position (tracker)
-                errno = 0;
-                ListenSockets[0] = m_DataSocket;
-                ListenSockets[1] = m_TelnetSocket;
-                ListenSockets[2] = m_AdminSocket;
-                ListenSockets[3] = 0;
-                Bytes = m_DataSocket->select ( ListenSockets, 0, m_PlayerExpires );
-                if ( Bytes < 0 )
-                {       // error
-                        continue;
                 }
-                else if (Bytes == 0)
+                if ( m_WantExit )
                 {
-                        continue;
+                        break;
                 }
-                
-                if ( ListenSockets[0] != nullptr )
+                errno = 0;
+                // retry queued packets soon, the socket may take them again
+                NumReady = Reactor.Wait ( m_Egress.Pending () ?
+                  FG_Egress::RETRY_INTERVAL : 1000, Ready, 3 );
+                // same address and port as the workers' sockets
+                m_Egress.Flush ( m_DataSocket );
+                for ( int i = 0; i < NumReady; i++ )
                 {
-                        // something on the wire (clients)
-                        Bytes = m_DataSocket->recvfrom ( Msg,MAX_PACKET_SIZE, 0, &SenderAddress );
-                        if ( Bytes <= 0 )
-                        {
-                                continue;
+                        if ( Ready[i] == m_DataSocket )
+                        {       // something on the wire (clients)
+                                ReadDataSocket ( *m_Workers[0] );
                         }
-                        m_PacketsReceived++;
-                        HandlePacket ( ( char* ) &Msg, Bytes, SenderAddress );
-                } // DataSocket
-                else if ( ListenSockets[1] != nullptr )
-                {
-                        // something on the wire (telnet)
-                        netAddress TelnetAddress;
-                        m_TelnetReceived++;
-                        int Fd = m_TelnetSocket->accept ( &TelnetAddress );
-                        if ( Fd < 0 )
-                        {
-                                if ( ( errno != EAGAIN ) && ( errno != EPIPE ) )
-                                {
-                                        SG_LOG ( SG_FGMS, SG_ALERT, "FG_SERVER::Loop() - " << strerror ( errno ) );
-                                }
-                                continue;
+                        else if ( Ready[i] == m_TelnetSocket )
+                        {       // something on the wire (telnet)
+                                m_TelnetReceived++;
+                                AcceptConnection ( m_TelnetSocket, false );
                         }
-                        st_telnet* t = new st_telnet;
-                        t->Instance = this;
-                        t->Fd       = Fd;
-                        pthread_t th;
-                        pthread_create ( &th, NULL, &telnet_helper, t );
-                } // TelnetSocket
-                else if ( ListenSockets[2] != nullptr )
-                {
-                        // something on the wire (admin port)
-                        netAddress AdminAddress;
-                        m_AdminReceived++;
-                        int Fd = m_AdminSocket->accept ( &AdminAddress );
-                        if ( Fd < 0 )
-                        {
-                                if ( ( errno != EAGAIN ) && ( errno != EPIPE ) )
-                                {
-                                        SG_LOG ( SG_FGMS, SG_ALERT, "FG_SERVER::Loop() - " << strerror ( errno ) );
-                                }
-                                continue;
+                        else if ( Ready[i] == m_AdminSocket )
+                        {       // something on the wire (admin port)
+                                m_AdminReceived++;
+                                AcceptConnection ( m_AdminSocket, true );
                         }
-                        SG_LOG ( SG_FGMS, SG_ALERT, "FG_SERVER::Loop() - new Admin connection from "
-                          << AdminAddress.getHost());
-                        st_telnet* t = new st_telnet;
-                        t->Instance = this;
-                        t->Fd       = Fd;
-                        pthread_t th;
-                        pthread_create ( &th, NULL, &admin_helper, t );
-                } // TelnetSocket
+                }
         }
         return ( 0 );
 } // FG_SERVER::Loop()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Read all pending datagrams (up to RECV_BATCH) from the data
+ *        socket of a worker and handle them.
+ */
+void
+FG_SERVER::ReadDataSocket( st_worker& Worker )
+{
+        char        Msg[RECV_BATCH][MAX_PACKET_SIZE];
+        int         MsgLen[RECV_BATCH];
+        netAddress  SenderAddress[RECV_BATCH];
+        int         Count;
+
+        if ( m_BatchIO )
+        {       // drain a burst of datagrams at once
+                Count = Worker.Socket->recvfrom_many ( &Msg[0][0],
+                  MAX_PACKET_SIZE, RECV_BATCH, MsgLen, SenderAddress );
+        }
+        else
+        {
+                for ( Count = 0; Count < RECV_BATCH; Count++ )
+                {
+                        MsgLen[Count] = Worker.Socket->recvfrom ( Msg[Count],
+                          MAX_PACKET_SIZE, 0, &SenderAddress[Count] );
+                        if ( MsgLen[Count] < 0 )
+                        {       // nothing more to read
+                                break;
+                        }
+                }
+        }
+        for ( int i = 0; i < Count; i++ )
+        {
+                if ( MsgLen[i] <= 0 )
+                {
+                        continue;
+                }
+                Worker.PktsReceived.fetch_add ( 1, std::memory_order_relaxed );
+                HandlePacket ( Msg[i], MsgLen[i], SenderAddress[i], Worker );
+        }
+} // FG_SERVER::ReadDataSocket()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Accept a connection on the telnet or admin port and start
+ *        a thread handling it.
+ */
+void
+FG_SERVER::AcceptConnection( netSocket* Listener, bool IsAdmin )
+{
+        netAddress Address;
+        int Fd = Listener->accept ( &Address );
+        if ( Fd < 0 )
+        {
+                if ( ( errno != EAGAIN ) && ( errno != EPIPE ) )
+                {
+                        SG_LOG ( SG_FGMS, SG_ALERT, "FG_SERVER::Loop() - " << strerror ( errno ) );
+                }
+                return;
+        }
+        st_telnet* t = new st_telnet;
+        t->Instance = this;
+        t->Fd       = Fd;
+        pthread_t th;
+        if ( IsAdmin )
+        {
+                SG_LOG ( SG_FGMS, SG_ALERT, "FG_SERVER::Loop() - new Admin connection from "
+                  << Address.getHost());
+                pthread_create ( &th, NULL, &admin_helper, t );
+        }
+        else
+        {
+                pthread_create ( &th, NULL, &telnet_helper, t );
+        }
+} // FG_SERVER::AcceptConnection()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Drop all players which did not send data for too long
+ */
+void
+FG_SERVER::ExpirePlayers()
+{
+        PlayerIt        CurrentPlayer;
+        time_t          CurrentTime;
+        size_t          i = 0;
+
+        CurrentTime = time ( 0 );
+        CurrentPlayer = m_PlayerList.Begin();
+        while ( CurrentPlayer != m_PlayerList.End() )
+        {
+                if(!m_PlayerList.CheckTTL ( i ) || (((CurrentTime - CurrentPlayer->LastSeen) > CurrentPlayer->Timeout ) &&  ((CurrentTime - CurrentPlayer->JoinTime) > 30)))
+                {       // DropClient moves the next player to this position
+                        DropClient (CurrentPlayer);
+                        continue;
+                }
+                CurrentPlayer++;
+                i++;
+        }
+} // FG_SERVER::ExpirePlayers()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Remove blacklist entries whose TTL has expired
+ */
+void
+FG_SERVER::ExpireBlacklist()
+{
+        m_BlackList.Expire ( time ( 0 ) );
+} // FG_SERVER::ExpireBlacklist()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the number of threads handling the data port.
+ *        Every thread owns a socket bound to the data port with
+ *        SO_REUSEPORT, the kernel distributes the clients.
+ */
+void
+FG_SERVER::SetWorkerThreads( int NumWorkers )
+{
+        if ( NumWorkers < 1 )
+        {
+                NumWorkers = 1;
+        }
+#ifndef SO_REUSEPORT
+        if ( NumWorkers > 1 )
+        {
+                SG_LOG ( SG_FGMS, SG_ALERT, "SO_REUSEPORT is not supported "
+                  << "on this platform, using one worker thread" );
+                NumWorkers = 1;
+        }
+#endif
+        if ( NumWorkers != m_NumWorkers )
+        {
+                m_NumWorkers   = NumWorkers;
+                m_ReinitData   = true; // data socket needs SO_REUSEPORT
+        }
+} // FG_SERVER::SetWorkerThreads ( int NumWorkers )
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the number of packets per second accepted from a single
+ *        IP, 0 disables rate limiting. Relays and whitelisted IPs are
+ *        not limited.
+ */
+void
+FG_SERVER::SetRateLimit( int PktsPerSecond )
+{
+        m_RateLimit.SetRate ( PktsPerSecond );
+} // FG_SERVER::SetRateLimit ( int PktsPerSecond )
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the number of packets a single IP may send at once
+ */
+void
+FG_SERVER::SetRateBurst( int Pkts )
+{
+        m_RateLimit.SetBurst ( Pkts );
+} // FG_SERVER::SetRateBurst ( int Pkts )
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Blacklist an IP which exceeds the rate limit for Seconds
+ *        in a row, 0 never blacklists
+ */
+void
+FG_SERVER::SetRateEscalate( int Seconds )
+{
+        m_RateLimit.SetEscalate ( Seconds );
+} // FG_SERVER::SetRateEscalate ( int Seconds )
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the time an IP is blacklisted for exceeding the rate
+ *        limit the first time. It doubles with every repeated offence.
+ */
+void
+FG_SERVER::SetRateBlockTime( int Seconds )
+{
+        m_RateLimit.SetBlockTime ( Seconds );
+} // FG_SERVER::SetRateBlockTime ( int Seconds )
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the bytes per second sent to every relay for players
+ *        which no pilot behind the relay has in range.
+ * @param BytesPerSecond 0 = unlimited
+ * @see FG_RelayScheduler
+ */
+void
+FG_SERVER::SetRelayBudget( int BytesPerSecond )
+{
+        m_RelaySched.SetBudget ( BytesPerSecond );
+} // FG_SERVER::SetRelayBudget ( int BytesPerSecond )
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the distance bands limiting the packets per second
+ *        forwarded to local clients, eg. "10:0 40:10 100:2"
+ *        The workers use the bands, so they are changed under
+ *        m_PacketMutex.
+ * @param Bands an empty string forwards every packet
+ * @retval false if Bands is invalid
+ * @see FG_LodPolicy
+ */
+bool
+FG_SERVER::SetLodBands( const std::string& Bands )
+{
+        pthread_mutex_lock ( &m_PacketMutex );
+        bool Valid = m_Lod.SetBands ( Bands );
+        pthread_mutex_unlock ( &m_PacketMutex );
+        return Valid;
+} // FG_SERVER::SetLodBands ( const std::string& Bands )
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the maximum error of the orientation a client predicts
+ *        by dead reckoning, for LOD bands with an error
+ * @param Degrees 0 = only the position is checked
+ * @see FG_LodPolicy
+ */
+void
+FG_SERVER::SetReckonAngle( int Degrees )
+{
+        pthread_mutex_lock ( &m_PacketMutex );
+        m_Lod.SetAngle ( Degrees );
+        pthread_mutex_unlock ( &m_PacketMutex );
+} // FG_SERVER::SetReckonAngle ( int Degrees )
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the maximum time a client does not get a packet of a
+ *        sender, because it predicts the packets by dead reckoning
+ * @param Ms milliseconds
+ * @see FG_LodPolicy
+ */
+void
+FG_SERVER::SetReckonSilence( int Ms )
+{
+        pthread_mutex_lock ( &m_PacketMutex );
+        m_Lod.SetSilence ( Ms );
+        pthread_mutex_unlock ( &m_PacketMutex );
+} // FG_SERVER::SetReckonSilence ( int Ms )
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the distance bands limiting the properties forwarded
+ *        to local clients, eg. "20:* 60:100-199,10002 100:10002"
+ *        Changed under m_PacketMutex, like the LOD bands.
+ * @param Bands an empty string forwards all properties
+ * @retval false if Bands is invalid
+ * @see FG_PropertyFilter
+ */
+bool
+FG_SERVER::SetPropertyBands( const std::string& Bands )
+{
+        pthread_mutex_lock ( &m_PacketMutex );
+        bool Valid = m_PropertyFilter.SetBands ( Bands );
+        pthread_mutex_unlock ( &m_PacketMutex );
+        return Valid;
+} // FG_SERVER::SetPropertyBands ( const std::string& Bands )
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Forward position packets in ticks. Only the newest packet
+ *        of a player is forwarded with a tick, packets superseded
+ *        within a tick are dropped.
+ * @param TicksPerSecond 0 forwards every packet at once
+ */
+void
+FG_SERVER::SetTickRate( int TicksPerSecond )
+{
+        if ( TicksPerSecond < 0 )
+                TicksPerSecond = 0;
+        if ( TicksPerSecond > 1000 )
+                TicksPerSecond = 1000;
+        m_TickRate = TicksPerSecond;
+} // FG_SERVER::SetTickRate ( int TicksPerSecond )
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the number of packets queued for a receiver, while the
+ *        data socket can not send to it.
+ * @param Packets 0 drops packets which can not be sent at once
+ * @see FG_Egress
+ */
+void
+FG_SERVER::SetEgressQueue( int Packets )
+{
+        m_Egress.SetLimit ( Packets );
+} // FG_SERVER::SetEgressQueue ( int Packets )
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Start the worker threads. The main thread is worker 0 and
+ *        uses m_DataSocket.
+ */
+void
+FG_SERVER::StartWorkers()
+{
+        m_Workers.push_back ( new st_worker ( this, 0, m_DataSocket ) );
+#ifdef SO_REUSEPORT
+        for ( int i = 1; i < m_NumWorkers; i++ )
+        {
+                netSocket* Socket = new netSocket();
+                if ( Socket->open ( false ) == 0 )
+                {
+                        SG_LOG ( SG_FGMS, SG_ALERT, "FG_SERVER::StartWorkers() - "
+                          << "failed to create worker socket" );
+                        delete Socket;
+                        break;
+                }
+                Socket->setBlocking ( false );
+                Socket->setSockOpt ( SO_REUSEADDR, true );
+                Socket->setSockOpt ( SO_REUSEPORT, true );
+                if ( Socket->bind ( m_BindAddress.c_str(), m_ListenPort ) != 0 )
+                {
+                        SG_LOG ( SG_FGMS, SG_ALERT, "FG_SERVER::StartWorkers() - "
+                          << "failed to bind worker socket to port " << m_ListenPort );
+                        Socket->close ();
+                        delete Socket;
+                        break;
+                }
+                st_worker* Worker = new st_worker ( this, i, Socket );
+                m_Workers.push_back ( Worker );
+                pthread_create ( &Worker->Thread, NULL, &worker_helper, Worker );
+        }
+#endif
+        if ( m_Workers.size() > 1 )
+        {
+                SG_LOG ( SG_FGMS, SG_ALERT, "# using " << m_Workers.size()
+                  << " worker threads on port " << m_ListenPort );
+        }
+        StartTicker ();
+} // FG_SERVER::StartWorkers()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Stop all worker threads and close their sockets
+ */
+void
+FG_SERVER::StopWorkers()
+{
+        StopTicker ();
+        for ( size_t i = 1; i < m_Workers.size(); i++ )
+        {
+                m_Workers[i]->WantExit = true;
+        }
+        for ( size_t i = 0; i < m_Workers.size(); i++ )
+        {
+                if ( i > 0 )
+                {
+                        pthread_join ( m_Workers[i]->Thread, 0 );
+                        m_Workers[i]->Socket->close ();
+                        delete m_Workers[i]->Socket;
+                }
+                delete m_Workers[i];
+        }
+        m_Workers.clear ();
+} // FG_SERVER::StopWorkers()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Start the thread forwarding the position packets in tick
+ *        mode. It sends with m_DataSocket, so it must be stopped
+ *        before the socket is replaced, see Init().
+ */
+void
+FG_SERVER::StartTicker()
+{
+        if ( m_TickRate == 0 )
+        {
+                return;
+        }
+        m_Ticker = new st_worker ( this, -1, m_DataSocket );
+        pthread_create ( &m_Ticker->Thread, NULL, &ticker_helper, m_Ticker );
+        SG_LOG ( SG_FGMS, SG_ALERT, "# forwarding positions "
+          << m_TickRate << " times per second" );
+} // FG_SERVER::StartTicker()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Stop the tick thread
+ */
+void
+FG_SERVER::StopTicker()
+{
+        if ( m_Ticker == 0 )
+        {
+                return;
+        }
+        m_Ticker->WantExit = true;
+        pthread_join ( m_Ticker->Thread, 0 );
+        delete m_Ticker;
+        m_Ticker = 0;
+} // FG_SERVER::StopTicker()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Main loop of the tick thread. Ticks are started at a fixed
+ *        rate, a tick which is late starts at once, ticks missed
+ *        meanwhile are skipped.
+ */
+void*
+FG_SERVER::TickLoop( st_worker* Ticker )
+{
+        struct timespec Next;
+        struct timespec Now;
+        long            Period = 1000000000L / m_TickRate;
+
+        clock_gettime ( CLOCK_MONOTONIC, &Next );
+        while ( ( Ticker->WantExit == false ) && ( m_WantExit == false ) )
+        {
+                Next.tv_nsec += Period;
+                while ( Next.tv_nsec >= 1000000000L )
+                {
+                        Next.tv_nsec -= 1000000000L;
+                        Next.tv_sec++;
+                }
+                clock_gettime ( CLOCK_MONOTONIC, &Now );
+                if ( ( Now.tv_sec > Next.tv_sec )
+                ||   ( ( Now.tv_sec == Next.tv_sec ) && ( Now.tv_nsec > Next.tv_nsec ) ) )
+                {
+                        Next = Now;
+                }
+                else
+                {
+                        while ( clock_nanosleep ( CLOCK_MONOTONIC, TIMER_ABSTIME,
+                          &Next, 0 ) == EINTR )
+                                ;
+                }
+                Tick ( *Ticker );
+        }
+        return 0;
+} // FG_SERVER::TickLoop()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Main loop of a worker thread, only reads the data port.
+ */
+void*
+FG_SERVER::WorkerLoop( st_worker* Worker )
+{
+        FG_Reactor      Reactor;
+        netSocket*      Ready[1];
+
+        Reactor.Add ( Worker->Socket );
+        while ( ( Worker->WantExit == false ) && ( m_WantExit == false ) )
+        {
+                if ( Reactor.Wait ( 1000, Ready, 1 ) > 0 )
+                {
+                        ReadDataSocket ( *Worker );
+                }
+        }
+        return 0;
+} // FG_SERVER::WorkerLoop()
 
 //////////////////////////////////////////////////////////////////////
 /**
@@ -1922,6 +2977,13 @@ void
 FG_SERVER::SetOutOfReach( int OutOfReach)
 {
         m_PlayerIsOutOfReach = OutOfReach;
+        m_PlayerGrid.SetCellSize ( OutOfReach );
+        mT_RelayPlayersIt Relay = m_RelayPlayers.begin();
+        while ( Relay != m_RelayPlayers.end() )
+        {
+                Relay->second.SetCellSize ( OutOfReach );
+                Relay++;
+        }
 } // FG_SERVER::SetOutOfReach ( int iOutOfReach )
 //////////////////////////////////////////////////////////////////////
 
@@ -1959,6 +3021,8 @@ FG_SERVER::SetLogfile( const std::string& LogfileName )
 {
         m_LogFileName = LogfileName;
         SG_LOG ( SG_FGMS, SG_ALERT,"# using logfile " << m_LogFileName );
+        // the writer thread must not write to the file while it is reopened
+        bool Async = sglog().stop_async ();
         if ( m_LogFile.is_open() )
         {
                 m_LogFile.close ();
@@ -1966,6 +3030,10 @@ FG_SERVER::SetLogfile( const std::string& LogfileName )
         m_LogFile.open ( m_LogFileName.c_str(), std::ios::out|std::ios::app );
         sglog().enable_with_date ( true );
         sglog().set_output ( m_LogFile );
+        if ( Async )
+        {
+                sglog().start_async ();
+        }
 } // FG_SERVER::SetLogfile ( const std::string &LogfileName )
 //////////////////////////////////////////////////////////////////////
 
@@ -1980,6 +3048,24 @@ FG_SERVER::SetHub( bool IamHUB)
 } // FG_SERVER::SetHub ( int iLoglevel )
 //////////////////////////////////////////////////////////////////////
 
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Use batched I/O (recvmmsg/sendmmsg) on the data port.
+ *        Ignored if the platform does not support it.
+ */
+void
+FG_SERVER::SetBatchIO( bool BatchIO )
+{
+        if ( BatchIO && ! netSocket::hasBatchIO () )
+        {
+                SG_LOG ( SG_FGMS, SG_ALERT, "batched I/O is not supported "
+                  << "on this platform, using standard I/O" );
+                BatchIO = false;
+        }
+        m_BatchIO = BatchIO;
+} // FG_SERVER::SetBatchIO ( bool BatchIO )
+//////////////////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////////////////
 /**
  * @brief  Set the server name
@@ -2025,7 +3111,9 @@ FG_SERVER::Done()
                 return;
         }
         Show_Stats();   // 20150619:0.11.9: Add stats to the LOG on exit
+        StopWorkers ();
         SG_LOG ( SG_FGMS, SG_ALERT, "FG_SERVER::Done() - exiting" );
+        sglog().stop_async ();
         m_LogFile.close();
         if ( m_Listening == false )
         {
@@ -2051,6 +3139,8 @@ FG_SERVER::Done()
         }
         CloseTracker ();
         m_PlayerList.Unlock ();         m_PlayerList.Clear ();
+        m_PlayerGrid.Clear ();
+        m_RelayPlayers.clear ();
         m_RelayList.Unlock ();          m_RelayList.Clear ();
         m_CrossfeedList.Unlock ();      m_CrossfeedList.Clear ();
         m_BlackList.Unlock ();          m_BlackList.Clear ();
@@ -2067,7 +3157,7 @@ int
 FG_SERVER::UpdateTracker( const string& Name,const string& Passwd,const string& Modelname, const time_t Timestamp,const int type)
 {
         char            TimeStr[100];
-        FG_Player       CurrentPlayer;
+        PlayerList::Snapshot Players;
         Point3D         PlayerPosGeod;
         string          Aircraft;
         string          Message;
@@ -2141,64 +3231,66 @@ FG_SERVER::UpdateTracker( const string& Name,const string& Passwd,const string&
                 return ( 0 );
         }
         // we only arrive here if type!=CONNECT and !=DISCONNECT
-        Message = "";
-    float heading, pitch, roll;
-        size_t j=0; /*message count*/
-        for (size_t i = 0; i < m_PlayerList.Size(); i++)
-        {
-                CurrentPlayer = m_PlayerList[i];
+        float           heading, pitch, roll;
+        size_t          j = 0; /*message count*/
+        size_t          TimeLen = strlen ( TimeStr );
+        mT_TrackerReported Reported;
+        m_TrackerReport.clear (); // keeps its capacity
+        Players = m_PlayerList.GetSnapshot ();
+        for (size_t i = 0; i < Players->size(); i++)
+        {
+                const FG_Player& CurrentPlayer = (*Players)[i];
                 if (CurrentPlayer.ID == FG_ListElement::NONE_EXISTANT)
                         continue;
+                bool Report = ( CurrentPlayer.IsLocal && ( CurrentPlayer.HasErrors == false ) );
+                #ifdef TRACK_ALL
+                Report = Report || ( ! CurrentPlayer.IsLocal );
+                #endif
+                if ( ! Report )
+                        continue;
+                if ( m_TrackerDelta > 0 )
+                {       // only report players which moved far enough
+                        mT_TrackerReportedIt Last = m_TrackerReported.find ( CurrentPlayer.ID );
+                        if ( ( Last != m_TrackerReported.end() )
+                        &&   ( ( CurrentPlayer.LastPos - Last->second ).length() < m_TrackerDelta ) )
+                        {
+                                Reported.insert ( *Last );
+                                continue;
+                        }
+                        Reported[CurrentPlayer.ID] = CurrentPlayer.LastPos;
+                }
+                PlayerPosGeod = CurrentPlayer.GetGeodPos ();
                 euler_get(PlayerPosGeod[Lat], PlayerPosGeod[Lon],
                         CurrentPlayer.LastOrientation[X], CurrentPlayer.LastOrientation[Y], CurrentPlayer.LastOrientation[Z],
                         &heading, &pitch, &roll );
-                
-                if ((CurrentPlayer.IsLocal) && (CurrentPlayer.HasErrors == false))
-                {
-                        if(j!=0)
-                                Message += "\n";
-                        sgCartToGeod ( CurrentPlayer.LastPos, PlayerPosGeod );
-                        Message +=  "POSITION ";
-                        Message += CurrentPlayer.Name +" ";
-                        Message += CurrentPlayer.Passwd +" ";
-                        Message += NumToStr ( PlayerPosGeod[Lat], 6 ) +" "; //lat
-                        Message += NumToStr ( PlayerPosGeod[Lon], 6 ) +" "; //lon
-                        Message += NumToStr ( PlayerPosGeod[Alt], 6 ) +" "; //alt
-                        Message += NumToStr ( heading, 6 ) +" ";
-                        Message += NumToStr ( pitch,   6 ) +" ";
-                        Message += NumToStr ( roll,    6 ) +" ";
-                        Message += TimeStr;
-                        // queue the message
-                        j++;
-                }
-                #ifdef TRACK_ALL
-                if (!CurrentPlayer.IsLocal)
-                {
-                        if(j!=0)
-                                Message += "\n";
-                        sgCartToGeod ( CurrentPlayer.LastPos, PlayerPosGeod );
-                        Message +=  "POSITION ";
-                        Message += CurrentPlayer.Name +" ";
-                        Message += CurrentPlayer.Passwd +" ";
-                        Message += NumToStr ( PlayerPosGeod[Lat], 6 ) +" "; //lat
-                        Message += NumToStr ( PlayerPosGeod[Lon], 6 ) +" "; //lon
-                        Message += NumToStr ( PlayerPosGeod[Alt], 6 ) +" "; //alt
-                        Message += NumToStr ( heading, 6 ) +" ";
-                        Message += NumToStr ( pitch,   6 ) +" ";
-                        Message += NumToStr ( roll,    6 ) +" ";
-                        Message += TimeStr;
-                        // queue the message
-                        j++;
-                }
-                #endif
-        } // while
-        if( Message!= "" )
-        {       
-                m_Tracker->AddMessage (Message);
+                if ( j != 0 )
+                        m_TrackerReport += '\n';
+                m_TrackerReport += "POSITION ";
+                m_TrackerReport += CurrentPlayer.Name;
+                m_TrackerReport += ' ';
+                m_TrackerReport += CurrentPlayer.Passwd;
+                m_TrackerReport += ' ';
+                append_fixed ( m_TrackerReport, PlayerPosGeod[Lat], 6 ); //lat
+                m_TrackerReport += ' ';
+                append_fixed ( m_TrackerReport, PlayerPosGeod[Lon], 6 ); //lon
+                m_TrackerReport += ' ';
+                append_fixed ( m_TrackerReport, PlayerPosGeod[Alt], 6 ); //alt
+                m_TrackerReport += ' ';
+                append_fixed ( m_TrackerReport, heading, 6 );
+                m_TrackerReport += ' ';
+                append_fixed ( m_TrackerReport, pitch, 6 );
+                m_TrackerReport += ' ';
+                append_fixed ( m_TrackerReport, roll, 6 );
+                m_TrackerReport += ' ';
+                m_TrackerReport.append ( TimeStr, TimeLen );
+                j++;
+        }
+        m_TrackerReported.swap ( Reported );
+        if ( j != 0 )
+        {       // queue the message
+                m_Tracker->AddMessage (m_TrackerReport);
                 m_TrackerPosition++; // count a POSITION messge queued
         }
-
-        Message.erase ( 0 );
         return ( 0 );
 } // UpdateTracker (...)
 //////////////////////////////////////////////////////////////////////
@@ -2210,17 +3302,19 @@ FG_SERVER::UpdateTracker( const string& Name,const string& Passwd,const string&
 void
 FG_SERVER::CloseTracker()
 {
-        if ( m_IsTracked )
-        {
-                if ( m_Tracker )
-                {
-                        m_Tracker->WantExit = true;
-                        pthread_cond_signal ( &m_Tracker->condition_var );  // wake up the worker
-                        pthread_join (m_Tracker->GetThreadID(), 0);
-                }
-                m_Tracker = 0;
-                m_IsTracked = false;
-        }
+        if ( m_TrackerRunning )
+        {
+                pthread_mutex_lock ( &m_Tracker->msg_mutex );
+                m_Tracker->WantExit = true;
+                pthread_cond_signal ( &m_Tracker->condition_var );  // wake up the worker
+                pthread_mutex_unlock ( &m_Tracker->msg_mutex );
+                pthread_join ( m_TrackerThread, 0 );
+                m_TrackerRunning = false;
+        }
+        // the journal is closed by Loop(), the rest is saved here
+        delete m_Tracker;
+        m_Tracker = 0;
+        m_IsTracked = false;
 } // CloseTracker ( )
 //////////////////////////////////////////////////////////////////////
 
@@ -2272,7 +3366,7 @@ FG_SERVER::ReceiverWantsChat( const PlayerIt& Sender, const FG_Player& Receiver
         likely it is to work. 
         */
         float   out_of_reach;
-        float   altitude = Sender->GeodPos[Alt];
+        float   altitude = Sender->GetGeodPos()[Alt];
         if ( altitude < 1000.0 )
                 out_of_reach = 39.1;
         else if ( altitude < 2.000 )
@@ -2343,45 +3437,47 @@ FG_SERVER::ReceiverWantsChat( const PlayerIt& Sender, const FG_Player& Receiver
 
 //////////////////////////////////////////////////////////////////////
 /**
- * @brief Decide whether the relay is interested in full rate updates.
- * @see \ref server_out_of_reach config.
- * @param Relay
- * @param SendingPlayer
- * @retval true is within range
+ * @brief Return the players connected via a relay, create an empty
+ *        set if the relay has no players yet.
+ * @param Relay address of the relay
  */
-bool
-FG_SERVER::IsInRange( const FG_ListElement& Relay, const PlayerIt& SendingPlayer, uint32_t MsgId )
+FG_SpatialGrid&
+FG_SERVER::RelayPlayers( const netAddress& Relay )
 {
-        FG_Player CurrentPlayer;
-        size_t    Cnt;
+        uint64_t Key = RelayKey ( Relay );
+        mT_RelayPlayersIt Players = m_RelayPlayers.find ( Key );
+        if ( Players == m_RelayPlayers.end() )
+        {
+                Players = m_RelayPlayers.insert (
+                  mT_RelayPlayers::value_type ( Key, FG_SpatialGrid() ) ).first;
+                Players->second.SetCellSize ( m_PlayerIsOutOfReach );
+        }
+        return Players->second;
+} // FG_SERVER::RelayPlayers ( relay )
+//////////////////////////////////////////////////////////////////////
 
-        Cnt = m_PlayerList.Size ();
-        for (size_t i = 0; i < Cnt; i++)
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Remove a remote player from the set of its relay
+ * @param Player
+ */
+void
+FG_SERVER::DropRelayPlayer( const FG_Player& Player )
+{
+        if ( Player.IsLocal )
         {
-                CurrentPlayer = m_PlayerList[i];
-                if (CurrentPlayer.ID == FG_ListElement::NONE_EXISTANT)
-                        continue;
-                if ( CurrentPlayer.Address == Relay.Address )
-                {
-                        if ( MsgId == CHAT_MSG_ID )
-                        {       // apply 'radio' rules
-                                // if ( ReceiverWantsChat( SendingPlayer, CurrentPlayer ) )
-                                if ( ReceiverWantsData ( SendingPlayer, CurrentPlayer ) )
-                                {
-                                        return true;
-                                }
-                        }
-                        else
-                        {       // apply 'visibility' rules, for now we apply 'radio' rules
-                                if ( ReceiverWantsData( SendingPlayer, CurrentPlayer ) )
-                                {
-                                        return true;
-                                }
-                        }
-                        return false;
-                }
+                return;
         }
-        return false;
-} // FG_SERVER::IsInRange( relay, player )
+        mT_RelayPlayersIt Players = m_RelayPlayers.find ( RelayKey ( Player.Address ) );
+        if ( Players == m_RelayPlayers.end() )
+        {
+                return;
+        }
+        Players->second.Remove ( Player.ID );
+        if ( Players->second.Size() == 0 )
+        {
+                m_RelayPlayers.erase ( Players );
+        }
+} // FG_SERVER::DropRelayPlayer ( player )
 //////////////////////////////////////////////////////////////////////
 
@@ -26,25 +26,112 @@
 #if !defined FG_SERVER_HXX
 #define FG_SERVER_HXX
 
+#include <atomic>
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <unordered_map>
+#include <vector>
 #include <string>
 #include <string.h>
 #include <errno.h>
 #include <time.h>
 #include <stdint.h>
 #include <unistd.h>
+#include <signal.h>
 #include <pthread.h>
 #include <plib/netSocket.h>
 #include <flightgear/MultiPlayer/mpmessages.hxx>
 #include <flightgear/MultiPlayer/tiny_xdr.hxx>
 #include <simgear/debug/logstream.hxx>
 #include "daemon.hxx"
+#include "fg_blacklist.hxx"
+#include "fg_ratelimit.hxx"
+#include "fg_relaysched.hxx"
+#include "fg_lod.hxx"
+#include "fg_property.hxx"
+#include "fg_egress.hxx"
 #include "fg_geometry.hxx"
+#include "fg_grid.hxx"
 #include "fg_list.hxx"
+#include "fg_reactor.hxx"
 #include "fg_tracker.hxx"
 
+class FG_SERVER;
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief The fields of a packet the server works with
+ *
+ * A plain struct, decoded once per packet by Decode() into the slot
+ * of the worker which received the packet, so that no memory is
+ * allocated while a packet is processed. The callsign is kept as the
+ * fixed size (not necessarily terminated) buffer of the packet.
+ * The position and the motion are only valid if HasPosition is true.
+ */
+typedef struct st_player_state
+{
+	char		Callsign[MAX_CALLSIGN_LEN];
+	uint32_t	Magic;
+	uint32_t	MsgId;
+	uint32_t	MsgLen;
+	uint32_t	Version;
+	uint32_t	RadarRange;
+	bool		HasPosition;
+	double		Position[3];	// cartesian, meters
+	float		Orientation[3];
+	FG_Motion	Motion;		// for dead reckoning, see FG_LodPolicy
+	const char*	Model;		// points into the packet
+	/** decode the header (and position) of Msg */
+	void	Decode ( const char* Msg, int Bytes );
+	/** true if the callsign starts with 'obs' */
+	bool	IsObserver () const;
+} FG_PlayerState;
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief A thread reading the data port with its own socket
+ *
+ * Every worker has its own scratch lists, so that several workers
+ * can handle packets at the same time.
+ */
+typedef struct st_worker
+{
+	st_worker ( FG_SERVER* Server, int Number, netSocket* DataSocket )
+	{
+		Instance	= Server;
+		Index		= Number;
+		Socket		= DataSocket;
+		WantExit	= false;
+		PktsReceived	= 0;
+		PktsLastStats	= 0;
+		PktsRateLimited	= 0;
+		RateLimitedLastStats = 0;
+		Sender		= FG_Egress::NO_SENDER;
+		for ( int b = 0; b < FG_PropertyFilter::MAX_BANDS; b++ )
+			TrimmedBytes[b] = -1;
+	}
+	FG_SERVER*	Instance;
+	int		Index;
+	netSocket*	Socket;
+	pthread_t	Thread;
+	volatile bool	WantExit;
+	std::vector<size_t>	Receivers;	// candidates of m_PlayerGrid
+	std::vector<netAddress>	SendTo;		// local receivers of a packet
+	std::vector<netAddress>	RelayTo;	// relays receiving a packet
+	/** local receivers of the trimmed packet of a property band */
+	std::vector<netAddress>	TrimTo[FG_PropertyFilter::MAX_BANDS];
+	std::vector<char>	Trimmed[FG_PropertyFilter::MAX_BANDS];
+	int		TrimmedBytes[FG_PropertyFilter::MAX_BANDS]; // -1 = not yet
+	FG_PlayerState	State;		// the packet currently processed
+	size_t		Sender;		// the player of a position packet
+	// read by Show_Stats() in the main thread
+	std::atomic<size_t>	PktsReceived;
+	size_t		PktsLastStats;
+	std::atomic<size_t>	PktsRateLimited;	// dropped by m_RateLimit
+	size_t		RateLimitedLastStats;
+} st_worker;
+
 //////////////////////////////////////////////////////////////////////
 /**
  * @class FG_SERVER
@@ -70,10 +157,31 @@ public:
 
 		// other constants
 		MAX_PACKET_SIZE         = 1200, // to agree with FG multiplayermgr.cxx (since before  2008)
-		UPDATE_INACTIVE_PERIOD  = 1,
 		MAX_TELNETS             = 5,
+		RECV_BATCH              = 32,   // datagrams read at once (batch I/O)
 		RELAY_MAGIC             = 0x53464746    // GSGF
 	};
+	/** @brief results of PacketIsValid() */
+	enum FG_PACKET_ERRORS
+	{
+		PACKET_VALID,
+		PACKET_TOO_SMALL,
+		PACKET_BAD_MAGIC,
+		PACKET_BAD_VERSION,
+		PACKET_SHORT_POSITION
+	};
+	/** @brief periodic jobs of the main loop */
+	enum FG_SERVER_TIMERS
+	{
+		TIMER_EXPIRE_PLAYERS,
+		TIMER_PUBLISH_PLAYERS,
+		TIMER_EXPIRE_BLACKLIST,
+		TIMER_UPDATE_TRACKER,
+		TIMER_CHECK_FILES,
+		TIMER_EXPIRE_RATELIMIT,
+		TIMER_EXPIRE_LOD,
+		TIMER_EXPIRE_EGRESS
+	};
 	//////////////////////////////////////////////////
 	//
 	//  constructors
@@ -92,6 +200,7 @@ public:
 	void  Done ();
 
 	void  PrepareInit ();
+	void  RequestReinit ();
 	void  SetDataPort ( int Port );
 	void  SetTelnetPort ( int Port );
 	void  SetAdminPort ( int Port );
@@ -102,6 +211,19 @@ public:
 	void  SetOutOfReach ( int OutOfReach );
 	void  SetMaxRadarRange ( int MaxRange );
 	void  SetHub ( bool IamHUB );
+	void  SetBatchIO ( bool BatchIO );
+	void  SetWorkerThreads ( int NumWorkers );
+	void  SetRateLimit ( int PktsPerSecond );
+	void  SetRateBurst ( int Pkts );
+	void  SetRateEscalate ( int Seconds );
+	void  SetRateBlockTime ( int Seconds );
+	void  SetRelayBudget ( int BytesPerSecond );
+	bool  SetLodBands ( const std::string& Bands );
+	void  SetReckonAngle ( int Degrees );
+	void  SetReckonSilence ( int Ms );
+	bool  SetPropertyBands ( const std::string& Bands );
+	void  SetTickRate ( int TicksPerSecond );
+	void  SetEgressQueue ( int Packets );
 	void  SetLog ( int Facility, int Priority );
 	void  SetLogfile ( const std::string& LogfileName );
 	void  SetServerName ( const std::string& ServerName );
@@ -110,13 +232,20 @@ public:
 	void  AddRelay ( const string& Server, int Port );
 	void  AddCrossfeed ( const string& Server, int Port );
 	int   AddTracker ( const string& Server, int Port, bool IsTracked );
+	void  SetTrackerWindow ( int Window );
+	void  SetTrackerDelta ( int Meters );
+	void  SetTrackerBinary ( bool Binary );
+	void  SetTrackerJournal ( const std::string& Dir );
 	void  AddWhitelist  ( const string& DottedIP );
 	void  AddBlacklist  ( const string& DottedIP, const string& Reason, time_t Timeout = 10 );
+	void  UpdateExempt  ( const netAddress& Address );
 	void  CloseTracker ();
 	int   check_files();
 	void  Show_Stats ( void );
 	void* HandleTelnet  ( int Fd );
 	void* HandleAdmin  ( int Fd );
+	void* WorkerLoop  ( st_worker* Worker );
+	void* TickLoop  ( st_worker* Ticker );
 
 	//////////////////////////////////////////////////
 	//
@@ -134,10 +263,26 @@ protected:
 	//////////////////////////////////////////////////
 	typedef std::map<uint32_t,string>		mT_IP2Relay;
 	typedef std::map<uint32_t,string>::iterator	mT_RelayMapIt;
+	typedef std::map<uint64_t,FG_SpatialGrid>	mT_RelayPlayers;
+	typedef mT_RelayPlayers::iterator		mT_RelayPlayersIt;
+	typedef std::map<uint32_t,size_t>		mT_BadSenders;
+	typedef mT_BadSenders::iterator			mT_BadSendersIt;
+	typedef std::map<size_t,Point3D>		mT_TrackerReported;
+	typedef mT_TrackerReported::iterator		mT_TrackerReportedIt;
+	/** @brief the newest position packet of a player (tick mode) */
+	typedef struct
+	{
+		std::vector<char>	Msg;
+		int			Bytes;
+		bool			Fresh;	// not yet forwarded
+	} st_latest_state;
+	typedef std::unordered_map<size_t,st_latest_state> mT_LatestStates;
+	typedef mT_LatestStates::iterator		mT_LatestStatesIt;
 	bool		m_Initialized;
 	bool		m_ReinitData;
 	bool		m_ReinitTelnet;
 	bool		m_ReinitAdmin;
+	bool		m_ReinitReactor;
 	bool		m_Listening;
 	int		m_ListenPort;
 	int		m_TelnetPort;
@@ -167,15 +312,41 @@ protected:
 	mT_IP2Relay	m_RelayMap;
 	FG_List		m_CrossfeedList;
 	FG_List		m_WhiteList;
-	FG_List		m_BlackList;
+	FG_BlackList	m_BlackList;
+	FG_RateLimit	m_RateLimit;	// packets per source
 	FG_List		m_RelayList;
 	PlayerList	m_PlayerList;
+	FG_SpatialGrid	m_PlayerGrid;	// local players by position
+	mT_RelayPlayers	m_RelayPlayers;	// remote players by relay address
+	FG_RelayScheduler m_RelaySched;	// rate of updates sent to relays
+	FG_LodPolicy	m_Lod;		// rate of updates sent to local clients
+	FG_PropertyFilter m_PropertyFilter; // properties sent to local clients
+	FG_Egress	m_Egress;	// packets to congested receivers
+	mT_BadSenders	m_BadSenders;	// player ID of senders of bad packets
 	int		m_ipcid;
 	int		m_childpid;
 	FG_TRACKER*	m_Tracker;
+	pthread_t	m_TrackerThread;	// runs m_Tracker->Loop()
+	bool		m_TrackerRunning;
 	bool		m_IamHUB;
+	bool		m_BatchIO;	// use recvmmsg/sendmmsg
+	int		m_NumWorkers;	// threads reading the data port
+	std::vector<st_worker*>	m_Workers;	// m_Workers[0] is the main thread
+	int		m_TickRate;	// ticks per second, 0 = forward at once
+	st_worker*	m_Ticker;	// the thread forwarding the ticks
+	mT_LatestStates	m_LatestStates;	// by player ID
+	std::vector<size_t> m_TickPending;	// players with fresh states
+	std::vector<size_t> m_TickWork;		// the players of the current tick
+	pthread_mutex_t	m_PacketMutex;	// serializes packet processing
 	time_t		m_UpdateTrackerFreq;
+	size_t		m_TrackerWindow;	// unacknowledged tracker messages
+	double		m_TrackerDelta;		// meters moved until reported again
+	bool		m_TrackerBinary;	// offer binary framing to the tracker
+	std::string	m_TrackerJournal;	// directory of the tracker journal
+	string		m_TrackerReport;	// POSITION messages, reused
+	mT_TrackerReported m_TrackerReported;	// last reported positions
 	bool		m_WantExit;
+	volatile sig_atomic_t m_WantReinit;	// set by SIGHUP, see Loop()
 
 	//////////////////////////////////////////////////
 	bool    m_useExitFile, m_useResetFile, m_useStatFile; // 20150619:0.11.9: be able to disable these functions
@@ -187,7 +358,7 @@ protected:
 	size_t		m_PacketsReceived;	// rw data packet received
 	size_t		m_PingReceived;		// rw ping packets received
 	size_t		m_PongReceived;		// rw pong packets received
-	size_t		m_BlackRejected;	// in black list
+	std::atomic<size_t>	m_BlackRejected; // in black list, not under m_PacketMutex
 	size_t		m_PacketsInvalid;	// invalid packet
 	size_t		m_UnknownRelay;		// unknown relay
 	size_t		m_RelayMagic;		// known relay packet
@@ -198,32 +369,55 @@ protected:
 	size_t		mT_PacketsReceived, mT_BlackRejected, mT_PacketsInvalid;
 	size_t		mT_UnknownRelay, mT_PositionData, mT_TelnetReceived;
 	size_t		mT_RelayMagic, mT_UnkownMsgID;
-	size_t		m_CrossFeedFailed, m_CrossFeedSent;
+	std::atomic<size_t>	m_CrossFeedFailed, m_CrossFeedSent; // not under m_PacketMutex
 	size_t		mT_CrossFeedFailed, mT_CrossFeedSent;
+	size_t		mT_RateLimited;
+	size_t		m_LodLastStats, m_PredictedLastStats;
+	size_t		m_TrimmedLastStats;
+	size_t		m_TickForwarded, m_TickSuperseded;
+	size_t		mT_TickForwarded, mT_TickSuperseded;
 	size_t		m_TrackerConnect, m_TrackerDisconnect,m_TrackerPosition;
 	time_t		m_Uptime;
+	time_t		m_LastStats;
 
 	//////////////////////////////////////////////////
 	//
 	//  private methods
 	//
 	//////////////////////////////////////////////////
-	void  AddClient     ( const netAddress& Sender, char* Msg );
-	void  AddBadClient  ( const netAddress& Sender, string& ErrorMsg,
-	                      bool IsLocal, int Bytes );
+	void  AddClient     ( const netAddress& Sender, const FG_PlayerState& State );
+	void  AddBadClient  ( const netAddress& Sender, int Error,
+	                      const FG_PlayerState& State, bool IsLocal, int Bytes );
 	bool  IsKnownRelay ( const netAddress& SenderAddress, size_t Bytes );
-	bool  PacketIsValid ( int Bytes, T_MsgHdr* MsgHdr,
-	                      const netAddress& SenderAddress );
+	int   PacketIsValid ( int Bytes, const FG_PlayerState& State ) const;
+	string PacketErrorMsg ( int Error, const FG_PlayerState& State,
+	                      const netAddress& Sender ) const;
 	void  HandlePacket  ( char* sMsg, int Bytes,
-	                      const netAddress& SenderAdress );
+	                      const netAddress& SenderAdress, st_worker& Worker );
+	void  ProcessPacket ( char* sMsg, int Bytes,
+	                      const netAddress& SenderAdress, st_worker& Worker );
+	void  FanOut        ( char* Msg, int Bytes, PlayerIt& SendingPlayer, st_worker& Worker );
+	void  KeepLatest    ( const char* Msg, int Bytes, size_t ID );
+	void  Tick          ( st_worker& Ticker );
 	int   UpdateTracker ( const string& callsign, const string& passwd, const string& modelname,
 	                      const time_t time, const int type );
 	void  DropClient    ( PlayerIt& CurrentPlayer ); 
 	bool  ReceiverWantsData ( const PlayerIt& SenderPos, const FG_Player& Receiver );
 	bool  ReceiverWantsChat ( const PlayerIt& SenderPos, const FG_Player& Receiver );
-	bool  IsInRange     ( const FG_ListElement& Relay,  const PlayerIt& SendingPlayer, uint32_t MsgId );
-	void  SendToCrossfeed ( char* Msg, int Bytes, const netAddress& SenderAddress );
-	void  SendToRelays  ( char* Msg, int Bytes, PlayerIt& SendingPlayer );
+	FG_SpatialGrid& RelayPlayers ( const netAddress& Relay );
+	void  DropRelayPlayer ( const FG_Player& Player );
+	void  SendToCrossfeed ( char* Msg, int Bytes, const netAddress& SenderAddress, st_worker& Worker );
+	void  SendToRelays  ( char* Msg, int Bytes, PlayerIt& SendingPlayer, st_worker& Worker );
+	void  FlushSendTo   ( char* Msg, int Bytes, st_worker& Worker );
+	void  SendToAll     ( char* Msg, int Bytes, netSocket* Socket, std::vector<netAddress>& To, size_t Sender );
+	void  ReadDataSocket ( st_worker& Worker );
+	void  StartWorkers ();
+	void  StopWorkers ();
+	void  StartTicker ();
+	void  StopTicker ();
+	void  AcceptConnection ( netSocket* Listener, bool IsAdmin );
+	void  ExpirePlayers ();
+	void  ExpireBlacklist ();
 	void  WantExit ();
 }; // FG_SERVER
 
@@ -58,6 +58,9 @@
 #endif
 #include <unistd.h>
 #include <stdio.h>
+#ifndef _MSC_VER
+#include <poll.h>
+#endif
 #include "fg_common.hxx"
 #include "fg_tracker.hxx"
 #include "fg_util.hxx"
@@ -72,6 +75,8 @@
 int tracker_conn_secs = DEF_CONN_SECS;
 bool FG_TRACKER::m_connected = false;
 
+static uint64_t now_ms ();
+
 #if defined(_MSC_VER) || defined(__MINGW32__)
 /* windows work around for gettimeofday() */
 int gettimeofday(struct timeval* tp, void* tzp) 
@@ -92,6 +97,7 @@ int gettimeofday(struct timeval* tp, void* tzp)
  * @param fgms name
  */
 FG_TRACKER::FG_TRACKER ( int port, string server, string m_ServerName, string domain )
+	: msg_queue ( QUEUE_SIZE )
 {
 	m_TrackerPort	= port;
 	m_TrackerServer = server;
@@ -114,6 +120,19 @@ FG_TRACKER::FG_TRACKER ( int port, string server, string m_ServerName, string do
 	m_identified	= false;
 	m_PingInterval	= 55;
 	m_TimeoutStage	= 0;
+	m_OutPos	= 0;
+	m_Window	= DEF_WINDOW;
+	m_Waiting	= false;
+	m_Backlog	= 0;
+	MsgsDropped	= 0;
+	m_Connecting	= false;
+	m_ConnectStart	= 0;
+	m_NextConnect	= 0;
+	m_BackoffMs	= 0;
+	m_Binary	= false;
+	m_BinaryActive	= false;
+	pthread_mutex_init ( &msg_mutex, 0 );
+	pthread_cond_init  ( &condition_var, 0 );
 	set_connected ( false );
 } // FG_TRACKER()
 
@@ -122,10 +141,8 @@ FG_TRACKER::FG_TRACKER ( int port, string server, string m_ServerName, string do
 //////////////////////////////////////////////////////////////////////
 FG_TRACKER::~FG_TRACKER ()
 {
-	pthread_mutex_unlock ( &msg_mutex ); // give up the lock
-	pthread_mutex_unlock ( &msg_sent_mutex ); // give up the lock
 	WriteQueue ();
-	msg_queue.clear ();
+	msg_retry_queue.clear ();
 	msg_sent_queue.clear ();
 	msg_recv_queue.clear ();
 	if ( m_TrackerSocket )
@@ -146,12 +163,14 @@ FG_TRACKER::GetThreadID ()
 //////////////////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////////////////
-//FG_TRACKER::ReadQueue - Read message in file to cache
+//FG_TRACKER::ReadQueue - Read message in file to cache. With a journal
+//the file is only read once, to take over the backlog of a version
+//which did not use a journal.
 /////////////////////////////////////////////////////////////////////
 void
 FG_TRACKER::ReadQueue ()
 {	
-	/*Any message in msg_sent_queue must be pushed back to msg_queue before calling this function*/
+	/*Any message in msg_sent_queue must be pushed back to msg_retry_queue before calling this function*/
 	std::ifstream queue_file;
 	queue_file.open ( "queue_file" );
 	if ( ! queue_file )
@@ -160,14 +179,13 @@ FG_TRACKER::ReadQueue ()
 	}
 	string line_str("");
 	string Msg ("");
+	vMSG Backlog;
 	int line_cnt = 0;
 	while ( getline ( queue_file, line_str, '\n' ) )
 	{
 		if(line_cnt==25)
 		{
-			pthread_mutex_lock ( &msg_sent_mutex );	 // set the lock
-			msg_sent_queue.push_back ( Msg ); // queue the message
-			pthread_mutex_unlock ( &msg_sent_mutex );	 // give up the lock
+			Backlog.push_back ( Msg );
 			Msg="";
 			line_cnt=0;
 		}
@@ -175,11 +193,21 @@ FG_TRACKER::ReadQueue ()
 		Msg += line_str;
 		line_cnt++;
 	}
-	/*fire remaining message to msg_queue*/
-	pthread_mutex_lock ( &msg_sent_mutex );	 // set the lock
-	msg_sent_queue.push_back ( Msg ); // queue the message
-	pthread_mutex_unlock ( &msg_sent_mutex );	 // give up the lock
-	ReQueueSentMsg (); 
+	/*fire remaining message to msg_retry_queue*/
+	Backlog.push_back ( Msg );
+	if ( m_Journal.IsOpen () )
+	{
+		for ( size_t i = 0; i < Backlog.size(); i++ )
+		{
+			m_Journal.Append ( Backlog[i] );
+		}
+	}
+	else
+	{
+		/*the backlog is older than anything queued*/
+		msg_retry_queue.insert ( msg_retry_queue.begin(), Backlog.begin(), Backlog.end() );
+		m_Backlog = msg_retry_queue.size ();
+	}
 	queue_file.close();
 	remove ( "queue_file" );
 }
@@ -187,17 +215,26 @@ FG_TRACKER::ReadQueue ()
 
 //////////////////////////////////////////////////////////////////////
 //FG_TRACKER::WriteQueue () - Write cached message to a file (only be 
-//used when destructor of this object be called)
+//used when Loop() returns and by the destructor). With a journal the
+//queued messages are written to the journal instead, which is closed.
 //////////////////////////////////////////////////////////////////////
 void
 FG_TRACKER::WriteQueue ()
 {
-	VI CurrentMessage;
 	std::ofstream queue_file;
-	pthread_mutex_lock ( &msg_mutex ); // set the lock
-	if ( msg_queue.size() == 0 )
+	string Msg;
+	if ( m_Journal.IsOpen () )
+	{
+		Spool ();
+		m_Journal.Close ();
+		/*the sent messages are still in the journal*/
+		msg_sent_queue.clear ();
+		m_SentPos.clear ();
+		return;
+	}
+	ReQueueSentMsg ();
+	if ( msg_retry_queue.empty () && msg_queue.Empty () )
 	{
-		pthread_mutex_unlock ( &msg_mutex ); // give up the lock
 		return;
 	}
 	queue_file.open ( "queue_file", std::ios::out|std::ios::app );
@@ -205,53 +242,142 @@ FG_TRACKER::WriteQueue ()
 	{
 		SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::WriteQueue: "
 		            << "could not open queuefile!" );
-		pthread_mutex_unlock ( &msg_mutex ); // give up the lock
 		return;
 	}
-	CurrentMessage = msg_queue.begin(); // get first message
-	while ( CurrentMessage != msg_queue.end() )
+	for ( size_t i = 0; i < msg_retry_queue.size(); i++ )
+	{
+		queue_file << msg_retry_queue[i] << endl;
+	}
+	while ( msg_queue.Pop ( Msg ) )
 	{
-		queue_file << ( *CurrentMessage ) << endl;
-		CurrentMessage++;
+		queue_file << Msg << endl;
 	}
-	pthread_mutex_unlock ( &msg_mutex ); // give up the lock
 	queue_file.close ();
+	msg_retry_queue.clear ();
+	m_Backlog = 0;
 }
 //////////////////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////////////////
 //FG_TRACKER::ReQueueSentMsg () - Requeue the message in msg_sent_queue
-//to msg_queue
+//to msg_retry_queue, they are sent again before msg_queue. With a
+//journal, the journal is read again from the last acknowledged message.
 //////////////////////////////////////////////////////////////////////
 void
 FG_TRACKER::ReQueueSentMsg ()
 {
-	pthread_mutex_lock ( &msg_mutex );
-	pthread_mutex_lock ( &msg_sent_mutex );
-	while (msg_sent_queue.begin()!=msg_sent_queue.end())
+	if ( m_Journal.IsOpen () )
 	{
-		msg_queue.insert ( msg_queue.begin() , msg_sent_queue.back() );// requeue message at the beginning of queue
-		msg_sent_queue.pop_back();
+		m_Journal.Rewind ();
+		m_SentPos.clear ();
+	}
+	else
+	{
+		msg_retry_queue.insert ( msg_retry_queue.begin(),
+		  msg_sent_queue.begin(), msg_sent_queue.end() );
+		m_Backlog = msg_retry_queue.size ();
+	}
+	msg_sent_queue.clear ();
+	/*a partly written batch is sent again as a whole*/
+	m_OutBuf.clear ();
+	m_OutPos = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+//FG_TRACKER::Spool - Move the messages of msg_queue to the journal. If
+//the journal is full, the messages are dropped.
+//////////////////////////////////////////////////////////////////////
+void
+FG_TRACKER::Spool ()
+{
+	string Msg;
+	if ( ! m_Journal.IsOpen () )
+	{
+		return;
+	}
+	while ( msg_queue.Pop ( Msg ) )
+	{
+		if ( ( ! m_Journal.Append ( Msg ) ) && ( ( MsgsDropped++ % 1000 ) == 0 ) )
+		{
+			SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::Spool: "
+			  << "journal is full, " << MsgsDropped << " messages dropped" );
+		}
 	}
-	pthread_cond_signal ( &condition_var );  // wake up the worker
-	pthread_mutex_unlock ( &msg_sent_mutex );
-	pthread_mutex_unlock ( &msg_mutex );
 }
+//////////////////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////////////////
 //FG_TRACKER::AddMessage - add feedin message to last position of 
-//cache. fg_server.cxx use this to insert messages
+//cache. fg_server.cxx use this to insert messages. Thread safe and
+//lock free, if the queue is full the message is dropped.
 /////////////////////////////////////////////////////////////////////
 void
 FG_TRACKER::AddMessage( const string& message )
 {
-	pthread_mutex_lock ( &msg_mutex ); // acquire the lock
-	msg_queue.push_back ( message ); // queue the message at the end of queue
-	pthread_cond_signal ( &condition_var );  // wake up the worker
-	pthread_mutex_unlock ( &msg_mutex );	 // give up the lock
+	if ( ! msg_queue.Push ( message ) )
+	{
+		if ( ( MsgsDropped++ % 1000 ) == 0 )
+		{
+			SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::AddMessage: "
+			  << "queue is full, " << MsgsDropped << " messages dropped" );
+		}
+		return;
+	}
+	/*see Wait()*/
+	std::atomic_thread_fence ( std::memory_order_seq_cst );
+	if ( m_Waiting.load ( std::memory_order_relaxed ) )
+	{
+		pthread_mutex_lock ( &msg_mutex );
+		pthread_cond_signal ( &condition_var );  // wake up the worker
+		pthread_mutex_unlock ( &msg_mutex );
+	}
 } // FG_TRACKER::AddMessage()
 //////////////////////////////////////////////////////////////////////
 
+//////////////////////////////////////////////////////////////////////
+//FG_TRACKER::SetWindow - set the number of messages which may be sent
+//before FGTracker acknowledged them
+/////////////////////////////////////////////////////////////////////
+void
+FG_TRACKER::SetWindow( size_t Window )
+{
+	m_Window = ( Window < 1 ) ? 1 : Window;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//FG_TRACKER::SetBinary - offer binary framing to FGTracker on the next
+//connect. The text protocol is used if FGTracker does not accept it.
+/////////////////////////////////////////////////////////////////////
+void
+FG_TRACKER::SetBinary( bool Binary )
+{
+	m_Binary = Binary;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//FG_TRACKER::SetJournal - keep the messages in a journal in directory
+//Dir until FGTracker acknowledged them. Without a journal, they are
+//kept in memory and written to queue_file when fgms stops.
+/////////////////////////////////////////////////////////////////////
+void
+FG_TRACKER::SetJournal( const string& Dir )
+{
+	m_JournalDir = Dir;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//FG_TRACKER::QueueSize - number of messages waiting to be sent
+/////////////////////////////////////////////////////////////////////
+size_t
+FG_TRACKER::QueueSize() const
+{
+	return msg_queue.Size () + m_Backlog.load () + m_Journal.Unread ();
+}
+//////////////////////////////////////////////////////////////////////
+
 //////////////////////////////////////////////////////////////////////
 //FG_TRACKER::buffsock_free - Reset the non-data part of 
 //socket read buffer
@@ -269,7 +395,10 @@ FG_TRACKER::buffsock_free(buffsock_t* bs)
 void
 FG_TRACKER::CheckTimeout()
 {
-	
+	if ( ! is_connected () )
+	{	/*lost already, eg. by TrackerRead()*/
+		return;
+	}
 	time_t curtime = time ( 0 );
 	double seconds;
 	seconds = difftime( curtime, LastSeen );
@@ -278,8 +407,7 @@ FG_TRACKER::CheckTimeout()
 		m_TimeoutStage++;
 		if(m_TimeoutStage>3)
 		{
-			set_connected ( false );
-			LostConnections++;
+			LostConnection ();
 			SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::CheckTimeout: No data received from FGTracker for "
 				<< seconds << " seconds. Lost connection to FGTracker" );
 			return;
@@ -317,8 +445,7 @@ FG_TRACKER::TrackerRead (buffsock_t* bs)
 		EINTR (sth hard to explain - Linux only)*/
 		if ( ( errno != EAGAIN ) && ( errno != EWOULDBLOCK ) && ( errno != EINTR ) )
 		{
-			set_connected ( false );
-			LostConnections++;
+			LostConnection ();
 			SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::TrackerRead: "
 			            << "lost connection to FGTracker" );
 		}
@@ -362,47 +489,323 @@ FG_TRACKER::TrackerRead (buffsock_t* bs)
 //////////////////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////////////////
-//FG_TRACKER::TrackerWrite - Write a feedin string to TCP stream
+//FG_TRACKER::TrackerWrite - Write a control message (version header,
+//PING, PONG, ERROR) to TCP stream. It is not acknowledged by FGTracker,
+//so it is not put to msg_sent_queue.
 /////////////////////////////////////////////////////////////////////
 int
 FG_TRACKER::TrackerWrite ( const string& str )
 {
-	size_t l   = str.size() + 1;
-	LastSent   = time ( 0 );
-	errno      = 0;
-	size_t s   = -1;
-
-	s = m_TrackerSocket->write_str ( str.c_str(), l );
-	if ( s != l )
+	m_OutBuf.append ( str.c_str(), str.size() + 1 );
+	PktsSent++;
+	if ( Flush () < 0 )
 	{
-		set_connected ( false );
-		LostConnections++;
-		SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::TrackerWrite: "
-					<< "lost connection to server"
-				  );
 		return -1;
 	}
+	return str.size() + 1;
+}
+//////////////////////////////////////////////////////////////////////
 
-	/*put the sent message to msg_sent_queue*/
-	size_t pos = str.find( m_ProtocolVersion );
-	size_t pos2 = str.find( "ERROR" );
-	if ( pos == 1 )
-	{} else if ( pos2 == 0 )
-	{} else if( str == "PING" )
-	{} else if( str == "PONG" )
-	{} else
-	{
-		pthread_mutex_lock ( &msg_sent_mutex );
-		msg_sent_queue.push_back( str );
-		pthread_mutex_unlock ( &msg_sent_mutex );
-	}
-	std::stringstream debug;
-	debug <<"DEBUG last_msg.size=" << l <<", msg_queue.size = " << msg_queue.size() << ", msg_sent_queue.size = "  << msg_sent_queue.size();
-	l= debug.str().size() + 1;
-	m_TrackerSocket->write_str ( debug.str().c_str(), l );
-	BytesSent += s;
-	PktsSent++;
-	return s;
+//////////////////////////////////////////////////////////////////////
+//FG_TRACKER::Flush - Write as much of m_OutBuf as the socket takes.
+//RETURN: number of bytes written, -1 if the connection is lost
+/////////////////////////////////////////////////////////////////////
+int
+FG_TRACKER::Flush ()
+{
+	int written = 0;
+	while ( m_OutPos < m_OutBuf.size() )
+	{
+		errno = 0;
+		int s = m_TrackerSocket->send ( m_OutBuf.data() + m_OutPos,
+		  m_OutBuf.size() - m_OutPos, MSG_NOSIGNAL );
+		if ( s < 0 )
+		{
+			if ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) || ( errno == EINTR ) )
+			{	/*socket buffer is full, write the rest later*/
+				break;
+			}
+			LostConnection ();
+			SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::Flush: "
+						<< "lost connection to server"
+					  );
+			return -1;
+		}
+		m_OutPos  += s;
+		written   += s;
+		BytesSent += s;
+		LastSent   = time ( 0 );
+	}
+	if ( m_OutPos == m_OutBuf.size() )
+	{
+		m_OutBuf.clear ();
+		m_OutPos = 0;
+	}
+	return written;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//FG_TRACKER::SendQueue - Send queued messages, as many as the window
+//allows. The messages are put into m_OutBuf and written with as few
+//send() calls as possible.
+/////////////////////////////////////////////////////////////////////
+void
+FG_TRACKER::SendQueue ()
+{
+	string Msg;
+	while ( is_connected() && m_identified && ( m_OutPos == m_OutBuf.size() ) )
+	{
+		size_t Batch = 0;
+		while ( ( msg_sent_queue.size() < m_Window ) && ( m_OutBuf.size() < MAX_BATCH ) )
+		{
+			if ( m_Journal.IsOpen () )
+			{
+				FG_Journal::Position Next;
+				if ( ! m_Journal.Read ( Msg, Next ) )
+				{
+					break;
+				}
+				m_SentPos.push_back ( Next );
+			}
+			else if ( ! msg_retry_queue.empty () )
+			{
+				Msg.swap ( msg_retry_queue.front () );
+				msg_retry_queue.pop_front ();
+				m_Backlog = msg_retry_queue.size ();
+			}
+			else if ( ! msg_queue.Pop ( Msg ) )
+			{
+				break;
+			}
+#ifdef ADD_TRACKER_LOG
+			write_msg_log ( Msg.c_str(), Msg.size(), ( char* ) "OUT: " );
+#endif // #ifdef ADD_TRACKER_LOG
+			SG_LOG ( SG_FGTRACKER, SG_DEBUG, "# FG_TRACKER::SendQueue: "
+			            << "sending msg " << Msg.size() << "  bytes: " << Msg
+			          );
+			if ( m_BinaryActive )
+			{
+				EncodeMessage ( Msg );
+			}
+			else
+			{
+				m_OutBuf.append ( Msg.c_str(), Msg.size() + 1 );
+			}
+			msg_sent_queue.push_back ( Msg );
+			PktsSent++;
+			Batch++;
+		}
+		if ( Batch == 0 )
+		{
+			break;
+		}
+		std::stringstream debug;
+		debug <<"DEBUG last_msg.size=" << Msg.size() + 1 <<", msg_queue.size = " << QueueSize() << ", msg_sent_queue.size = "  << msg_sent_queue.size();
+		m_OutBuf.append ( debug.str().c_str(), debug.str().size() + 1 );
+		if ( Flush () < 0 )
+		{
+			break;
+		}
+	}
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//  Helpers of the binary framing, all numbers are in network byte order
+//////////////////////////////////////////////////////////////////////
+static inline void
+put_u16 ( string& Buf, uint16_t V )
+{
+	Buf += ( char ) ( V >> 8 );
+	Buf += ( char ) V;
+}
+
+static inline void
+put_u32 ( string& Buf, uint32_t V )
+{
+	Buf += ( char ) ( V >> 24 );
+	Buf += ( char ) ( V >> 16 );
+	Buf += ( char ) ( V >> 8 );
+	Buf += ( char ) V;
+}
+
+/*parse a fixed point number with Scale units per 1, false if invalid*/
+static bool
+get_fixed ( const string& Token, double Scale, int32_t& V )
+{
+	char* End;
+	double D = strtod ( Token.c_str(), &End );
+	if ( ( End == Token.c_str() ) || ( *End != 0 ) )
+		return false;
+	D *= Scale;
+	if ( ! ( D > -2147483647.0 && D < 2147483647.0 ) )
+		return false;
+	V = ( int32_t ) ( D < 0 ? D - 0.5 : D + 0.5 );
+	return true;
+}
+
+/*seconds since the epoch of "YYYY-MM-DD HH:MM:SS" (UTC)*/
+static bool
+get_utc ( const string& Date, const string& Time, uint32_t& T )
+{
+	int Y, M, D, h, m, s;
+	if ( ( sscanf ( Date.c_str(), "%d-%d-%d", &Y, &M, &D ) != 3 )
+	||   ( sscanf ( Time.c_str(), "%d:%d:%d", &h, &m, &s ) != 3 )
+	||   ( Y < 1970 ) || ( M < 1 ) || ( M > 12 ) )
+		return false;
+	/*days since 1970-01-01 of a date of the gregorian calendar*/
+	Y -= ( M <= 2 );
+	long Era = Y / 400;
+	long YoE = Y - Era * 400;
+	long DoY = ( 153 * ( M > 2 ? M - 3 : M + 9 ) + 2 ) / 5 + D - 1;
+	long DoE = YoE * 365 + YoE / 4 - YoE / 100 + DoY;
+	long Days = Era * 146097 + DoE - 719468;
+	T = ( uint32_t ) ( Days * 86400 + h * 3600 + m * 60 + s );
+	return true;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//FG_TRACKER::EncodeMessage - Append a message to m_OutBuf as a binary
+//frame. A frame is FRAME_MARK, the length of the payload (uint32) and
+//the payload, which holds a record for every line of the message. A
+//record is its type (uint8), the length of its body (uint16) and the
+//body. The frame is acknowledged with a single OK, like the message.
+/////////////////////////////////////////////////////////////////////
+void
+FG_TRACKER::EncodeMessage ( const string& Msg )
+{
+	size_t Start = m_OutBuf.size();
+	m_OutBuf += ( char ) FRAME_MARK;
+	put_u32 ( m_OutBuf, 0 );	/*set below*/
+	size_t Pos = 0;
+	while ( Pos < Msg.size() )
+	{
+		size_t End = Msg.find ( '\n', Pos );
+		if ( End == string::npos )
+			End = Msg.size();
+		if ( End > Pos )
+			EncodeRecord ( Msg.data() + Pos, End - Pos );
+		Pos = End + 1;
+	}
+	uint32_t Len = m_OutBuf.size() - Start - 5;
+	m_OutBuf[Start + 1] = ( char ) ( Len >> 24 );
+	m_OutBuf[Start + 2] = ( char ) ( Len >> 16 );
+	m_OutBuf[Start + 3] = ( char ) ( Len >> 8 );
+	m_OutBuf[Start + 4] = ( char ) Len;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//FG_TRACKER::EncodeRecord - Append a line of a message as a record.
+//The body of a REC_POSITION record is
+//	int32	lat, lon in 1/1000000 degrees
+//	int32	alt in mm
+//	int32	heading, pitch, roll in 1/1000000 degrees
+//	uint32	time in seconds since the epoch
+//	uint8	length of the name, name
+//	uint8	length of the password, password
+//Any other line is sent as a REC_TEXT record.
+/////////////////////////////////////////////////////////////////////
+void
+FG_TRACKER::EncodeRecord ( const char* Line, size_t Len )
+{
+	static const char Position[] = "POSITION ";
+	if ( ( Len > sizeof ( Position ) - 1 )
+	&&   ( memcmp ( Line, Position, sizeof ( Position ) - 1 ) == 0 ) )
+	{
+		/*POSITION name passwd lat lon alt heading pitch roll date time*/
+		string	Token[11];
+		size_t	n = 0;
+		size_t	i = 0;
+		while ( ( i < Len ) && ( n < 11 ) )
+		{
+			size_t j = i;
+			while ( ( j < Len ) && ( Line[j] != ' ' ) )
+				j++;
+			Token[n++].assign ( Line + i, j - i );
+			i = j + 1;
+		}
+		int32_t		Fixed[6];
+		uint32_t	T;
+		bool Valid = ( n == 11 ) && ( i >= Len )
+		  && ( Token[1].size() < 256 ) && ( Token[2].size() < 256 )
+		  && get_fixed ( Token[3], 1e6, Fixed[0] )
+		  && get_fixed ( Token[4], 1e6, Fixed[1] )
+		  && get_fixed ( Token[5], 1e3, Fixed[2] )
+		  && get_fixed ( Token[6], 1e6, Fixed[3] )
+		  && get_fixed ( Token[7], 1e6, Fixed[4] )
+		  && get_fixed ( Token[8], 1e6, Fixed[5] )
+		  && get_utc ( Token[9], Token[10], T );
+		if ( Valid )
+		{
+			m_OutBuf += ( char ) REC_POSITION;
+			put_u16 ( m_OutBuf, 28 + 2 + Token[1].size() + Token[2].size() );
+			for ( int k = 0; k < 6; k++ )
+				put_u32 ( m_OutBuf, ( uint32_t ) Fixed[k] );
+			put_u32 ( m_OutBuf, T );
+			m_OutBuf += ( char ) Token[1].size();
+			m_OutBuf += Token[1];
+			m_OutBuf += ( char ) Token[2].size();
+			m_OutBuf += Token[2];
+			return;
+		}
+	}
+	if ( Len > 65535 )
+	{	/*never happens, lines are much shorter*/
+		Len = 65535;
+	}
+	m_OutBuf += ( char ) REC_TEXT;
+	put_u16 ( m_OutBuf, Len );
+	m_OutBuf.append ( Line, Len );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+//FG_TRACKER::Wait - Wait until there is something to do. If messages
+//are waiting for the socket or for acknowledgements, wait for the
+//socket. Otherwise wait for new messages (1 sec at most). Without a
+//connection, Loop() waits in WaitReconnect() instead.
+/////////////////////////////////////////////////////////////////////
+void
+FG_TRACKER::Wait ()
+{
+	if ( ! is_connected () )
+	{
+		return;
+	}
+	bool Pending = ( m_OutPos < m_OutBuf.size() );
+	bool HasWork = ( ! msg_retry_queue.empty () ) || ( ! msg_queue.Empty () )
+	  || ( m_Journal.Unread () != 0 );
+	if ( is_connected() && ( Pending || HasWork || ! msg_sent_queue.empty () ) )
+	{
+#ifndef _MSC_VER
+		struct pollfd P;
+		P.fd      = m_TrackerSocket->getHandle ();
+		P.events  = POLLIN | ( Pending ? POLLOUT : 0 );
+		P.revents = 0;
+		poll ( &P, 1, ( Pending || HasWork ) ? 100 : 1000 );
+#else
+		usleep ( 10000 );
+#endif
+		return;
+	}
+	struct timeval now;
+	struct timespec timeout;
+	gettimeofday(&now, 0);
+	timeout.tv_sec  = now.tv_sec + 1;
+	timeout.tv_nsec = now.tv_usec * 1000;
+	pthread_mutex_lock ( &msg_mutex );
+	m_Waiting.store ( true, std::memory_order_relaxed );
+	/*pairs with the fence in AddMessage(), one of both sees the other*/
+	std::atomic_thread_fence ( std::memory_order_seq_cst );
+	if ( msg_queue.Empty () && ! WantExit )
+	{
+		pthread_cond_timedwait ( &condition_var, &msg_mutex, &timeout );
+	}
+	m_Waiting.store ( false, std::memory_order_relaxed );
+	pthread_mutex_unlock ( &msg_mutex );
 }
 //////////////////////////////////////////////////////////////////////
 
@@ -424,12 +827,21 @@ FG_TRACKER::ReplyFromServer ()
 		if ( pos_ident == 0 )
 		{
 			m_identified=true;
+			m_BackoffMs=0;	/*the connection is good*/
+		}else if ( str == "BINARY 1" )
+		{
+			m_BinaryActive = m_Binary;
+			SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::ReplyFromServer: "
+						<< "FGTracker accepted binary framing" );
 		}else if ( str == "OK" )
 		{
-			pthread_mutex_lock ( &msg_sent_mutex ); // acquire the lock
-			if ( msg_sent_queue.begin() != msg_sent_queue.end() )
-				msg_sent_queue.erase ( msg_sent_queue.begin() );
-			pthread_mutex_unlock ( &msg_sent_mutex );	 // give up the lock
+			if ( ! msg_sent_queue.empty () )
+				msg_sent_queue.pop_front ();
+			if ( ! m_SentPos.empty () )
+			{
+				m_Journal.Ack ( m_SentPos.front () );
+				m_SentPos.pop_front ();
+			}
 		}
 		else if ( str == "PING" )
 		{
@@ -473,11 +885,6 @@ FG_TRACKER::ReplyFromServer ()
 int
 FG_TRACKER::Loop ()
 {
-	string	Msg;
-	pthread_mutex_init ( &msg_mutex, 0 );
-	pthread_mutex_init ( &msg_sent_mutex, 0 );
-	pthread_mutex_init ( &msg_recv_mutex, 0 );
-	pthread_cond_init  ( &condition_var, 0 );
 	MyThreadID = pthread_self();
 	
 	/*Initialize socket read buffer*/
@@ -495,98 +902,80 @@ FG_TRACKER::Loop ()
 		    << "started, thread ID " << MyThreadID
 		    );
 #endif
+	if ( ( m_JournalDir != "" ) && m_Journal.Open ( m_JournalDir ) )
+	{
+		ReadQueue ();	/*backlog of an older version, if any*/
+	}
 	/*Infinite loop*/
 	while ( ! WantExit )
 	{
+		Spool ();
 		if (! is_connected())
 		{
-			/*requeue the outstanding message to message queue*/
-			ReQueueSentMsg ();
-			
-			/*Reset Socket Read Buffer*/
-			bs.curlen=0;
-			buffsock_free(&bs);
-			
-			m_identified=false;
-			SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::Loop: "
-			            << "trying to connect to FGTracker"
-			          );
-			set_connected ( Connect() );
-			if ( ! is_connected() )
+			if ( ! m_Connecting )
 			{
+				if ( now_ms () < m_NextConnect )
+				{
+					WaitReconnect ();
+					continue;
+				}
+				/*requeue the outstanding message to message queue*/
+				ReQueueSentMsg ();
+				
+				/*Reset Socket Read Buffer*/
+				bs.curlen=0;
+				buffsock_free(&bs);
+				
+				m_identified=false;
 				SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::Loop: "
-				            << "not connected, will sleep for " << tracker_conn_secs << " seconds"
+				            << "trying to connect to FGTracker"
 				          );
-				struct timeval now;
-				struct timespec timeout;
-				gettimeofday(&now, 0);
-				timeout.tv_sec  = now.tv_sec + tracker_conn_secs;
-				timeout.tv_nsec = now.tv_usec * 1000;
-				pthread_mutex_lock ( &msg_mutex );
-				pthread_cond_timedwait ( &condition_var, &msg_mutex, &timeout );
-				pthread_mutex_unlock ( &msg_mutex );
+				if ( ! Connect () )
+				{
+					ScheduleReconnect ();
+					continue;
+				}
+			}
+			int Result = CheckConnect ( 100 );
+			if ( Result == 0 )
+			{	/*still connecting*/
+				continue;
+			}
+			m_Connecting = false;
+			if ( Result < 0 )
+			{
+				ScheduleReconnect ();
 				continue;
 			}
+			set_connected ( true );
+			Handshake ();
 			m_TimeoutStage = 0;
-			ReadQueue (); 	// read backlog, if any
-		}
-
-		if ( !msg_queue.size ())
-		{
-			// wait for data (1 sec at most)
-			struct timeval now;
-			struct timespec timeout;
-			gettimeofday(&now, 0);
-			timeout.tv_sec  = now.tv_sec + 1;
-			timeout.tv_nsec = now.tv_usec * 1000;
-			pthread_mutex_lock ( &msg_mutex );	
-			pthread_cond_timedwait ( &condition_var, &msg_mutex, &timeout );
-			pthread_mutex_unlock ( &msg_mutex );
-		} 
-        else
-        {
-            usleep(10000);
-        }
-
-		while ( msg_queue.size () && is_connected() && m_identified && msg_sent_queue.size() < 25)
-		{
-			/*Get message from msg_queue*/
-			Msg = "";
-			pthread_mutex_lock ( &msg_mutex );
-			Msg = msg_queue.front();
-			msg_queue.erase ( msg_queue.begin() );
-			pthread_mutex_unlock ( &msg_mutex );
-			
-			
-#ifdef ADD_TRACKER_LOG
-			write_msg_log ( Msg.c_str(), Msg.size(), ( char* ) "OUT: " );
-#endif // #ifdef ADD_TRACKER_LOG
-			SG_LOG ( SG_FGTRACKER, SG_DEBUG, "# FG_TRACKER::Loop: "
-			            << "sending msg " << Msg.size() << "  bytes: " << Msg
-			          );
-			if ( TrackerWrite ( Msg ) < 0 )
+			if ( ! m_Journal.IsOpen () )
 			{
-				pthread_mutex_lock ( &msg_mutex );
-				msg_queue.insert ( msg_queue.begin() , Msg );// requeue message at the beginning of queue
-				pthread_cond_signal ( &condition_var );  // wake up the worker
-				pthread_mutex_unlock ( &msg_mutex );
-				break;
+				ReadQueue (); 	// read backlog, if any
 			}
-			
-			TrackerRead (&bs);	
 		}
-
-		TrackerRead (&bs); /*usually read PING*/
+		if ( m_OutPos < m_OutBuf.size() )
+		{	/*rest of the last batch*/
+			Flush ();
+		}
+		SendQueue ();
+		TrackerRead (&bs); /*OK, PING and IDENTIFIED*/
 		CheckTimeout();
+		Wait ();
 	}
+	/*keep what is not acknowledged for the next start*/
+	WriteQueue ();
+	free ( bs.buf );
 	return ( 0 );
 } // Loop ()
 //////////////////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////////////////
 //
-//  (Re)connect the tracker to its server
-//	RETURN: true = success, false = failed
+//  (Re)connect the tracker to its server. The connect is not blocking,
+//  CheckConnect() tells when it is done.
+//	RETURN: true = connect started, false = failed
 //
 //////////////////////////////////////////////////////////////////////
 bool
@@ -610,22 +999,84 @@ FG_TRACKER::Connect()
 		m_TrackerSocket = 0;
 		return false;
 	}
-	if ( m_TrackerSocket->connect ( m_TrackerServer.c_str(), m_TrackerPort ) < 0 )
+	m_TrackerSocket->setBlocking ( false );
+	errno = 0;
+	if ( ( m_TrackerSocket->connect ( m_TrackerServer.c_str(), m_TrackerPort ) < 0 )
+	&&   ( errno != EINPROGRESS ) && ( errno != EWOULDBLOCK ) && ( errno != EINTR ) )
 	{
 		SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::Connect: "
-		            << "Connect failed!"
+		            << "Connect failed! " << strerror ( errno )
 		          );
 		delete m_TrackerSocket;
 		m_TrackerSocket = 0;
 		return false;
 	}
-	m_TrackerSocket->setBlocking ( false );
+	m_Connecting   = true;
+	m_ConnectStart = now_ms ();
+	return true;
+} // Connect ()
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Wait at most Timeout milliseconds for a pending connect
+//	RETURN: 1 = connected, 0 = still connecting, -1 = failed
+//
+//////////////////////////////////////////////////////////////////////
+int
+FG_TRACKER::CheckConnect( int Timeout )
+{
+#ifndef _MSC_VER
+	struct pollfd P;
+	P.fd      = m_TrackerSocket->getHandle ();
+	P.events  = POLLOUT;
+	P.revents = 0;
+	if ( poll ( &P, 1, Timeout ) <= 0 )
+#else
+	netSocket* Writes[2] = { m_TrackerSocket, 0 };
+	if ( netSocket::select ( 0, Writes, ( Timeout + 999 ) / 1000 ) <= 0 )
+#endif
+	{
+		if ( now_ms () - m_ConnectStart < CONNECT_TIMEOUT )
+		{
+			return 0;
+		}
+		SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::CheckConnect: "
+		            << "Connect timed out!"
+		          );
+		return -1;
+	}
+	int       Error = 0;
+	socklen_t Len   = sizeof ( Error );
+	if ( getsockopt ( m_TrackerSocket->getHandle (), SOL_SOCKET, SO_ERROR,
+	  ( char* ) &Error, &Len ) < 0 )
+	{
+		Error = errno;
+	}
+	if ( Error != 0 )
+	{
+		SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::CheckConnect: "
+		            << "Connect failed! " << strerror ( Error )
+		          );
+		return -1;
+	}
+	return 1;
+} // CheckConnect ()
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Introduce this fgms to the tracker. The tracker answers with
+//  IDENTIFIED, messages are only sent after that (see SendQueue()).
+//
+//////////////////////////////////////////////////////////////////////
+void
+FG_TRACKER::Handshake()
+{
 	SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::Connect: "
 	            << "success"
 	          );
 	LastConnected	= time ( 0 );
-	m_TrackerSocket->write_char ( '\0' );
-	sleep ( 2 );
+	LastSeen	= LastConnected;	/*the timeout starts now*/
+	TrackerWrite ( "" );	/*a single '\0'*/
 	/*Write Version header to FGTracker*/
 	std::stringstream ss;
 	ss << "V" << m_ProtocolVersion << " " << VERSION << " "<< m_domain << " " << m_FgmsName;
@@ -634,9 +1085,102 @@ FG_TRACKER::Connect()
 	SG_LOG ( SG_FGTRACKER, SG_DEBUG, "# FG_TRACKER::Connect: "
 	            << "Written Version header"
 	          );
-	sleep ( 1 );
-	return true;
-} // Connect ()
+	/*messages are sent as text until FGTracker accepts the offer*/
+	m_BinaryActive = false;
+	if ( m_Binary )
+	{
+		TrackerWrite ( "BINARY 1" );
+	}
+} // Handshake ()
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Set the time of the next connect. The delay doubles with every
+//  failed attempt, from MIN_BACKOFF up to tracker_conn_secs, and is
+//  randomized, so that many fgms do not reconnect at the same time.
+//
+//////////////////////////////////////////////////////////////////////
+void
+FG_TRACKER::ScheduleReconnect()
+{
+	int MaxBackoff = tracker_conn_secs * 1000;
+	if ( m_BackoffMs < MIN_BACKOFF )
+		m_BackoffMs = MIN_BACKOFF;
+	else if ( m_BackoffMs < MaxBackoff / 2 )
+		m_BackoffMs *= 2;
+	else
+		m_BackoffMs = MaxBackoff;
+	/*between half and the full delay*/
+	int Delay = m_BackoffMs / 2 + rand () % ( m_BackoffMs / 2 + 1 );
+	m_NextConnect = now_ms () + Delay;
+	SG_LOG ( SG_FGTRACKER, SG_ALERT, "# FG_TRACKER::Loop: "
+	            << "not connected, will retry in " << Delay << " ms"
+	          );
+} // ScheduleReconnect ()
+
+//////////////////////////////////////////////////////////////////////
+//
+//  The connection is lost. Only the first of TrackerRead(), Flush()
+//  and CheckTimeout() noticing it counts it and schedules the
+//  reconnect, a second call would double the delay.
+//
+//////////////////////////////////////////////////////////////////////
+void
+FG_TRACKER::LostConnection()
+{
+	if ( ! is_connected () )
+		return;
+	set_connected ( false );
+	LostConnections++;
+	ScheduleReconnect ();
+} // LostConnection ()
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Sleep until the next connect is due, or the tracker is closed. Wake
+//  up every second, so that Loop() keeps moving queued messages to the
+//  journal.
+//
+//////////////////////////////////////////////////////////////////////
+void
+FG_TRACKER::WaitReconnect()
+{
+	uint64_t Now = now_ms ();
+	if ( Now >= m_NextConnect )
+		return;
+	struct timeval now;
+	struct timespec timeout;
+	gettimeofday(&now, 0);
+	uint64_t Wait = m_NextConnect - Now;
+	if ( Wait > 1000 )
+		Wait = 1000;
+	uint64_t Usec = now.tv_usec + ( Wait % 1000 ) * 1000;
+	timeout.tv_sec  = now.tv_sec + Wait / 1000 + Usec / 1000000;
+	timeout.tv_nsec = ( Usec % 1000000 ) * 1000;
+	pthread_mutex_lock ( &msg_mutex );
+	if ( ! WantExit )
+		pthread_cond_timedwait ( &condition_var, &msg_mutex, &timeout );
+	pthread_mutex_unlock ( &msg_mutex );
+} // WaitReconnect ()
+
+//////////////////////////////////////////////////////////////////////
+//
+//  a monotonic time in milliseconds
+//
+//////////////////////////////////////////////////////////////////////
+static uint64_t
+now_ms ()
+{
+#ifdef _MSC_VER
+	struct timeval now;
+	gettimeofday ( &now, 0 );
+	return ( uint64_t ) now.tv_sec * 1000 + now.tv_usec / 1000;
+#else
+	struct timespec T;
+	clock_gettime ( CLOCK_MONOTONIC, &T );
+	return ( uint64_t ) T.tv_sec * 1000 + T.tv_nsec / 1000000;
+#endif
+} // now_ms ()
 
 //////////////////////////////////////////////////////////////////////
 /**
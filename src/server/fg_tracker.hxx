@@ -36,6 +36,8 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <deque>
+#include <atomic>
 #include <string.h>
 #include <errno.h>
 #include <time.h>
@@ -44,6 +46,8 @@
 #include <plib/netSocket.h>
 #include "daemon.hxx"
 #include "fg_geometry.hxx"
+#include "fg_ring.hxx"
+#include "fg_journal.hxx"
 
 #define CONNECT    0
 #define DISCONNECT 1
@@ -77,19 +81,49 @@ public:
 
 	typedef std::vector<std::string> vMSG;	/* string vector */
 	typedef vMSG::iterator VI;		/* string vector iterator */
+	typedef std::deque<std::string> dMSG;	/* string deque */
+	typedef mT_FG_Ring<std::string> rMSG;	/* lock free message ring */
 	typedef struct buffsock { /*socket buffer*/
 		char* buf;
 		size_t maxlen;
 		size_t curlen;
 	} buffsock_t;
-	pthread_mutex_t msg_mutex;		/* message queue mutext */
-	pthread_mutex_t msg_sent_mutex;		/* message queue mutext */
-	pthread_mutex_t msg_recv_mutex;		/* message queue mutext */
+	enum
+	{
+		QUEUE_SIZE	= 16384,	/* messages waiting to be sent */
+		DEF_WINDOW	= 25,		/* messages waiting for an OK */
+		MAX_BATCH	= 65536,	/* bytes written at once */
+		CONNECT_TIMEOUT	= 10000,	/* ms */
+		MIN_BACKOFF	= 250		/* ms until the first reconnect */
+	};
+	/** @brief binary framing, see EncodeMessage() */
+	enum
+	{
+		FRAME_MARK	= 0x01,		/* first byte of a binary frame */
+		REC_TEXT	= 0,		/* a line of the text protocol */
+		REC_POSITION	= 1		/* a POSITION line, fixed width */
+	};
+	pthread_mutex_t msg_mutex;		/* protects condition_var */
 	pthread_cond_t  condition_var;		/* message queue condition */
-	vMSG    msg_queue;			/* the single message queue */
-	vMSG    msg_sent_queue;			/* the single message queue */
-	vMSG    msg_recv_queue;			/* the single message queue */
-	bool	WantExit;
+	rMSG    msg_queue;			/* messages from fgms, many writers */
+	dMSG    msg_retry_queue;		/* messages to send before msg_queue */
+	dMSG    msg_sent_queue;			/* sent, but not acknowledged */
+	vMSG    msg_recv_queue;			/* replies of the tracker */
+	FG_Journal	m_Journal;		/* messages not yet acknowledged */
+	std::string	m_JournalDir;		/* directory of m_Journal */
+	std::deque<FG_Journal::Position> m_SentPos;	/* journal positions of msg_sent_queue */
+	std::string	m_OutBuf;		/* messages not yet written */
+	size_t	m_OutPos;			/* bytes of m_OutBuf written */
+	size_t	m_Window;			/* max. size of msg_sent_queue */
+	std::atomic<bool>	m_Waiting;	/* Loop() waits for messages */
+	std::atomic<size_t>	m_Backlog;	/* size of msg_retry_queue */
+	bool	m_Connecting;			/* connect in progress */
+	uint64_t	m_ConnectStart;		/* ms, start of the connect */
+	uint64_t	m_NextConnect;		/* ms, time of the next connect */
+	int	m_BackoffMs;			/* delay after the last failure */
+	bool	m_Binary;			/* offer binary framing */
+	bool	m_BinaryActive;			/* binary framing accepted */
+	std::atomic<bool>	WantExit;	/* Loop() returns */
 	// static, so it can be set from outside (signal handler)
 	static bool	m_connected;			/* If connected to fgtracker */
 	static inline void set_connected ( bool b ) { m_connected = b; };
@@ -109,6 +143,14 @@ public:
 	//////////////////////////////////////////////////
 	int	Loop ();
 	void	AddMessage ( const std::string & message );
+	void	SetWindow ( size_t Window );
+	void	SetBinary ( bool Binary );
+	void	SetJournal ( const std::string& Dir );
+	/**
+	 * @brief Return true if messages are sent in binary frames
+	 */
+	bool	IsBinary () const { return m_BinaryActive; };
+	size_t	QueueSize () const;
 	
 	/** 
 	 * @brief Return the server of the tracker
@@ -130,9 +172,20 @@ public:
 	//
 	//////////////////////////////////////////////////
 	bool 	Connect ();
+	int	CheckConnect ( int Timeout );
+	void	Handshake ();
+	void	ScheduleReconnect ();
+	void	LostConnection ();
+	void	WaitReconnect ();
 	void	WriteQueue ();
 	void	ReadQueue ();
+	void	Spool ();
 	void 	ReQueueSentMsg ();
+	void	SendQueue ();
+	int	Flush ();
+	void	EncodeMessage ( const std::string& Msg );
+	void	EncodeRecord ( const char* Line, size_t Len );
+	void	Wait ();
 	void 	buffsock_free(buffsock_t* bs);
 	void	CheckTimeout();
 	int		TrackerWrite (const std::string& str);
@@ -149,6 +202,7 @@ public:
 	uint64_t	BytesRcvd;
 	uint64_t	PktsSent;
 	uint64_t	PktsRcvd;
+	std::atomic<uint64_t>	MsgsDropped;
 	size_t		LostConnections;
 	pthread_t 	MyThreadID;
 };
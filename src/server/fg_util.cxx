@@ -150,3 +150,72 @@ str_ends_with
 	return std::equal( ending.rbegin(), ending.rend(), value.rbegin() );
 } // str_ends_with ()
 //////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Append a number in fixed point notation to 'str'.
+ *
+ * Like NumToStr ( number, precision ), the digits behind the dot are
+ * truncated, not rounded. The digits are written into a small buffer
+ * and appended at once, so no temporary strings are created.
+ * @param str		the string to append to
+ * @param number	the number to convert
+ * @param precision	number of digits after the dot (at most 9)
+ */
+void
+append_fixed
+(
+	std::string& str,
+	double number,
+	int precision
+)
+{
+	char		buf[48];
+	char*		p = buf + sizeof ( buf );
+	uint64_t	factor = 1;
+	uint64_t	ipart;
+	uint64_t	fpart;
+	bool		negative = ( number < 0 );
+
+	if ( number == 0 )
+	{
+		str += '0';
+		return;
+	}
+	if ( precision > 9 )
+		precision = 9;
+	for ( int i = 0; i < precision; i++ )
+		factor *= 10;
+	if ( negative )
+		number = -number;
+	if ( number >= 1e18 )
+	{	// does not fit, should never happen
+		str += NumToStr ( negative ? -number : number, precision );
+		return;
+	}
+	ipart = ( uint64_t ) number;
+	fpart = ( uint64_t ) ( ( number - ipart ) * factor );
+	if ( ( precision > 0 ) && ( fpart == 0 ) && ( number != ipart ) )
+	{	// a fraction below the precision, NumToStr writes ".0"
+		*--p = '0';
+		*--p = '.';
+	}
+	else if ( precision > 0 )
+	{
+		for ( int i = 0; i < precision; i++ )
+		{
+			*--p = '0' + ( fpart % 10 );
+			fpart /= 10;
+		}
+		*--p = '.';
+	}
+	do
+	{
+		*--p = '0' + ( ipart % 10 );
+		ipart /= 10;
+	} while ( ipart != 0 );
+	if ( negative )
+		*--p = '-';
+	str.append ( p, buf + sizeof ( buf ) - p );
+} // append_fixed ()
+//////////////////////////////////////////////////////////////////////
@@ -45,6 +45,7 @@ std::string timestamp_to_days ( time_t date );
 std::string diff_to_days ( time_t date );
 std::string byte_counter ( double bytes );
 bool str_ends_with ( std::string const& value, std::string const& ending );
+void append_fixed ( std::string& str, double number, int precision );
 
 //////////////////////////////////////////////////////////////////////
 /**
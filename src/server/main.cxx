@@ -356,6 +356,46 @@ ProcessConfig ( const string& ConfigName )
 				);
 				exit ( 1 );
 			}
+			Val = Config.Get ( "server.tracking_window" );
+			if ( Val != "" )
+			{
+				Servant.SetTrackerWindow ( StrToInt<int> ( Val.c_str (), E ) );
+				if ( E )
+				{
+					SG_LOG ( SG_SYSTEMS, SG_ALERT,
+					  "invalid value for tracking_window: '"
+					  << Val << "'"
+					);
+					exit ( 1 );
+				}
+			}
+			Val = Config.Get ( "server.tracking_delta" );
+			if ( Val != "" )
+			{
+				Servant.SetTrackerDelta ( StrToInt<int> ( Val.c_str (), E ) );
+				if ( E )
+				{
+					SG_LOG ( SG_SYSTEMS, SG_ALERT,
+					  "invalid value for tracking_delta: '"
+					  << Val << "'"
+					);
+					exit ( 1 );
+				}
+			}
+			Val = Config.Get ( "server.tracking_binary" );
+			if ( ( Val == "on" ) || ( Val == "true" ) )
+			{
+				Servant.SetTrackerBinary ( true );
+			}
+			Val = Config.Get ( "server.tracking_journal" );
+			if ( ( Val == "off" ) || ( Val == "false" ) )
+			{
+				Servant.SetTrackerJournal ( "" );
+			}
+			else if ( Val != "" )
+			{
+				Servant.SetTrackerJournal ( Val );
+			}
 			if ( tracked && ( Servant.AddTracker ( Server, Port, tracked ) != FG_SERVER::SUCCESS ) ) // set master m_IsTracked
 			{
 				SG_LOG ( SG_SYSTEMS, SG_ALERT, "Failed to get IPC msg queue ID! error " << errno );
@@ -375,6 +415,163 @@ ProcessConfig ( const string& ConfigName )
 			Servant.SetHub ( false );
 		}
 	}
+	Val = Config.Get ( "server.worker_threads" );
+	if ( Val != "" )
+	{
+		Servant.SetWorkerThreads ( StrToInt<int> ( Val.c_str (), E ) );
+		if ( E )
+		{
+			SG_LOG ( SG_SYSTEMS, SG_ALERT,
+			  "invalid value for worker_threads: '" << Val << "'"
+			);
+			exit ( 1 );
+		}
+	}
+	Val = Config.Get ( "server.rate_limit" );
+	if ( Val != "" )
+	{
+		Servant.SetRateLimit ( StrToInt<int> ( Val.c_str (), E ) );
+		if ( E )
+		{
+			SG_LOG ( SG_SYSTEMS, SG_ALERT,
+			  "invalid value for rate_limit: '" << Val << "'"
+			);
+			exit ( 1 );
+		}
+	}
+	Val = Config.Get ( "server.rate_burst" );
+	if ( Val != "" )
+	{
+		Servant.SetRateBurst ( StrToInt<int> ( Val.c_str (), E ) );
+		if ( E )
+		{
+			SG_LOG ( SG_SYSTEMS, SG_ALERT,
+			  "invalid value for rate_burst: '" << Val << "'"
+			);
+			exit ( 1 );
+		}
+	}
+	Val = Config.Get ( "server.rate_escalate" );
+	if ( Val != "" )
+	{
+		Servant.SetRateEscalate ( StrToInt<int> ( Val.c_str (), E ) );
+		if ( E )
+		{
+			SG_LOG ( SG_SYSTEMS, SG_ALERT,
+			  "invalid value for rate_escalate: '" << Val << "'"
+			);
+			exit ( 1 );
+		}
+	}
+	Val = Config.Get ( "server.rate_block_time" );
+	if ( Val != "" )
+	{
+		Servant.SetRateBlockTime ( StrToInt<int> ( Val.c_str (), E ) );
+		if ( E )
+		{
+			SG_LOG ( SG_SYSTEMS, SG_ALERT,
+			  "invalid value for rate_block_time: '" << Val << "'"
+			);
+			exit ( 1 );
+		}
+	}
+	Val = Config.Get ( "server.relay_budget" );
+	if ( Val != "" )
+	{
+		Servant.SetRelayBudget ( StrToInt<int> ( Val.c_str (), E ) );
+		if ( E )
+		{
+			SG_LOG ( SG_SYSTEMS, SG_ALERT,
+			  "invalid value for relay_budget: '" << Val << "'"
+			);
+			exit ( 1 );
+		}
+	}
+	Val = Config.Get ( "server.lod_bands" );
+	// always set, a reload without the key forwards every packet again
+	if ( ! Servant.SetLodBands ( Val ) )
+	{
+		SG_LOG ( SG_SYSTEMS, SG_ALERT,
+		  "invalid value for lod_bands: '" << Val << "'"
+		);
+		exit ( 1 );
+	}
+	Val = Config.Get ( "server.property_bands" );
+	// always set, a reload without the key forwards all properties again
+	if ( ! Servant.SetPropertyBands ( Val ) )
+	{
+		SG_LOG ( SG_SYSTEMS, SG_ALERT,
+		  "invalid value for property_bands: '" << Val << "'"
+		);
+		exit ( 1 );
+	}
+	Val = Config.Get ( "server.tick_rate" );
+	if ( Val != "" )
+	{
+		Servant.SetTickRate ( StrToInt<int> ( Val.c_str (), E ) );
+		if ( E )
+		{
+			SG_LOG ( SG_SYSTEMS, SG_ALERT,
+			  "invalid value for tick_rate: '" << Val << "'"
+			);
+			exit ( 1 );
+		}
+	}
+	Val = Config.Get ( "server.egress_queue" );
+	if ( Val != "" )
+	{
+		Servant.SetEgressQueue ( StrToInt<int> ( Val.c_str (), E ) );
+		if ( E )
+		{
+			SG_LOG ( SG_SYSTEMS, SG_ALERT,
+			  "invalid value for egress_queue: '" << Val << "'"
+			);
+			exit ( 1 );
+		}
+	}
+	Val = Config.Get ( "server.reckon_angle" );
+	if ( Val != "" )
+	{
+		Servant.SetReckonAngle ( StrToInt<int> ( Val.c_str (), E ) );
+		if ( E )
+		{
+			SG_LOG ( SG_SYSTEMS, SG_ALERT,
+			  "invalid value for reckon_angle: '" << Val << "'"
+			);
+			exit ( 1 );
+		}
+	}
+	Val = Config.Get ( "server.reckon_silence" );
+	if ( Val != "" )
+	{
+		Servant.SetReckonSilence ( StrToInt<int> ( Val.c_str (), E ) );
+		if ( E )
+		{
+			SG_LOG ( SG_SYSTEMS, SG_ALERT,
+			  "invalid value for reckon_silence: '" << Val << "'"
+			);
+			exit ( 1 );
+		}
+	}
+	Val = Config.Get ( "server.batch_io" );
+	if ( Val != "" )
+	{
+		if ( ( Val == "on" ) || ( Val == "true" ) )
+		{
+			Servant.SetBatchIO ( true );
+		}
+		else if ( ( Val == "off" ) || ( Val == "false" ) )
+		{
+			Servant.SetBatchIO ( false );
+		}
+		else
+		{
+			SG_LOG ( SG_SYSTEMS, SG_ALERT,
+			  "unknown value for 'server.batch_io'!"
+			  << " in file " << ConfigName
+			);
+		}
+	}
 	//////////////////////////////////////////////////
 	//      read the list of relays
 	//////////////////////////////////////////////////
@@ -666,10 +863,10 @@ ReadConfigs ( bool ReInit = false )
 
 //////////////////////////////////////////////////////////////////////
 /**
- * @brief If we receive a SIGHUP, reinit application
- * @param SigType int with signal type
+ * @brief Read the config again and reinit the server. Called by
+ *        FG_SERVER::Loop() with the worker threads stopped.
  */
-void SigHUPHandler ( int SigType )
+void ReloadConfig ()
 {
 	Servant.PrepareInit();
 	bHadConfig = false;
@@ -694,6 +891,18 @@ void SigHUPHandler ( int SigType )
 		SG_LOG ( SG_SYSTEMS, SG_ALERT, "received HUP signal, but reinit failed!" );
 		exit ( 1 );
 	}
+} // ReloadConfig ()
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief If we receive a SIGHUP, reinit application. The main loop
+ *        does the reinit, see ReloadConfig().
+ * @param SigType int with signal type
+ */
+void SigHUPHandler ( int SigType )
+{
+	Servant.RequestReinit ();
 #ifndef _MSC_VER
 	signal ( SigType, SigHUPHandler );
 #endif
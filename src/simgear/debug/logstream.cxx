@@ -23,6 +23,13 @@
 #include "config.h"
 #endif
 
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <algorithm>
+#include <vector>
 #include "logstream.hxx"
 #include "stdio.h"
 
@@ -129,31 +136,307 @@ logstream::setLogLevels ( sgDebugClass c, sgDebugPriority p )
 	logbuf::set_log_level ( c, p );
 }
 
-string
+const char*
 logstream::datestr ( void )
 {
+	static thread_local time_t last = 0;
+	static thread_local char   buf[64] = "";
+	static thread_local string user;
 	if ( with_date == false )
 	{
 		return "";
 	}
-	time_t  date;
-	struct tm* tmr;
-	char buf[64];
 	if ( userdatestr )
 	{
-		string msg = ( *userdatestr ) ();
-		msg += " ";
-		return msg;
+		user = ( *userdatestr ) ();
+		user += " ";
+		return user.c_str();
 	}
-	date = time ( 0 );
-	tmr = localtime ( &date );
-	sprintf ( buf, "%02d.%02d.%04d %02d:%02d:%02d ",
-	          tmr->tm_mday,
-	          tmr->tm_mon+1,
-	          tmr->tm_year+1900,
-	          tmr->tm_hour,
-	          tmr->tm_min,
-	          tmr->tm_sec );
-	return ( string ) buf;
+	time_t date = time ( 0 );
+	if ( date != last )
+	{
+		struct tm tmr;
+		localtime_r ( &date, &tmr );
+		snprintf ( buf, sizeof ( buf ), "%02d.%02d.%04d %02d:%02d:%02d ",
+			  tmr.tm_mday,
+			  tmr.tm_mon+1,
+			  tmr.tm_year+1900,
+			  tmr.tm_hour,
+			  tmr.tm_min,
+			  tmr.tm_sec );
+		last = date;
+	}
+	return buf;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Asynchronous logging
+//
+// Every thread which logs gets its own ring buffer of formatted
+// records. Only the owning thread writes to a ring and only the holder
+// of g_LogMutex reads from it, so no lock is needed to queue a record.
+// The writer thread collects the records of all rings every
+// LOG_INTERVAL microseconds, orders them by their sequence number and
+// writes them with a single flush.
+//
+//////////////////////////////////////////////////////////////////////
+
+/** @brief microseconds between two batches of the writer thread */
+static const useconds_t LOG_INTERVAL = 20000;
+
+/** @brief a queued log record */
+struct logrecord
+{
+	uint64_t	seq;
+	sgDebugClass	logClass;
+	sgDebugPriority	logPriority;
+	string		msg;
+	bool operator < ( const logrecord& r ) const
+	{
+		return seq < r.seq;
+	}
+};
+
+/**
+ * @class logring
+ * @brief Lock free ring buffer of log records with a single producer
+ *        and a single consumer.
+ */
+class logring
+{
+public:
+	logring () : orphaned ( false ), head ( 0 ), tail ( 0 ) {}
+	/** @brief queue a record, false if there is no room */
+	bool put ( uint64_t seq, sgDebugClass c, sgDebugPriority p, const string& msg );
+	/** @brief append all queued records to out */
+	void get ( std::vector<logrecord>& out );
+	/** @brief true if no record is queued */
+	bool empty () const
+	{
+		return head.load ( std::memory_order_acquire ) == tail.load ( std::memory_order_relaxed );
+	}
+	/** @brief set when the owning thread exits */
+	std::atomic<bool>	orphaned;
+private:
+	enum { SIZE = 64 * 1024 };	// must be a power of 2
+	struct header
+	{
+		uint64_t	seq;
+		uint32_t	logClass;
+		uint32_t	logPriority;
+		uint32_t	len;
+	};
+	void copy_in ( size_t pos, const void* src, size_t len );
+	void copy_out ( size_t pos, void* dst, size_t len ) const;
+	std::atomic<size_t>	head;	// written by the producer
+	std::atomic<size_t>	tail;	// written by the consumer
+	char			buf[SIZE];
+};
+
+void
+logring::copy_in ( size_t pos, const void* src, size_t len )
+{
+	size_t off   = pos & ( SIZE - 1 );
+	size_t first = std::min<size_t> ( len, SIZE - off );
+	memcpy ( buf + off, src, first );
+	memcpy ( buf, ( const char* ) src + first, len - first );
 }
 
+void
+logring::copy_out ( size_t pos, void* dst, size_t len ) const
+{
+	size_t off   = pos & ( SIZE - 1 );
+	size_t first = std::min<size_t> ( len, SIZE - off );
+	memcpy ( dst, buf + off, first );
+	memcpy ( ( char* ) dst + first, buf, len - first );
+}
+
+bool
+logring::put ( uint64_t seq, sgDebugClass c, sgDebugPriority p, const string& msg )
+{
+	header h;
+	size_t pos  = head.load ( std::memory_order_relaxed );
+	size_t need = sizeof ( h ) + msg.size ();
+	if ( ( SIZE - ( pos - tail.load ( std::memory_order_acquire ) ) ) < need )
+	{
+		return false;
+	}
+	h.seq         = seq;
+	h.logClass    = ( uint32_t ) c;
+	h.logPriority = ( uint32_t ) p;
+	h.len         = ( uint32_t ) msg.size ();
+	copy_in ( pos, &h, sizeof ( h ) );
+	copy_in ( pos + sizeof ( h ), msg.data (), msg.size () );
+	head.store ( pos + need, std::memory_order_release );
+	return true;
+}
+
+void
+logring::get ( std::vector<logrecord>& out )
+{
+	size_t pos = tail.load ( std::memory_order_relaxed );
+	size_t end = head.load ( std::memory_order_acquire );
+	while ( pos < end )
+	{
+		header h;
+		logrecord r;
+		copy_out ( pos, &h, sizeof ( h ) );
+		r.seq         = h.seq;
+		r.logClass    = ( sgDebugClass ) h.logClass;
+		r.logPriority = ( sgDebugPriority ) h.logPriority;
+		r.msg.resize ( h.len );
+		copy_out ( pos + sizeof ( h ), &r.msg[0], h.len );
+		out.push_back ( r );
+		pos += sizeof ( h ) + h.len;
+	}
+	tail.store ( pos, std::memory_order_release );
+}
+
+/** @brief all rings, protected by g_RingMutex */
+static std::vector<logring*>	g_Rings;
+static pthread_mutex_t		g_RingMutex = PTHREAD_MUTEX_INITIALIZER;
+/** @brief order of records over all threads */
+static std::atomic<uint64_t>	g_LogSeq ( 0 );
+/** @brief true while the writer thread is running */
+static std::atomic<bool>	g_LogAsync ( false );
+static pthread_t		g_LogWriter;
+
+/**
+ * @brief Owner of the ring of a thread. When the thread exits, the
+ *        ring is freed by the writer after it has been emptied.
+ */
+struct logringholder
+{
+	logringholder () : ring ( NULL ) {}
+	~logringholder ()
+	{
+		if ( ring )
+		{
+			ring->orphaned.store ( true );
+		}
+	}
+	logring* ring;
+};
+
+static logring*
+thread_ring ()
+{
+	static thread_local logringholder holder;
+	if ( holder.ring == NULL )
+	{
+		holder.ring = new logring;
+		pthread_mutex_lock ( &g_RingMutex );
+		g_Rings.push_back ( holder.ring );
+		pthread_mutex_unlock ( &g_RingMutex );
+	}
+	return holder.ring;
+}
+
+static void*
+log_writer ( void* )
+{
+	while ( g_LogAsync.load () )
+	{
+		usleep ( LOG_INTERVAL );
+		sglog().flush_async ();
+	}
+	return 0;
+}
+
+static void
+log_atexit ()
+{
+	sglog().stop_async ();
+}
+
+void
+logstream::log ( sgDebugClass c, sgDebugPriority p, const string& msg )
+{
+	uint64_t seq = g_LogSeq.fetch_add ( 1 );
+	if ( g_LogAsync.load ( std::memory_order_relaxed ) )
+	{
+		if ( thread_ring ()->put ( seq, c, p, msg ) )
+		{
+			return;
+		}
+	}
+	// not running async or the queue is full
+	pthread_mutex_lock ( &g_LogMutex );
+	*this << loglevel ( c, p ) << msg;
+	flush ();
+	pthread_mutex_unlock ( &g_LogMutex );
+}
+
+void
+logstream::flush_async ()
+{
+	std::vector<logring*>  rings;
+	std::vector<logrecord> records;
+	pthread_mutex_lock ( &g_RingMutex );
+	rings = g_Rings;
+	pthread_mutex_unlock ( &g_RingMutex );
+	pthread_mutex_lock ( &g_LogMutex );
+	for ( size_t i = 0; i < rings.size(); i++ )
+	{
+		rings[i]->get ( records );
+	}
+	std::sort ( records.begin(), records.end() );
+	for ( size_t i = 0; i < records.size(); i++ )
+	{
+		*this << loglevel ( records[i].logClass, records[i].logPriority ) << records[i].msg;
+	}
+	if ( ! records.empty() )
+	{
+		flush ();
+	}
+	// free the rings of threads which are gone
+	pthread_mutex_lock ( &g_RingMutex );
+	for ( size_t i = 0; i < g_Rings.size(); )
+	{
+		logring* r = g_Rings[i];
+		if ( r->orphaned.load () && r->empty () )
+		{
+			g_Rings[i] = g_Rings.back ();
+			g_Rings.pop_back ();
+			delete r;
+			continue;
+		}
+		i++;
+	}
+	pthread_mutex_unlock ( &g_RingMutex );
+	pthread_mutex_unlock ( &g_LogMutex );
+}
+
+void
+logstream::start_async ()
+{
+	static bool registered = false;
+	if ( g_LogAsync.load () )
+	{
+		return;
+	}
+	g_LogAsync.store ( true );
+	if ( pthread_create ( &g_LogWriter, 0, log_writer, 0 ) != 0 )
+	{
+		g_LogAsync.store ( false );
+		return;
+	}
+	if ( ! registered )
+	{
+		atexit ( log_atexit );
+		registered = true;
+	}
+}
+
+bool
+logstream::stop_async ()
+{
+	if ( ! g_LogAsync.exchange ( false ) )
+	{
+		return false;
+	}
+	pthread_join ( g_LogWriter, 0 );
+	flush_async ();
+	return true;
+}
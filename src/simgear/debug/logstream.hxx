@@ -160,6 +160,19 @@ public:
 	*/
 	static sgDebugPriority get_log_priority ();
 
+	/**
+	* @brief Check if a message would be logged, before it is formatted.
+	* @param c debug class
+	* @param p priority
+	* @return true if the message is logged
+	*/
+	static bool would_log ( sgDebugClass c, sgDebugPriority p )
+	{
+		if ((p == SG_ALERT) && (logPriority != SG_DISABLED))
+			return true;	// SG_ALERT is logged regardless of logClass
+		return ( (( c & logClass ) != 0) && (p >= logPriority) );
+	}
+
 
 	/**
 	* @brief Set the stream buffer
@@ -342,9 +355,41 @@ public:
 	};
 
 	/**
-	 * @brief Return a date as a string, standard format
+	 * @brief Return a date as a string, standard format.
+	 *
+	 * The string is formatted once per second and thread, the
+	 * returned buffer is valid until the next call of the thread.
+	 */
+	const char* datestr ( void );
+
+	/**
+	 * @brief Log a formatted message.
+	 *
+	 * If the writer thread is running, the message is put into the
+	 * queue of the calling thread without taking any lock, otherwise
+	 * (or if the queue is full) it is written immediately.
+	 * @param c debug class
+	 * @param p priority
+	 * @param msg the message including date and line end
+	 */
+	void log ( sgDebugClass c, sgDebugPriority p, const string& msg );
+
+	/**
+	 * @brief Start the writer thread, which writes the queued
+	 *        messages in batches. Does nothing if it is running.
+	 */
+	void start_async ();
+
+	/**
+	 * @brief Write all queued messages and stop the writer thread.
+	 * @return true if the writer thread was running
+	 */
+	bool stop_async ();
+
+	/**
+	 * @brief Write all queued messages in the order they were logged.
 	 */
-	string datestr ( void );
+	void flush_async ();
 
 	/**
 	 * @brief Enable output of date
@@ -420,14 +465,20 @@ sglog()
 # define SG_LOG(C,P,M) SG_CONSOLE(C,P,M)
 #else
 #define SG_LOG(C,P,M) { \
-	pthread_mutex_lock ( & g_LogMutex ); \
-	sglog() << loglevel(C,P) << sglog().datestr() << M << std::endl; \
-	pthread_mutex_unlock ( & g_LogMutex ); \
+	if ( logbuf::would_log ( (sgDebugClass) (C), P ) ) \
+	{ \
+		std::ostringstream sg_os; \
+		sg_os << sglog().datestr() << M << "\n"; \
+		sglog().log ( (sgDebugClass) (C), P, sg_os.str() ); \
+	} \
 }
 #define SG_CONSOLE(C,P,M) { \
-	pthread_mutex_lock ( & g_LogMutex ); \
-	sglog() << loglevel((sgDebugClass) (C|SG_CONSOLE),P) << sglog().datestr() << M << "\r\n"; \
-	pthread_mutex_unlock ( & g_LogMutex ); \
+	if ( logbuf::would_log ( (sgDebugClass) (C|SG_CONSOLE), P ) ) \
+	{ \
+		std::ostringstream sg_os; \
+		sg_os << sglog().datestr() << M << "\r\n"; \
+		sglog().log ( (sgDebugClass) (C|SG_CONSOLE), P, sg_os.str() ); \
+	} \
 }
 #endif
 #endif
@@ -0,0 +1,99 @@
+/**
+ * @file fg_packet.hxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, packets built by the tests and benchmarks
+//
+//////////////////////////////////////////////////////////////////////
+
+#if !defined FG_PACKET_HXX
+#define FG_PACKET_HXX
+
+#include <string.h>
+#include <vector>
+#include <flightgear/MultiPlayer/mpmessages.hxx>
+#include <flightgear/MultiPlayer/tiny_xdr.hxx>
+
+/** the size of a position packet without properties */
+static const size_t Fixed = sizeof ( T_MsgHdr ) + sizeof ( T_PositionMsg );
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Append a 32 bit word to a property stream
+ */
+inline void
+Word ( std::vector<char>& Stream, uint32_t W )
+{
+	xdr_data_t X = XDR_encode<uint32_t> ( W );
+	Stream.insert ( Stream.end (), ( char* ) &X, ( char* ) &X + sizeof ( X ) );
+}
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Append a string in the short encoding of protocol v2
+ */
+inline void
+ShortString ( std::vector<char>& Stream, uint32_t Id, const char* Text )
+{
+	size_t Len = strlen ( Text );
+	Word ( Stream, ( Id << 16 ) | Len );
+	Stream.insert ( Stream.end (), Text, Text + Len );
+	while ( Stream.size () % 4 )
+		Stream.push_back ( 0 );
+}
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief A position packet with the properties of Props
+ */
+inline std::vector<char>
+Packet ( const std::vector<char>& Props )
+{
+	std::vector<char> Msg ( Fixed + Props.size (), 0 );
+	if ( ! Props.empty () )
+		memcpy ( &Msg[Fixed], &Props[0], Props.size () );
+	T_MsgHdr* Hdr = ( T_MsgHdr* ) &Msg[0];
+	Hdr->Magic   = XDR_encode<uint32_t> ( MSG_MAGIC );
+	Hdr->Version = XDR_encode<uint32_t> ( PROTO_VER );
+	Hdr->MsgId   = XDR_encode<uint32_t> ( FGFS::POS_DATA );
+	Hdr->MsgLen  = XDR_encode<uint32_t> ( Msg.size () );
+	memcpy ( Hdr->Name, "TEST", 5 );
+	return Msg;
+}
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Set the position and the velocity of a position packet
+ */
+inline void
+SetPosition ( std::vector<char>& Msg, const double Pos[3], const float Vel[3],
+  double Time )
+{
+	T_PositionMsg* PosMsg = ( T_PositionMsg* ) &Msg[sizeof ( T_MsgHdr )];
+	for ( int i = 0; i < 3; i++ )
+	{
+		PosMsg->position[i]  = XDR_encode64<double> ( Pos[i] );
+		PosMsg->linearVel[i] = XDR_encode<float> ( Vel[i] );
+	}
+	PosMsg->time = XDR_encode64<double> ( Time );
+}
+
+#endif
@@ -0,0 +1,48 @@
+/**
+ * @file fg_test.hxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, helpers of the tests
+//
+//////////////////////////////////////////////////////////////////////
+
+#if !defined FG_TEST_HXX
+#define FG_TEST_HXX
+
+#include <iostream>
+
+static int FailedChecks = 0;
+
+/** report a failed condition, the test goes on */
+#define CHECK(Cond) \
+	do \
+	{ \
+		if ( ! ( Cond ) ) \
+		{ \
+			std::cerr << __FILE__ << ":" << __LINE__ \
+			  << ": check failed: " #Cond << std::endl; \
+			FailedChecks++; \
+		} \
+	} while ( 0 )
+
+/** the exit code of a test */
+#define TEST_RESULT() ( ( FailedChecks == 0 ) ? 0 : 1 )
+
+#endif
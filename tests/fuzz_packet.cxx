@@ -0,0 +1,311 @@
+/**
+ * @file fuzz_packet.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, fuzzing of the packet checks
+//
+//  Every datagram goes through the steps of FG_SERVER::HandlePacket()
+//  which look into it: Decode(), PacketIsValid(), PacketErrorMsg() and
+//  AddBadClient() or, for a valid position packet,
+//  FG_PropertyFilter::Trim(). A datagram
+//  is copied into a buffer of exactly its size, so that an
+//  address sanitizer catches every read beyond it.
+//
+//  Built with -DFGMS_FUZZ=ON (clang only) this is a libFuzzer target.
+//  Otherwise main() runs random mutations of valid packets with a
+//  fixed seed, or the files given on the command line:
+//
+//  usage: fuzz_packet [-runs=N] [-seed=N] [file...]
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "fg_server.hxx"
+#include "fg_packet.hxx"
+
+// defined by main.cxx, which is not part of the test
+void ReloadConfig () {}
+
+/** @brief FG_SERVER with the packet checks made accessible */
+class FuzzServer : public FG_SERVER
+{
+public:
+	using FG_SERVER::PacketIsValid;
+	using FG_SERVER::PacketErrorMsg;
+	using FG_SERVER::AddBadClient;
+	using FG_SERVER::DropClient;
+	using FG_SERVER::mT_BadSendersIt;
+	using FG_SERVER::m_BadSenders;
+	using FG_SERVER::m_PlayerList;
+};
+
+/** stop at a broken invariant, libFuzzer keeps the input */
+#define REQUIRE(Cond) \
+	do \
+	{ \
+		if ( ! ( Cond ) ) \
+		{ \
+			fprintf ( stderr, "%s:%d: %s\n", __FILE__, __LINE__, #Cond ); \
+			abort (); \
+		} \
+	} while ( 0 )
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief A bad packet from one of four senders. m_BadSenders must point
+ *        to the player of the sender, one player per sender.
+ */
+static void
+BadClient ( FuzzServer& Server, int Error, const FG_PlayerState& State,
+  size_t Size )
+{
+	static const netAddress Senders[4] =
+	{
+		netAddress ( "127.0.0.1", 5000 ),
+		netAddress ( "127.0.0.2", 5000 ),
+		netAddress ( "127.0.0.3", 5000 ),
+		netAddress ( "127.0.0.4", 5000 )
+	};
+	const netAddress& From = Senders[Size % 4];
+	Server.AddBadClient ( From, Error, State, true, Size );
+	Server.m_PlayerList.Lock ();
+	REQUIRE ( Server.m_PlayerList.Size () <= 4 );
+	FuzzServer::mT_BadSendersIt Bad = Server.m_BadSenders.find ( From.getIP () );
+	REQUIRE ( Bad != Server.m_BadSenders.end () );
+	PlayerIt Player = Server.m_PlayerList.FindByID ( Bad->second );
+	REQUIRE ( Player != Server.m_PlayerList.End () );
+	REQUIRE ( Player->Address == From );
+	REQUIRE ( Player->HasErrors );
+	Server.m_PlayerList.Unlock ();
+	if ( Size % 16 == 0 )
+	{	// the bad client expires
+		uint32_t ID = Player->ID;
+		Server.DropClient ( Player );
+		Bad = Server.m_BadSenders.find ( From.getIP () );
+		REQUIRE ( ( Bad == Server.m_BadSenders.end () ) || ( Bad->second != ID ) );
+	}
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Check one datagram
+ */
+extern "C" int
+LLVMFuzzerTestOneInput ( const uint8_t* Data, size_t Size )
+{
+	static FuzzServer Server;
+	static FG_PropertyFilter Filter;
+	static const netAddress Sender ( "127.0.0.1", 5000 );
+	if ( ! Filter.Enabled () )
+	{	// first call, bad clients are not worth a log line here
+		sglog().setLogLevels ( SG_ALL, SG_ALERT );
+		Filter.SetBands ( "20:* 60:100-199,10002 100:10002" );
+	}
+
+	char* Copy = new char[Size];
+	if ( Size > 0 )
+		memcpy ( Copy, Data, Size );
+	FG_PlayerState State;
+	State.Decode ( Copy, Size );
+	if ( State.HasPosition )
+	{
+		REQUIRE ( State.MsgLen >= Fixed );
+		REQUIRE ( State.MsgLen <= Size );
+		REQUIRE ( strnlen ( State.Model, MAX_MODEL_NAME_LEN ) <= MAX_MODEL_NAME_LEN );
+	}
+	int Error = Server.PacketIsValid ( Size, State );
+	if ( Error != FG_SERVER::PACKET_VALID )
+	{
+		REQUIRE ( ! Server.PacketErrorMsg ( Error, State, Sender ).empty () );
+		BadClient ( Server, Error, State, Size );
+	}
+	else if ( State.HasPosition )
+	{
+		std::vector<char> Out ( Size );
+		for ( int b = 1; b < 3; b++ )
+		{
+			int Len = Filter.Trim ( b, Copy, Size, &Out[0] );
+			if ( Len == 0 )
+				continue;
+			REQUIRE ( Len >= ( int ) Fixed );
+			REQUIRE ( Len <= ( int ) Size );
+			// the trimmed packet is a valid position packet again
+			FG_PlayerState Trimmed;
+			Trimmed.Decode ( &Out[0], Len );
+			REQUIRE ( Trimmed.HasPosition );
+			REQUIRE ( Trimmed.MsgLen == ( uint32_t ) Len );
+		}
+	}
+	delete [] Copy;
+	return 0;
+}
+
+#if ! defined FGMS_LIBFUZZER
+
+static uint32_t Seed = 1;
+
+/** xorshift, the same sequence on every platform */
+static uint32_t
+Random ()
+{
+	Seed ^= Seed << 13;
+	Seed ^= Seed >> 17;
+	Seed ^= Seed << 5;
+	return Seed;
+}
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief A valid packet to start the mutations from
+ */
+static std::vector<char>
+Template ()
+{
+	const double Pos[3] = { 4000000.0, 3000000.0, 3500000.0 };
+	const float  Vel[3] = { 100.0f, 0.0f, -5.0f };
+	std::vector<char> Props;
+	int Count = Random () % 16;
+	for ( int i = 0; i < Count; i++ )
+	{
+		switch ( Random () % 4 )
+		{
+		case 0:	// short int
+			Word ( Props, ( ( 100 + Random () % 100 ) << 16 ) | 1 );
+			break;
+		case 1:	// long float
+			Word ( Props, 300 + Random () % 100 );
+			Word ( Props, 0x3f800000 );
+			break;
+		case 2:	// short string
+			ShortString ( Props, 10002, "hello world" + Random () % 11 );
+			break;
+		case 3:	// long string, one word per character
+			Word ( Props, 10002 );
+			Word ( Props, 3 );
+			for ( int c = 0; c < 4; c++ )
+				Word ( Props, 'a' );
+			break;
+		}
+	}
+	std::vector<char> Msg = Packet ( Props );
+	SetPosition ( Msg, Pos, Vel, 1.0 );
+	if ( Random () % 4 == 0 )
+	{	// a chat or any other message
+		T_MsgHdr* Hdr = ( T_MsgHdr* ) &Msg[0];
+		Hdr->MsgId = XDR_encode<uint32_t> ( Random () % 16 );
+	}
+	return Msg;
+}
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Change Msg at random: bytes, words, the length
+ */
+static void
+Mutate ( std::vector<char>& Msg )
+{
+	int Count = 1 + Random () % 4;
+	for ( int i = 0; i < Count; i++ )
+	{
+		switch ( Random () % 6 )
+		{
+		case 0:	// one byte
+			if ( ! Msg.empty () )
+				Msg[Random () % Msg.size ()] = Random ();
+			break;
+		case 1:	// one word within the properties
+			if ( Msg.size () >= Fixed + 4 )
+			{
+				size_t Pos = Fixed + ( Random () % ( Msg.size () - Fixed ) & ~3 );
+				if ( Pos + 4 <= Msg.size () )
+				{
+					uint32_t W = XDR_encode<uint32_t> ( Random () );
+					memcpy ( &Msg[Pos], &W, 4 );
+				}
+			}
+			break;
+		case 2:	// cut anywhere
+			Msg.resize ( Random () % ( Msg.size () + 1 ) );
+			break;
+		case 3:	// cut close to the end of the header or position
+			Msg.resize ( std::min ( Msg.size (),
+			  ( size_t ) ( ( Random () % 2 ? Fixed : sizeof ( T_MsgHdr ) )
+			  - 4 + Random () % 8 ) ) );
+			break;
+		case 4:	// a MsgLen around the size
+			if ( Msg.size () >= sizeof ( T_MsgHdr ) )
+			{
+				T_MsgHdr* Hdr = ( T_MsgHdr* ) &Msg[0];
+				Hdr->MsgLen = XDR_encode<uint32_t> ( Msg.size () - 8
+				  + Random () % 16 );
+			}
+			break;
+		case 5:	// garbage at the end
+			for ( int b = Random () % 16; b > 0; b-- )
+				Msg.push_back ( Random () );
+			break;
+		}
+	}
+}
+
+int
+main ( int argc, char* argv[] )
+{
+	long Runs = 100000;
+	std::vector<std::string> Files;
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( strncmp ( argv[i], "-runs=", 6 ) == 0 )
+			Runs = atol ( argv[i] + 6 );
+		else if ( strncmp ( argv[i], "-seed=", 6 ) == 0 )
+			Seed = atol ( argv[i] + 6 ) | 1;
+		else
+			Files.push_back ( argv[i] );
+	}
+	if ( ! Files.empty () )
+	{	// replay a corpus or a crash
+		for ( size_t i = 0; i < Files.size (); i++ )
+		{
+			std::ifstream In ( Files[i].c_str (), std::ios::binary );
+			std::vector<char> Msg ( ( std::istreambuf_iterator<char> ( In ) ),
+			  std::istreambuf_iterator<char> () );
+			LLVMFuzzerTestOneInput ( ( const uint8_t* ) Msg.data (), Msg.size () );
+		}
+		return 0;
+	}
+	for ( long r = 0; r < Runs; r++ )
+	{
+		std::vector<char> Msg = Template ();
+		Mutate ( Msg );
+		LLVMFuzzerTestOneInput ( ( const uint8_t* ) Msg.data (), Msg.size () );
+	}
+	printf ( "%ld packets checked\n", Runs );
+	return 0;
+}
+
+#endif
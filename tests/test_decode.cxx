@@ -0,0 +1,110 @@
+/**
+ * @file test_decode.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, test of FG_PlayerState::Decode
+//
+//  Every packet is decoded from a heap buffer of exactly its size, so
+//  a build with -fsanitize=address reports any read beyond it.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <vector>
+#include "fg_server.hxx"
+#include "fg_packet.hxx"
+#include "fg_test.hxx"
+
+// defined by main.cxx, which is not part of the test
+void ReloadConfig () {}
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Decode the first Bytes of Msg from a buffer of that size
+ */
+static FG_PlayerState
+Decoded ( const std::vector<char>& Msg, size_t Bytes )
+{
+	FG_PlayerState State;
+	char* Copy = new char[Bytes];
+	memcpy ( Copy, &Msg[0], Bytes );
+	State.Decode ( Copy, Bytes );
+	delete [] Copy;
+	return State;
+}
+
+int
+main ()
+{
+	const double Pos[3] = { 4000000.0, 3000000.0, 3500000.0 };
+	const float  Vel[3] = { 100.0f, 0.0f, -5.0f };
+	std::vector<char> Props;
+	Word ( Props, ( 100 << 16 ) | 1 );
+	std::vector<char> Msg = Packet ( Props );
+	SetPosition ( Msg, Pos, Vel, 12.5 );
+
+	// a complete position packet
+	FG_PlayerState State = Decoded ( Msg, Msg.size () );
+	CHECK ( State.HasPosition );
+	CHECK ( State.Magic == MSG_MAGIC );
+	CHECK ( State.MsgLen == Msg.size () );
+	CHECK ( State.Position[0] == Pos[0] );
+	CHECK ( State.Position[2] == Pos[2] );
+	CHECK ( State.Motion.LinearVel[0] == Vel[0] );
+	CHECK ( State.Motion.Time == 12.5 );
+	CHECK ( strncmp ( State.Callsign, "TEST", MAX_CALLSIGN_LEN ) == 0 );
+
+	// received fewer bytes than MsgLen announces
+	State = Decoded ( Msg, Msg.size () - 1 );
+	CHECK ( ! State.HasPosition );
+	CHECK ( State.Magic == MSG_MAGIC );
+	CHECK ( State.Position[0] == 0 );
+	CHECK ( State.Motion.Time == 0 );
+
+	// cut within the position block
+	State = Decoded ( Msg, Fixed - 8 );
+	CHECK ( ! State.HasPosition );
+	CHECK ( State.Position[0] == 0 );
+
+	// MsgLen too short for the position block
+	T_MsgHdr* Hdr = ( T_MsgHdr* ) &Msg[0];
+	Hdr->MsgLen = XDR_encode<uint32_t> ( Fixed - 4 );
+	State = Decoded ( Msg, Msg.size () );
+	CHECK ( ! State.HasPosition );
+	CHECK ( State.MsgLen == Fixed - 4 );
+	CHECK ( State.Position[0] == 0 );
+	Hdr->MsgLen = XDR_encode<uint32_t> ( Msg.size () );
+
+	// not even a header
+	State = Decoded ( Msg, sizeof ( T_MsgHdr ) - 1 );
+	CHECK ( ! State.HasPosition );
+	CHECK ( State.Magic == 0 );
+	CHECK ( State.MsgId == 0 );
+	CHECK ( State.MsgLen == 0 );
+	CHECK ( State.Callsign[0] == 0 );
+
+	// other messages are never decoded as position
+	Hdr->MsgId = XDR_encode<uint32_t> ( CHAT_MSG_ID );
+	State = Decoded ( Msg, Msg.size () );
+	CHECK ( ! State.HasPosition );
+	CHECK ( State.MsgId == CHAT_MSG_ID );
+	return TEST_RESULT ();
+}
@@ -0,0 +1,122 @@
+/**
+ * @file test_geod.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, test of CartToGeod() against sgCartToGeod()
+//  and of the geodetic position cached by FG_Player
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdlib.h>
+#include <simgear/debug/logstream.hxx>
+#include "fg_geometry.hxx"
+#include "fg_list.hxx"
+#include "fg_test.hxx"
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief The distance in meters between two geodetic positions
+ */
+static double
+Meters ( const Point3D& A, const Point3D& B )
+{
+	double PA[3], PB[3];
+	sgGeodToCart ( A[Lat] * SG_DEGREES_TO_RADIANS, A[Lon] * SG_DEGREES_TO_RADIANS,
+	  A[Alt] * SG_FEET_TO_METER, PA );
+	sgGeodToCart ( B[Lat] * SG_DEGREES_TO_RADIANS, B[Lon] * SG_DEGREES_TO_RADIANS,
+	  B[Alt] * SG_FEET_TO_METER, PB );
+	return sqrt ( ( PA[0] - PB[0] ) * ( PA[0] - PB[0] )
+	  + ( PA[1] - PB[1] ) * ( PA[1] - PB[1] )
+	  + ( PA[2] - PB[2] ) * ( PA[2] - PB[2] ) );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+static double
+Random ( double Min, double Max )
+{
+	return Min + ( Max - Min ) * ( rand () / ( double ) RAND_MAX );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Convert a geodetic position (radians, meters) with both
+ *        functions, true if the results are less than 1 mm apart
+ */
+static bool
+Agrees ( double Lat, double Lon, double Alt )
+{
+	double P[3];
+	sgGeodToCart ( Lat, Lon, Alt, P );
+	Point3D Cart ( P[0], P[1], P[2] );
+	Point3D Old, New;
+	sgCartToGeod ( Cart, Old );
+	CartToGeod ( Cart, New );
+	return Meters ( Old, New ) < 0.001;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+int
+main ()
+{
+	// from 1000 km below the surface up to geostationary orbits
+	srand ( 1 );
+	size_t Failed = 0;
+	for ( int i = 0; i < 100000; i++ )
+	{
+		double Lat = Random ( -M_PI / 2, M_PI / 2 );
+		double Lon = Random ( -M_PI, M_PI );
+		double Alt = Random ( -1000000, 36000000 );
+		Failed += ! Agrees ( Lat, Lon, Alt );
+	}
+	CHECK ( Failed == 0 );
+	// the poles, the equator and where CartToGeod() switches formulas
+	double Lats[] = { -90, -89.999, -33.21, 0, 33.21, 89.999, 90 };
+	double Alts[] = { -1000000, 0, 10000, 36000000 };
+	for ( size_t i = 0; i < sizeof ( Lats ) / sizeof ( Lats[0] ); i++ )
+	{
+		for ( size_t j = 0; j < sizeof ( Alts ) / sizeof ( Alts[0] ); j++ )
+		{
+			CHECK ( Agrees ( Lats[i] * M_PI / 180, 0.5, Alts[j] ) );
+		}
+	}
+
+	// the cache follows SetPosition(), copies keep it as it is
+	double P[3];
+	sgGeodToCart ( 0.8, 0.2, 3000, P );
+	FG_Player Player;
+	Player.SetPosition ( P[0], P[1], P[2] );
+	Point3D Expected;
+	CartToGeod ( Player.LastPos, Expected );
+	FG_Player Copy ( Player );
+	CHECK ( Meters ( Copy.GetGeodPos (), Expected ) == 0 );
+	CHECK ( Meters ( Player.GetGeodPos (), Expected ) == 0 );
+	sgGeodToCart ( -0.3, 1.2, 100, P );
+	Player.SetPosition ( P[0], P[1], P[2] );
+	CartToGeod ( Player.LastPos, Expected );
+	CHECK ( Meters ( Player.GetGeodPos (), Expected ) == 0 );
+	Copy = Player;
+	CHECK ( Meters ( Copy.GetGeodPos (), Expected ) == 0 );
+	return TEST_RESULT ();
+}
+//////////////////////////////////////////////////////////////////////
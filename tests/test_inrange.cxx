@@ -0,0 +1,160 @@
+/**
+ * @file test_inrange.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, test of the versions of InRangeMask()
+//
+//  The AVX2 and SSE2 versions must give the same mask as the scalar
+//  version, for every count of receivers (not only multiples of the
+//  vector width) and for receivers exactly at their range. The arrays
+//  have exactly Count elements, so that an address sanitizer catches
+//  every read beyond them.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+#include "fg_geometry.hxx"
+#include "fg_test.hxx"
+
+/** @brief receivers as InRangeMask() takes them */
+struct Receivers
+{
+	std::vector<double> X, Y, Z, Range2;
+	void Add ( double x, double y, double z, double r2 )
+	{
+		X.push_back ( x );
+		Y.push_back ( y );
+		Z.push_back ( z );
+		Range2.push_back ( r2 );
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+static double
+Random ( double Min, double Max )
+{
+	return Min + ( Max - Min ) * ( rand () / ( double ) RAND_MAX );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Compare all versions available on this CPU with the scalar
+ *        one and with Expected, false on the first difference
+ */
+static bool
+Agrees ( const Point3D& Pos, const Receivers& R, uint64_t Expected )
+{
+	uint64_t Scalar = 0;
+	size_t Count = R.X.size ();
+	InRangeMaskOf ( IN_RANGE_SCALAR, Pos, R.X.data (), R.Y.data (),
+	  R.Z.data (), R.Range2.data (), Count, Scalar );
+	if ( Scalar != Expected )
+		return false;
+	for ( int Version = IN_RANGE_SSE2; Version <= IN_RANGE_AVX2; Version++ )
+	{
+		uint64_t Mask = ~Scalar;
+		if ( ! InRangeMaskOf ( Version, Pos, R.X.data (), R.Y.data (),
+		  R.Z.data (), R.Range2.data (), Count, Mask ) )
+			continue;	// not on this CPU
+		if ( Mask != Scalar )
+			return false;
+	}
+	return InRangeMask ( Pos, R.X.data (), R.Y.data (), R.Z.data (),
+	  R.Range2.data (), Count ) == Scalar;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+int
+main ()
+{
+	uint64_t Mask;
+	Point3D Origin ( 0, 0, 0 );
+	CHECK ( InRangeMaskOf ( IN_RANGE_SCALAR, Origin, 0, 0, 0, 0, 0, Mask ) );
+	CHECK ( Mask == 0 );
+	for ( int Version = IN_RANGE_SSE2; Version <= IN_RANGE_AVX2; Version++ )
+	{
+		std::cout << "version " << Version << ( InRangeMaskOf ( Version,
+		  Origin, 0, 0, 0, 0, 0, Mask ) ? " checked" : " not available" )
+		  << std::endl;
+	}
+
+	// random receivers around the earth, every count
+	srand ( 1 );
+	size_t Failed = 0;
+	for ( int Run = 0; Run < 200; Run++ )
+	{
+		for ( size_t Count = 0; Count <= RANGE_MASK_BITS; Count++ )
+		{
+			Point3D Pos ( Random ( -7e6, 7e6 ), Random ( -7e6, 7e6 ),
+			  Random ( -7e6, 7e6 ) );
+			Receivers R;
+			uint64_t Expected = 0;
+			for ( size_t i = 0; i < Count; i++ )
+			{
+				double x = Pos[X] + Random ( -2e6, 2e6 );
+				double y = Pos[Y] + Random ( -2e6, 2e6 );
+				double z = Pos[Z] + Random ( -2e6, 2e6 );
+				double dx = x - Pos[X], dy = y - Pos[Y], dz = z - Pos[Z];
+				double d2 = dx*dx + dy*dy + dz*dz;
+				double r = Random ( 0, 3e6 );
+				R.Add ( x, y, z, r * r );
+				if ( d2 < r * r )
+					Expected |= ( uint64_t ) 1 << i;
+			}
+			Failed += ! Agrees ( Pos, R, Expected );
+		}
+	}
+	CHECK ( Failed == 0 );
+
+	// distances exactly at the range are out, just below it are in
+	Point3D Pos ( 1000, -2000, 3000 );
+	for ( size_t Count = 0; Count <= RANGE_MASK_BITS; Count++ )
+	{
+		Receivers R;
+		uint64_t Expected = 0;
+		for ( size_t i = 0; i < Count; i++ )
+		{	// 3-4-5 triangles, exact in floating point
+			double Scale = 1 + i * 1000;
+			double d2 = 25 * Scale * Scale;
+			switch ( i % 3 )
+			{
+			case 0:	// at the range
+				R.Add ( Pos[X] + 3 * Scale, Pos[Y] + 4 * Scale, Pos[Z], d2 );
+				break;
+			case 1:	// the next double above the distance
+				R.Add ( Pos[X], Pos[Y] - 3 * Scale, Pos[Z] + 4 * Scale,
+				  nextafter ( d2, INFINITY ) );
+				Expected |= ( uint64_t ) 1 << i;
+				break;
+			case 2:	// the next double below the distance
+				R.Add ( Pos[X] - 4 * Scale, Pos[Y], Pos[Z] - 3 * Scale,
+				  nextafter ( d2, 0 ) );
+				break;
+			}
+		}
+		CHECK ( Agrees ( Pos, R, Expected ) );
+	}
+	return TEST_RESULT ();
+}
+//////////////////////////////////////////////////////////////////////
@@ -0,0 +1,215 @@
+/**
+ * @file test_journal.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, test of FG_Journal and of the journal of
+//  FG_TRACKER
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include "fg_journal.hxx"
+#include "fg_tracker.hxx"
+#include "fg_test.hxx"
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Delete directory Dir and the files in it
+ */
+static void
+RemoveDir ( const std::string& Dir )
+{
+	DIR* D = opendir ( Dir.c_str () );
+	if ( D == 0 )
+	{
+		return;
+	}
+	struct dirent* E;
+	while ( ( E = readdir ( D ) ) != 0 )
+	{
+		std::string Name = E->d_name;
+		if ( ( Name != "." ) && ( Name != ".." ) )
+		{
+			unlink ( ( Dir + "/" + Name ).c_str () );
+		}
+	}
+	closedir ( D );
+	rmdir ( Dir.c_str () );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief A new empty directory
+ */
+static std::string
+TempDir ()
+{
+	char Name[] = "/tmp/test_journal.XXXXXX";
+	if ( mkdtemp ( Name ) == 0 )
+	{
+		perror ( "mkdtemp" );
+		exit ( 1 );
+	}
+	return Name;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief A TCP port on localhost nobody listens on
+ */
+static int
+ClosedPort ()
+{
+	struct sockaddr_in A = sockaddr_in ();
+	socklen_t Len = sizeof ( A );
+	int Fd = socket ( AF_INET, SOCK_STREAM, 0 );
+	A.sin_family = AF_INET;
+	A.sin_addr.s_addr = htonl ( INADDR_LOOPBACK );
+	bind ( Fd, ( struct sockaddr* ) &A, sizeof ( A ) );
+	getsockname ( Fd, ( struct sockaddr* ) &A, &Len );
+	close ( Fd );
+	return ntohs ( A.sin_port );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+static void*
+RunTracker ( void* Context )
+{
+	static_cast<FG_TRACKER*> ( Context )->Loop ();
+	return 0;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief The child writes msg1 .. msg6, acknowledges msg1 and msg2 and
+ *        exits without closing the journal, like a crashed fgms
+ */
+static void
+Crash ( const std::string& Dir )
+{
+	FG_Journal J;
+	FG_Journal::Position Next;
+	std::string Msg;
+	if ( ! J.Open ( Dir ) )
+	{
+		_exit ( 1 );
+	}
+	for ( int i = 1; i <= 5; i++ )
+	{
+		J.Append ( "msg" + std::to_string ( i ) );
+	}
+	for ( int i = 1; i <= 3; i++ )
+	{
+		J.Read ( Msg, Next );
+		if ( i <= 2 )
+		{
+			J.Ack ( Next );
+		}
+	}
+	J.Checkpoint ();
+	J.Append ( "msg6" );
+	_exit ( 0 );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+int
+main ()
+{
+	FG_Journal::Position Next;
+	std::string Msg;
+
+	// write, crash, reopen: replay from the checkpoint
+	std::string Dir = TempDir ();
+	pid_t Pid = fork ();
+	if ( Pid == 0 )
+	{
+		Crash ( Dir );
+	}
+	int Status = -1;
+	waitpid ( Pid, &Status, 0 );
+	CHECK ( WIFEXITED ( Status ) && ( WEXITSTATUS ( Status ) == 0 ) );
+	{
+		FG_Journal J;
+		CHECK ( J.Open ( Dir ) );
+		CHECK ( J.Unread () == 4 );
+		for ( int i = 3; i <= 6; i++ )
+		{
+			CHECK ( J.Read ( Msg, Next ) && ( Msg == "msg" + std::to_string ( i ) ) );
+			if ( i <= 4 )
+			{
+				J.Ack ( Next );
+			}
+		}
+		CHECK ( ! J.Read ( Msg, Next ) );
+		// not acknowledged, read again
+		J.Rewind ();
+		CHECK ( J.Read ( Msg, Next ) && ( Msg == "msg5" ) );
+		J.Append ( "msg7" );
+		J.Close ();
+	}
+	{	// a clean stop saved the checkpoint of msg4
+		FG_Journal J;
+		CHECK ( J.Open ( Dir ) );
+		CHECK ( J.Unread () == 3 );
+		CHECK ( J.Read ( Msg, Next ) && ( Msg == "msg5" ) );
+		CHECK ( J.Read ( Msg, Next ) && ( Msg == "msg6" ) );
+		CHECK ( J.Read ( Msg, Next ) && ( Msg == "msg7" ) );
+	}
+	RemoveDir ( Dir );
+
+	// the tracker spools its queue into the journal when it stops
+	Dir = TempDir ();
+	{
+		FG_TRACKER T ( ClosedPort (), "127.0.0.1", "test", "localhost" );
+		T.SetJournal ( Dir );
+		pthread_t Thread;
+		pthread_create ( &Thread, 0, &RunTracker, &T );
+		T.AddMessage ( "NOWAIT\n" );
+		T.AddMessage ( "DISCONNECT test pilot\n" );
+		pthread_mutex_lock ( &T.msg_mutex );
+		T.WantExit = true;
+		pthread_cond_signal ( &T.condition_var );
+		pthread_mutex_unlock ( &T.msg_mutex );
+		pthread_join ( Thread, 0 );
+		CHECK ( ! T.m_Journal.IsOpen () );
+	}
+	{
+		FG_Journal J;
+		CHECK ( J.Open ( Dir ) );
+		CHECK ( J.Unread () == 2 );
+		CHECK ( J.Read ( Msg, Next ) && ( Msg == "NOWAIT\n" ) );
+		CHECK ( J.Read ( Msg, Next ) && ( Msg == "DISCONNECT test pilot\n" ) );
+	}
+	RemoveDir ( Dir );
+	return TEST_RESULT ();
+}
+//////////////////////////////////////////////////////////////////////
@@ -0,0 +1,99 @@
+/**
+ * @file test_lod.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, test of the rate bands of FG_LodPolicy
+//
+//  A sender sends 50 packets per second for a second. With the bands
+//  "10:0 40:10 100:2" a receiver 5 nm away gets all of them, one 20 nm
+//  away about 10 and one 60 nm or further away about 2.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <time.h>
+#include <unistd.h>
+#include "fg_lod.hxx"
+#include "fg_test.hxx"
+
+//////////////////////////////////////////////////////////////////////
+static uint64_t
+NowMs ()
+{
+	struct timespec T;
+	clock_gettime ( CLOCK_MONOTONIC, &T );
+	return ( uint64_t ) T.tv_sec * 1000 + T.tv_nsec / 1000000;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+int
+main ()
+{
+	FG_Motion Motion = FG_Motion ();
+	FG_LodPolicy Lod;
+
+	// the bands, invalid ones leave the bands as they are
+	CHECK ( ! Lod.Enabled () );
+	CHECK ( Lod.Forward ( 1, 2, 500, Motion ) );
+	CHECK ( Lod.SetBands ( "10:0, 40:10 100:2" ) );
+	CHECK ( Lod.GetBands () == "10:0 40:10 100:2" );
+	CHECK ( ! Lod.SetBands ( "40:10 10:0" ) );	// not ascending
+	CHECK ( ! Lod.SetBands ( "10" ) );
+	CHECK ( ! Lod.SetBands ( "0:5" ) );
+	CHECK ( ! Lod.SetBands ( "10:-1" ) );
+	CHECK ( ! Lod.SetBands ( "10:5x" ) );
+	CHECK ( Lod.GetBands () == "10:0 40:10 100:2" );
+	CHECK ( Lod.Enabled () );
+
+	// one sender, receivers in every band and beyond the last one
+	const double Distance[] = { 5, 20, 60, 500 };
+	size_t Got[4] = { 0, 0, 0, 0 };
+	size_t Sent = 0;
+	uint64_t Start = NowMs ();
+	while ( NowMs () - Start < 1000 )
+	{
+		for ( int r = 0; r < 4; r++ )
+		{
+			Got[r] += Lod.Forward ( 1, 2 + r, Distance[r], Motion );
+		}
+		Sent++;
+		usleep ( 20000 );
+	}
+	std::cout << Sent << " packets sent, received " << Got[0] << " "
+	  << Got[1] << " " << Got[2] << " " << Got[3] << std::endl;
+	CHECK ( Got[0] == Sent );
+	CHECK ( ( Got[1] >= 9 ) && ( Got[1] <= 12 ) );
+	CHECK ( ( Got[2] >= 2 ) && ( Got[2] <= 4 ) );
+	CHECK ( ( Got[3] >= 2 ) && ( Got[3] <= 4 ) );
+	CHECK ( Lod.Forwarded + Lod.Thinned == 4 * Sent );
+	CHECK ( Lod.Predicted == 0 );
+
+	// every pair has its own time: another sender, and a receiver
+	// after Clear(), get their first packet at once
+	CHECK ( Lod.Forward ( 7, 4, 60, Motion ) );
+	CHECK ( ! Lod.Forward ( 7, 4, 60, Motion ) );
+	Lod.Clear ();
+	CHECK ( Lod.Forward ( 1, 4, 60, Motion ) );
+	// Expire() keeps pairs which forwarded recently
+	Lod.Expire ();
+	CHECK ( ! Lod.Forward ( 1, 4, 60, Motion ) );
+	return TEST_RESULT ();
+}
+//////////////////////////////////////////////////////////////////////
@@ -0,0 +1,120 @@
+/**
+ * @file test_property.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, test of FG_PropertyFilter
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <vector>
+#include "fg_property.hxx"
+#include "fg_packet.hxx"
+#include "fg_test.hxx"
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief The IDs of all properties of a packet, empty if it is not
+ *        parsable
+ */
+static std::vector<uint32_t>
+Ids ( const char* Msg, int Bytes )
+{
+	std::vector<uint32_t> Result;
+	const char* Pos = Msg + Fixed;
+	const char* End = Msg + Bytes;
+	FG_PropertyFilter::Property Prop;
+	while ( Pos < End )
+	{
+		if ( ! FG_PropertyFilter::NextProperty ( Pos, End, Prop ) )
+			return std::vector<uint32_t> ();
+		Result.push_back ( Prop.Id );
+	}
+	return Result;
+}
+
+int
+main ()
+{
+	// 100 short int, 10002 short string (chat), 200 long float,
+	// 101 short int. The text of the string looks like short
+	// properties ('he' = 26725) if it is not skipped.
+	std::vector<char> Int100, Chat, Float200, Int101;
+	Word ( Int100, ( 100 << 16 ) | 5 );
+	ShortString ( Chat, 10002, "hello world" );
+	Word ( Float200, 200 );
+	Word ( Float200, 0x3f800000 );
+	Word ( Int101, ( 101 << 16 ) | 7 );
+	std::vector<char> Props;
+	Props.insert ( Props.end (), Int100.begin (), Int100.end () );
+	Props.insert ( Props.end (), Chat.begin (), Chat.end () );
+	Props.insert ( Props.end (), Float200.begin (), Float200.end () );
+	Props.insert ( Props.end (), Int101.begin (), Int101.end () );
+	std::vector<char> Msg = Packet ( Props );
+
+	std::vector<uint32_t> All = Ids ( &Msg[0], Msg.size () );
+	CHECK ( All.size () == 4 );
+	CHECK ( ( All.size () == 4 ) && ( All[0] == 100 ) && ( All[1] == 10002 )
+	  && ( All[2] == 200 ) && ( All[3] == 101 ) );
+
+	FG_PropertyFilter Filter;
+	CHECK ( Filter.SetBands ( "10:10002 20:100-199 30:*" ) );
+	CHECK ( Filter.GetBand ( 5 ) == 0 );
+	CHECK ( Filter.GetBand ( 15 ) == 1 );
+	CHECK ( Filter.GetBand ( 25 ) == -1 );
+	std::vector<char> Out ( Msg.size () );
+
+	// only the chat, the header word and the text stay together
+	int Len = Filter.Trim ( 0, &Msg[0], Msg.size (), &Out[0] );
+	std::vector<char> Expected = Packet ( Chat );
+	CHECK ( Len == ( int ) Expected.size () );
+	CHECK ( ( Len == ( int ) Expected.size () )
+	  && ( memcmp ( &Out[0], &Expected[0], Len ) == 0 ) );
+
+	// trimming the trimmed packet again does not change it
+	std::vector<char> Again ( Len );
+	CHECK ( Filter.Trim ( 0, &Out[0], Len, &Again[0] ) == Len );
+	CHECK ( memcmp ( &Again[0], &Expected[0], Len ) == 0 );
+
+	// without the chat, the text must not leave anything behind
+	Len = Filter.Trim ( 1, &Msg[0], Msg.size (), &Out[0] );
+	std::vector<char> Ints ( Int100 );
+	Ints.insert ( Ints.end (), Int101.begin (), Int101.end () );
+	Expected = Packet ( Ints );
+	CHECK ( Len == ( int ) Expected.size () );
+	CHECK ( ( Len == ( int ) Expected.size () )
+	  && ( memcmp ( &Out[0], &Expected[0], Len ) == 0 ) );
+	CHECK ( Filter.Trimmed == 3 );
+
+	// a packet ending within the text is forwarded untrimmed
+	size_t Unparsable = Filter.Unparsable;
+	int Cut = Fixed + Int100.size () + 8;
+	CHECK ( Filter.Trim ( 0, &Msg[0], Cut, &Out[0] ) == 0 );
+	CHECK ( Filter.Unparsable == Unparsable + 1 );
+
+	// a string longer than MAX_STRING is not understood
+	std::vector<char> Long;
+	Word ( Long, ( 10002 << 16 ) | ( FG_PropertyFilter::MAX_STRING + 1 ) );
+	Long.resize ( 4 + FG_PropertyFilter::MAX_STRING + 4, 'x' );
+	Msg = Packet ( Long );
+	Out.resize ( Msg.size () );
+	CHECK ( Filter.Trim ( 1, &Msg[0], Msg.size (), &Out[0] ) == 0 );
+	return TEST_RESULT ();
+}
@@ -0,0 +1,82 @@
+/**
+ * @file test_ratelimit.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, test of FG_RateLimit
+//
+//  A source floods for three seconds. It is reported once, not once
+//  per Escalate seconds, as it is blocked after the first report.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <unistd.h>
+#include "fg_ratelimit.hxx"
+#include "fg_test.hxx"
+
+//////////////////////////////////////////////////////////////////////
+int
+main ()
+{
+	FG_RateLimit Limit;
+	Limit.SetRate ( 10 );
+	Limit.SetBurst ( 10 );
+	Limit.SetEscalate ( 1 );
+	Limit.SetBlockTime ( 60 );
+	netAddress Flood ( "192.0.2.1", 0 );
+	netAddress Relay ( "192.0.2.2", 0 );
+	time_t TTL = 0;
+
+	// the burst passes, the rest is dropped
+	size_t Passed = 0, Escalated = 0;
+	for ( int Ms = 0; Ms < 3000; Ms++ )
+	{
+		switch ( Limit.Check ( Flood, TTL ) )
+		{
+		case FG_RateLimit::PASS:
+			Passed++;
+			break;
+		case FG_RateLimit::ESCALATE:
+			Escalated++;
+			CHECK ( TTL == 60 );
+			break;
+		case FG_RateLimit::DROP:
+			break;
+		}
+		usleep ( 1000 );
+	}
+	CHECK ( Escalated == 1 );
+	CHECK ( ( Passed >= 10 ) && ( Passed < 60 ) );
+
+	// an exempt source is not limited until it is unexempted
+	Limit.Exempt ( Relay );
+	for ( int i = 0; i < 100; i++ )
+	{
+		CHECK ( Limit.Check ( Relay, TTL ) == FG_RateLimit::PASS );
+	}
+	Limit.Unexempt ( Relay );
+	Passed = 0;
+	for ( int i = 0; i < 100; i++ )
+	{
+		Passed += ( Limit.Check ( Relay, TTL ) == FG_RateLimit::PASS );
+	}
+	CHECK ( ( Passed >= 10 ) && ( Passed < 100 ) );
+	return TEST_RESULT ();
+}
+//////////////////////////////////////////////////////////////////////
@@ -0,0 +1,178 @@
+/**
+ * @file test_reckon.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, test of the dead reckoning of FG_LodPolicy
+//
+//  A sender flies a straight line or a circle at 100 m/s and sends 10
+//  packets per second. Within the band "100:0:50" a receiver only gets
+//  the packets it can not predict within 50 m.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <unistd.h>
+#include "fg_lod.hxx"
+#include "fg_test.hxx"
+
+static const double Speed  = 100;	// m/s
+static const double Radius = 1000;	// m, a turn of 0.1 rad/s
+static const double Step   = 0.1;	// s between two packets
+
+/** what the sender announces besides position, orientation and speed */
+enum
+{
+	PLAIN		= 0,
+	ACCEL		= 1,	// the centripetal acceleration of a turn
+	ANGULAR		= 2	// the turn rate
+};
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief The motion at time T on a line with Heading, or on a circle
+ *        if Turn is set. The body frame is rotated by the heading
+ *        about the Z axis.
+ */
+static FG_Motion
+Track ( double T, double Heading, bool Turn, int Announce )
+{
+	FG_Motion M = FG_Motion ();
+	double Omega = Turn ? Speed / Radius : 0;
+	double Angle = Heading + Omega * T;
+	M.Time = T;
+	if ( Turn )
+	{
+		M.Position[0] = Radius * sin ( Angle );
+		M.Position[1] = Radius * ( 1 - cos ( Angle ) );
+	}
+	else
+	{
+		M.Position[0] = Speed * T * cos ( Heading );
+		M.Position[1] = Speed * T * sin ( Heading );
+	}
+	M.Position[0] += 4000000;
+	M.Position[2]  = 4000000;
+	M.Orientation[2] = Angle;
+	M.LinearVel[0]   = Speed;
+	if ( Announce & ACCEL )
+		M.LinearAccel[1] = Speed * Omega;
+	if ( Announce & ANGULAR )
+		M.AngularVel[2] = Omega;
+	return M;
+}
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Send Packets of a track, the number of packets forwarded
+ */
+static size_t
+Fly ( FG_LodPolicy& Lod, int Packets, double Heading, bool Turn, int Announce )
+{
+	size_t Before = Lod.Forwarded;
+	for ( int k = 0; k < Packets; k++ )
+		Lod.Forward ( 1, 2, 50, Track ( k * Step, Heading, Turn, Announce ) );
+	return Lod.Forwarded - Before;
+}
+
+int
+main ()
+{
+	// constant velocity, only the first packet is needed
+	{
+		FG_LodPolicy Lod;
+		CHECK ( Lod.SetBands ( "100:0:50" ) );
+		Lod.SetSilence ( 60000 );
+		CHECK ( Fly ( Lod, 50, 0, false, PLAIN ) == 1 );
+		CHECK ( Lod.Predicted == 49 );
+		// a second receiver has its own prediction
+		CHECK ( Lod.Forward ( 1, 3, 50, Track ( 5, 0, false, PLAIN ) ) );
+	}
+	// the same on another heading, the velocity is in the body frame
+	{
+		FG_LodPolicy Lod;
+		Lod.SetBands ( "100:0:50" );
+		Lod.SetSilence ( 60000 );
+		CHECK ( Fly ( Lod, 50, 2.0, false, PLAIN ) == 1 );
+	}
+	// a turn without acceleration misses by 5 m * t^2, one packet
+	// in 3.2 seconds, the orientation is not checked
+	{
+		FG_LodPolicy Lod;
+		Lod.SetBands ( "100:0:50" );
+		Lod.SetSilence ( 60000 );
+		Lod.SetAngle ( 0 );
+		CHECK ( Fly ( Lod, 100, 0, true, PLAIN ) == 4 );
+	}
+	// the acceleration and turn rate predict the turn, the miss is
+	// t^3 / 6 m, below 50 m for 6 seconds
+	{
+		FG_LodPolicy Lod;
+		Lod.SetBands ( "100:0:50" );
+		Lod.SetSilence ( 60000 );
+		Lod.SetAngle ( 5 );
+		CHECK ( Fly ( Lod, 60, 0, true, ACCEL | ANGULAR ) == 1 );
+	}
+	// reckon_angle: without the turn rate the orientation is off by
+	// 0.1 rad/s, with a limit of 10 degrees one packet in 1.8 seconds
+	{
+		FG_LodPolicy Lod;
+		Lod.SetBands ( "100:0:50" );
+		Lod.SetSilence ( 60000 );
+		Lod.SetAngle ( 10 );
+		CHECK ( Fly ( Lod, 60, 0, true, ACCEL ) == 4 );
+		Lod.Clear ();
+		Lod.SetAngle ( 0 );
+		CHECK ( Fly ( Lod, 60, 0, true, ACCEL ) == 1 );
+	}
+	// reckon_silence: a predicted packet is forwarded anyway, once the
+	// receiver has not got one for the silence time
+	{
+		FG_LodPolicy Lod;
+		Lod.SetBands ( "100:0:50" );
+		Lod.SetSilence ( 0 );
+		CHECK ( Fly ( Lod, 10, 0, false, PLAIN ) == 10 );
+		Lod.Clear ();
+		Lod.SetSilence ( 20 );
+		CHECK ( Lod.Forward ( 1, 2, 50, Track ( 0, 0, false, PLAIN ) ) );
+		CHECK ( ! Lod.Forward ( 1, 2, 50, Track ( Step, 0, false, PLAIN ) ) );
+		usleep ( 30000 );
+		CHECK ( Lod.Forward ( 1, 2, 50, Track ( 2 * Step, 0, false, PLAIN ) ) );
+	}
+	// a sender time going back or too far ahead is not predicted
+	{
+		FG_LodPolicy Lod;
+		Lod.SetBands ( "100:0:50" );
+		Lod.SetSilence ( 60000 );
+		CHECK ( Lod.Forward ( 1, 2, 50, Track ( 10, 0, false, PLAIN ) ) );
+		CHECK ( Lod.Forward ( 1, 2, 50, Track ( 9, 0, false, PLAIN ) ) );
+		CHECK ( Lod.Forward ( 1, 2, 50, Track ( 9 + FG_LodPolicy::MAX_PREDICTION + 1,
+		  0, false, PLAIN ) ) );
+	}
+	// outside of a band with an error every packet is forwarded
+	{
+		FG_LodPolicy Lod;
+		Lod.SetBands ( "10:0 100:0:50" );
+		Lod.SetSilence ( 60000 );
+		for ( int k = 0; k < 10; k++ )
+			CHECK ( Lod.Forward ( 1, 2, 5, Track ( k * Step, 0, false, PLAIN ) ) );
+	}
+	return TEST_RESULT ();
+}
@@ -0,0 +1,153 @@
+/**
+ * @file test_tracker.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, test of the reconnect of FG_TRACKER
+//
+//  A stand-in tracker on localhost accepts the connection of fgms and
+//  closes it. The time until fgms connects again is measured.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "fg_tracker.hxx"
+#include "fg_test.hxx"
+
+//////////////////////////////////////////////////////////////////////
+static uint64_t
+NowMs ()
+{
+	struct timespec T;
+	clock_gettime ( CLOCK_MONOTONIC, &T );
+	return ( uint64_t ) T.tv_sec * 1000 + T.tv_nsec / 1000000;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief Accept a connection on Listener
+ * @return the socket, -1 if nobody connected within Timeout ms
+ */
+static int
+Accept ( int Listener, int Timeout )
+{
+	struct pollfd P;
+	P.fd      = Listener;
+	P.events  = POLLIN;
+	P.revents = 0;
+	if ( poll ( &P, 1, Timeout ) != 1 )
+	{
+		return -1;
+	}
+	return accept ( Listener, 0, 0 );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+static void*
+RunTracker ( void* Context )
+{
+	static_cast<FG_TRACKER*> ( Context )->Loop ();
+	return 0;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+static void
+StopTracker ( FG_TRACKER& T, pthread_t Thread )
+{
+	pthread_mutex_lock ( &T.msg_mutex );
+	T.WantExit = true;
+	pthread_cond_signal ( &T.condition_var );
+	pthread_mutex_unlock ( &T.msg_mutex );
+	pthread_join ( Thread, 0 );
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+int
+main ()
+{
+	// the queue is written to the current directory when fgms stops
+	char Dir[] = "/tmp/test_tracker.XXXXXX";
+	CHECK ( ( mkdtemp ( Dir ) != 0 ) && ( chdir ( Dir ) == 0 ) );
+
+	// the stand-in tracker
+	struct sockaddr_in A = sockaddr_in ();
+	socklen_t Len = sizeof ( A );
+	int Listener = socket ( AF_INET, SOCK_STREAM, 0 );
+	A.sin_family = AF_INET;
+	A.sin_addr.s_addr = htonl ( INADDR_LOOPBACK );
+	CHECK ( bind ( Listener, ( struct sockaddr* ) &A, sizeof ( A ) ) == 0 );
+	CHECK ( listen ( Listener, 4 ) == 0 );
+	getsockname ( Listener, ( struct sockaddr* ) &A, &Len );
+
+	FG_TRACKER T ( ntohs ( A.sin_port ), "127.0.0.1", "test", "localhost" );
+	pthread_t Thread;
+	pthread_create ( &Thread, 0, &RunTracker, &T );
+	int Fd = Accept ( Listener, 5000 );
+	CHECK ( Fd >= 0 );
+	// identified, but the message is not acknowledged, so that fgms
+	// waits for the socket
+	CHECK ( write ( Fd, "IDENTIFIED", 11 ) == 11 );
+	T.AddMessage ( "NOWAIT\n" );
+	usleep ( 200000 );
+
+	// the tracker goes away, fgms is back after the first backoff
+	close ( Fd );
+	uint64_t Lost = NowMs ();
+	Fd = Accept ( Listener, 5000 );
+	uint64_t Recovery = NowMs () - Lost;
+	CHECK ( Fd >= 0 );
+	std::cout << "reconnected after " << Recovery << " ms" << std::endl;
+	CHECK ( Recovery < FG_TRACKER::MIN_BACKOFF + 250 );
+	StopTracker ( T, Thread );
+	CHECK ( T.LostConnections == 1 );
+	CHECK ( T.m_BackoffMs == FG_TRACKER::MIN_BACKOFF );
+
+	// TrackerRead(), CheckTimeout() and Flush() all notice the lost
+	// connection, but only the first one schedules the reconnect
+	close ( Fd );
+	usleep ( 100000 );
+	FG_TRACKER::buffsock_t bs;
+	bs.buf    = ( char* ) malloc ( 1024 );
+	bs.maxlen = 1024;
+	bs.curlen = 0;
+	T.TrackerRead ( &bs );
+	T.m_TimeoutStage = 3;
+	T.LastSeen = 0;
+	T.CheckTimeout ();
+	T.m_OutBuf = "NOWAIT\n";
+	T.m_OutPos = 0;
+	T.Flush ();
+	free ( bs.buf );
+	CHECK ( ! FG_TRACKER::is_connected () );
+	CHECK ( T.LostConnections == 2 );
+	CHECK ( T.m_BackoffMs == 2 * FG_TRACKER::MIN_BACKOFF );
+	close ( Listener );
+	unlink ( "queue_file" );
+	CHECK ( rmdir ( Dir ) == 0 );
+	return TEST_RESULT ();
+}
+//////////////////////////////////////////////////////////////////////
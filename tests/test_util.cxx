@@ -0,0 +1,80 @@
+/**
+ * @file test_util.cxx
+ */
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, U$
+//
+
+//////////////////////////////////////////////////////////////////////
+//
+//  Server for FlightGear, test of append_fixed() against NumToStr()
+//
+//  The POSITION reports to the tracker are built with append_fixed(),
+//  they must read exactly as they did with NumToStr().
+//
+//////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include "fg_util.hxx"
+#include "fg_test.hxx"
+
+//////////////////////////////////////////////////////////////////////
+/**
+ * @brief true if append_fixed() writes Number like NumToStr()
+ */
+static bool
+SameAsNumToStr ( double Number, int Precision )
+{
+	std::string Str = "x";
+	append_fixed ( Str, Number, Precision );
+	std::string Expected = "x" + NumToStr ( Number, Precision );
+	if ( Str != Expected )
+	{
+		std::cout << Number << ": '" << Str << "' instead of '"
+		  << Expected << "'" << std::endl;
+		return false;
+	}
+	return true;
+}
+//////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////
+int
+main ()
+{
+	// integers, fractions below the precision, negative numbers
+	double Numbers[] = { 0, 1, -1, 5, 1234567, 0.5, -0.5, 0.25, 3.1415926,
+	  -122.4194155, 37.7749295, 2.0000001, -2.0000001, 0.0000001,
+	  -0.0000001, 1e-12, 99999.9999999, 4000000.123456789 };
+	for ( size_t i = 0; i < sizeof ( Numbers ) / sizeof ( Numbers[0] ); i++ )
+	{
+		for ( int Precision = 0; Precision <= 6; Precision++ )
+		{
+			CHECK ( SameAsNumToStr ( Numbers[i], Precision ) );
+		}
+	}
+	// latitudes, longitudes, altitudes and angles of a report
+	srand ( 1 );
+	size_t Failed = 0;
+	for ( int i = 0; i < 100000; i++ )
+	{
+		double Number = ( rand () / ( double ) RAND_MAX - 0.5 ) * 100000;
+		Failed += ! SameAsNumToStr ( Number, 6 );
+		Failed += ! SameAsNumToStr ( Number / 1000, 6 );
+	}
+	CHECK ( Failed == 0 );
+	return TEST_RESULT ();
+}
+//////////////////////////////////////////////////////////////////////